@@ -0,0 +1,17 @@
+#!/bin/bash
+
+# Script to time the solver on generated large puzzles
+# usage: ./bench.sh [blank_percent] [engine]
+# blank_percent defaults to 20, engine to auto
+blank=${1:-20}
+engine=${2:-auto}
+mkdir -p bin
+gcc -Wall -Wextra -O2 src/*.c -o bin/sudoku-bench.out -lm -pthread
+for box in 3 4 5 6 7 8 10 12 15; do
+    psize=$((box * box))
+    ./genpuzzle.sh $box $blank $box > bin/bench$psize.txt
+    start=$(date +%s%N)
+    result=$(./bin/sudoku-bench.out -s -e $engine bin/bench$psize.txt | grep -E "^Arena|Could not")
+    end=$(date +%s%N)
+    echo "${psize}x${psize}: $(( (end - start) / 1000000 ))ms, $result"
+done
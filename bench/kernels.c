@@ -0,0 +1,449 @@
+/**
+ * @file kernels.c
+ * @author Hayden Lauritzen (haydenlauritzen@gmail.com)
+ * @date 2023-1-16
+ *
+ * @copyright Copyright (c) 2023
+ *
+ */
+
+// Times the sweep solver's building blocks one at a time on fixed boards
+// of every square size. Built on its own by microbench.sh, since src/
+// already has a main.
+
+#include <fcntl.h>  // open()
+#include <time.h>   // clock_gettime()
+#include <unistd.h> // getopt(), dup2()
+#ifdef __linux__
+#include <linux/perf_event.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#endif
+
+#include "../inc/run.h"
+#include "../inc/session.h"
+#include "../inc/bitboard.h"
+#include "../inc/shape.h"
+
+// each sample runs for at least this long
+#define SAMPLE_NS 2000000L
+#define SAMPLES 11
+// boxes of 2x2 up to 15x15, 4x4 to 225x225 boards
+#define MIN_BOX 2
+#define MAX_BOX 15
+
+// the same board and search state for every run of a size
+typedef struct benchInput_t {
+    int psize;
+    num_t** grid;       // a solved board with about half its cells blanked
+    missing_t* missing;
+    smallestSolve_t subset;
+    bool hasSubset;     // false if no unit is missing two or more
+    cell_t cell;        // the first blank cell
+    int gridIdx;
+    savedPos_t* saved;
+    char* text;         // grid as a puzzle file
+    session_t* session; // grid kept for edits
+    latency_t* latency; // histograms with no dump file
+    solvepuzzle_t* units; // every row, column and box, for solveUnit
+    bitboard_t board;   // grid by digit, 9x9 only
+    size_t textLen;
+    arena_t* arena;
+    long sink;          // results go here so calls aren't optimized away
+} benchInput_t;
+
+typedef struct kernel_t {
+    const char* name;
+    void (*run)(benchInput_t* in, long ops);
+} kernel_t;
+
+// hardware counters for instructions and cycles, -1 where there are none
+typedef struct counters_t {
+    int instructions;
+    int cycles;
+} counters_t;
+
+static long nowNs(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec * 1000000000L + ts.tv_nsec;
+}
+
+static void benchGridIdx(benchInput_t* in, long ops) {
+    int psize = in->psize;
+    const shape_t* shape = getShape(psize, in->grid);
+    for (long i = 0; i < ops; ++i) {
+        in->sink += getGridIdx(i % psize + 1, (i / psize) % psize + 1, shape);
+    }
+}
+
+static void benchSolveCell(benchInput_t* in, long ops) {
+    for (long i = 0; i < ops; ++i) {
+        arenaMark_t mark = arenaMark(in->arena);
+        int* moves = solveCell(in->cell.row, in->cell.col, in->gridIdx, in->psize, in->grid, in->arena);
+        in->sink += moves[0];
+        arenaRelease(in->arena, mark);
+    }
+}
+
+static void benchCheckPuzzle(benchInput_t* in, long ops) {
+    for (long i = 0; i < ops; ++i) {
+        arenaMark_t mark = arenaMark(in->arena);
+        bool complete, valid;
+        missing_t* missing = checkPuzzle(in->psize, in->grid, &complete, &valid, in->arena);
+        in->sink += missing[0].rows + valid;
+        arenaRelease(in->arena, mark);
+    }
+}
+
+static void benchPrefilter(benchInput_t* in, long ops) {
+    for (long i = 0; i < ops; ++i) {
+        rejection_t rejection;
+        in->sink += prefilter(in->psize, in->grid, &rejection, in->arena);
+    }
+}
+
+static void benchSavePos(benchInput_t* in, long ops) {
+    for (long i = 0; i < ops; ++i) {
+        arenaMark_t mark = arenaMark(in->arena);
+        savedPos_t* saved = savePos(in->grid, in->missing, in->psize, in->arena);
+        in->sink += saved->grid[in->psize + 2];
+        arenaRelease(in->arena, mark);
+    }
+}
+
+static void benchUndoMove(benchInput_t* in, long ops) {
+    // restores the board it was saved from, so every call does the same work
+    for (long i = 0; i < ops; ++i) {
+        undoMove(in->saved, in->grid, in->missing, in->psize);
+        in->sink += in->grid[1][1];
+    }
+}
+
+static void benchZobristBoard(benchInput_t* in, long ops) {
+    for (long i = 0; i < ops; ++i) {
+        in->sink += (long)(zobristBoard(in->psize, in->grid) & 1);
+    }
+}
+
+static void benchSetCell(benchInput_t* in, long ops) {
+    // fills the first blank and clears it again, so every pair is the same work
+    for (long i = 0; i < ops; ++i) {
+        setCell(in->session, in->cell.row, in->cell.col, (i & 1) ? 0 : 1);
+        in->sink += in->session->deadCells;
+    }
+    setCell(in->session, in->cell.row, in->cell.col, 0);
+}
+
+static void benchNextHint(benchInput_t* in, long ops) {
+    for (long i = 0; i < ops; ++i) {
+        hint_t hint = nextHint(in->session);
+        in->sink += hint.num;
+    }
+}
+
+static void benchRecordLatency(benchInput_t* in, long ops) {
+    // spread over a few hundred buckets, as real solve times would be
+    for (long i = 0; i < ops; ++i) {
+        recordLatency(in->latency, in->psize, LATENCY_VERIFY, (i & 1023) * 997);
+    }
+}
+
+static void benchSolveUnit(benchInput_t* in, long ops) {
+    // one sweep round's scan of every unit, the work bitboardDeduce replaces
+    int psize = in->psize;
+    for (long i = 0; i < ops; ++i) {
+        for (int u = 0; u < 3 * psize; ++u) {
+            memset(in->units[u].numCount, 0, sizeof(bool) * (psize + 1));
+            solveUnit(&in->units[u]);
+            in->sink += in->units[u].num;
+        }
+    }
+}
+
+static void benchBitboardDeduce(benchInput_t* in, long ops) {
+    bitMove_t moves[BITBOARD_CELLS];
+    for (long i = 0; i < ops; ++i) {
+        bitboard_t board = in->board;
+        in->sink += bitboardDeduce(&board, moves);
+    }
+}
+
+static void benchLoadBitboard(benchInput_t* in, long ops) {
+    for (long i = 0; i < ops; ++i) {
+        bitboard_t board;
+        in->sink += loadBitboard(&board, in->grid);
+    }
+}
+
+static void benchSmallestSolve(benchInput_t* in, long ops) {
+    for (long i = 0; i < ops; ++i) {
+        arenaMark_t mark = arenaMark(in->arena);
+        smallestSolve_t* subset = getSmallestSolve(in->missing, in->psize, in->arena);
+        in->sink += subset->idx;
+        arenaRelease(in->arena, mark);
+    }
+}
+
+static void benchSelectCell(benchInput_t* in, long ops) {
+    for (long i = 0; i < ops; ++i) {
+        arenaMark_t mark = arenaMark(in->arena);
+        cell_t* cell = selectCell(&in->subset, in->psize, in->grid, in->arena);
+        in->sink += cell->row;
+        arenaRelease(in->arena, mark);
+    }
+}
+
+static void benchParse(benchInput_t* in, long ops) {
+    for (long i = 0; i < ops; ++i) {
+        FILE* fp = fmemopen(in->text, in->textLen, "r");
+        num_t** grid = NULL;
+        int psize = readSudokuStream(fp, "bench", &grid);
+        in->sink += grid[1][1];
+        deleteSudokuPuzzle(psize, grid);
+        fclose(fp);
+    }
+}
+
+static void benchPrint(benchInput_t* in, long ops) {
+    // stdout goes to /dev/null while printing
+    fflush(stdout);
+    int saved = dup(STDOUT_FILENO);
+    int devNull = open("/dev/null", O_WRONLY);
+    dup2(devNull, STDOUT_FILENO);
+    for (long i = 0; i < ops; ++i) {
+        printSudokuPuzzle(in->psize, in->grid);
+    }
+    fflush(stdout);
+    dup2(saved, STDOUT_FILENO);
+    close(devNull);
+    close(saved);
+}
+
+static kernel_t kernels[] = {
+    { "getGridIdx", benchGridIdx },
+    { "solveCell", benchSolveCell },
+    { "checkPuzzle", benchCheckPuzzle },
+    { "prefilter", benchPrefilter },
+    { "savePos", benchSavePos },
+    { "undoMove", benchUndoMove },
+    { "zobristBoard", benchZobristBoard },
+    { "setCell", benchSetCell },
+    { "nextHint", benchNextHint },
+    { "recordLatency", benchRecordLatency },
+    { "solveUnit", benchSolveUnit },
+    { "bitboardDeduce", benchBitboardDeduce },
+    { "loadBitboard", benchLoadBitboard },
+    { "getSmallestSolve", benchSmallestSolve },
+    { "selectCell", benchSelectCell },
+    { "parse", benchParse },
+    { "print", benchPrint },
+};
+#define NUM_KERNELS (int)(sizeof(kernels) / sizeof(kernels[0]))
+
+static void createInput(benchInput_t* in, int box) {
+    int psize = box * box;
+    memset(in, 0, sizeof(benchInput_t));
+    in->psize = psize;
+    size_t bound = solveArenaSize(psize);
+    in->arena = createArena(bound < ARENA_START_MAX ? bound : ARENA_START_MAX);
+    in->grid = createSudokuPuzzle(psize);
+    // a shifted pattern is always a solved board; blanks come from a fixed lcg
+    unsigned long lcg = 12345;
+    for (int r = 0; r < psize; ++r) {
+        for (int c = 0; c < psize; ++c) {
+            lcg = lcg * 6364136223846793005UL + 1442695040888963407UL;
+            bool blank = (lcg >> 33) % 100 < 50;
+            in->grid[r + 1][c + 1] = blank ? 0 : (num_t)(((r % box) * box + r / box + c) % psize + 1);
+        }
+    }
+    // missing counts live in malloc so the arena stays empty between calls
+    arenaMark_t mark = arenaMark(in->arena);
+    bool complete, valid;
+    missing_t* missing = checkPuzzle(psize, in->grid, &complete, &valid, in->arena);
+    in->missing = (missing_t*)malloc(sizeof(missing_t) * psize);
+    memcpy(in->missing, missing, sizeof(missing_t) * psize);
+    arenaRelease(in->arena, mark);
+    for (int i = 0; i < psize && !in->hasSubset; ++i) {
+        if (in->missing[i].rows > 1) {
+            in->subset = (smallestSolve_t){ rows, i + 1 };
+            in->hasSubset = true;
+        }
+    }
+    for (int r = 1; r <= psize && in->cell.row == 0; ++r) {
+        for (int c = 1; c <= psize && in->cell.row == 0; ++c) {
+            if (in->grid[r][c] == 0) in->cell = (cell_t){ r, c };
+        }
+    }
+    if (in->cell.row == 0) in->cell = (cell_t){ 1, 1 };
+    in->gridIdx = getGridIdx(in->cell.row, in->cell.col, getShape(psize, in->grid));
+    in->saved = (savedPos_t*)malloc(sizeof(savedPos_t));
+    in->saved->grid = (num_t*)malloc(sizeof(num_t) * (psize + 1) * (psize + 1));
+    in->saved->missing = (missing_t*)malloc(sizeof(missing_t) * psize);
+    memcpy(in->saved->grid, in->grid[0], sizeof(num_t) * (psize + 1) * (psize + 1));
+    memcpy(in->saved->missing, in->missing, sizeof(missing_t) * psize);
+    in->session = createSession(psize, in->grid);
+    in->latency = createLatency(NULL, 0);
+    in->units = (solvepuzzle_t*)calloc(3 * psize, sizeof(solvepuzzle_t));
+    for (int u = 0; u < 3 * psize; ++u) {
+        in->units[u].type = (enum subset)(u / psize);
+        in->units[u].idx = u % psize + 1;
+        in->units[u].psize = psize;
+        in->units[u].grid = in->grid;
+        in->units[u].shape = getShape(psize, in->grid);
+        in->units[u].numCount = (bool*)calloc(psize + 1, sizeof(bool));
+    }
+    if (psize == BITBOARD_PSIZE) loadBitboard(&in->board, in->grid);
+    // the puzzle as a file would hold it
+    FILE* fp = open_memstream(&in->text, &in->textLen);
+    fprintf(fp, "%d\n", psize);
+    for (int r = 1; r <= psize; ++r) {
+        for (int c = 1; c <= psize; ++c) {
+            fprintf(fp, "%d ", in->grid[r][c]);
+        }
+        fprintf(fp, "\n");
+    }
+    fclose(fp);
+}
+
+static void deleteInput(benchInput_t* in) {
+    deleteArena(in->arena);
+    deleteSudokuPuzzle(in->psize, in->grid);
+    free(in->missing);
+    free(in->saved->grid);
+    free(in->saved->missing);
+    free(in->saved);
+    free(in->text);
+    deleteSession(in->session);
+    deleteLatency(in->latency);
+    for (int u = 0; u < 3 * in->psize; ++u) {
+        free(in->units[u].numCount);
+    }
+    free(in->units);
+}
+
+#ifdef __linux__
+static int openCounter(unsigned long config) {
+    struct perf_event_attr attr;
+    memset(&attr, 0, sizeof(attr));
+    attr.type = PERF_TYPE_HARDWARE;
+    attr.size = sizeof(attr);
+    attr.config = config;
+    attr.disabled = 1;
+    attr.exclude_kernel = 1;
+    attr.exclude_hv = 1;
+    return (int)syscall(__NR_perf_event_open, &attr, 0, -1, -1, 0);
+}
+
+static void startCounter(int fd) {
+    if (fd < 0) return;
+    ioctl(fd, PERF_EVENT_IOC_RESET, 0);
+    ioctl(fd, PERF_EVENT_IOC_ENABLE, 0);
+}
+
+static long stopCounter(int fd) {
+    if (fd < 0) return 0;
+    ioctl(fd, PERF_EVENT_IOC_DISABLE, 0);
+    long long count = 0;
+    if (read(fd, &count, sizeof(count)) != sizeof(count)) return 0;
+    return (long)count;
+}
+#else
+#define PERF_COUNT_HW_CPU_CYCLES 0
+#define PERF_COUNT_HW_INSTRUCTIONS 1
+static int openCounter(unsigned long config) {
+    (void)config;
+    return -1;
+}
+static void startCounter(int fd) {
+    (void)fd;
+}
+static long stopCounter(int fd) {
+    (void)fd;
+    return 0;
+}
+#endif
+
+// prints one row: kernel psize ns/op stddev min instructions/op cycles/op
+static void runKernel(kernel_t* kernel, benchInput_t* in, counters_t* counters, long sampleNs) {
+    // grow the op count until a sample takes long enough to time
+    long ops = 1;
+    for (;;) {
+        long start = nowNs();
+        kernel->run(in, ops);
+        if (nowNs() - start >= sampleNs || ops >= (1L << 40)) break;
+        ops *= 2;
+    }
+    double samples[SAMPLES];
+    double sum = 0, best = 0;
+    long instructions = 0, cycles = 0;
+    for (int s = 0; s < SAMPLES; ++s) {
+        startCounter(counters->instructions);
+        startCounter(counters->cycles);
+        long start = nowNs();
+        kernel->run(in, ops);
+        long elapsed = nowNs() - start;
+        instructions += stopCounter(counters->instructions);
+        cycles += stopCounter(counters->cycles);
+        samples[s] = (double)elapsed / ops;
+        sum += samples[s];
+        if (s == 0 || samples[s] < best) best = samples[s];
+    }
+    double mean = sum / SAMPLES;
+    double var = 0;
+    for (int s = 0; s < SAMPLES; ++s) {
+        var += (samples[s] - mean) * (samples[s] - mean);
+    }
+    double stddev = sqrt(var / (SAMPLES - 1));
+    printf("%-16s %4d %12.1f %10.1f %12.1f", kernel->name, in->psize, mean, stddev, best);
+    if (counters->instructions >= 0) printf(" %12.1f", (double)instructions / (ops * SAMPLES));
+    else printf(" %12s", "-");
+    if (counters->cycles >= 0) printf(" %10.1f\n", (double)cycles / (ops * SAMPLES));
+    else printf(" %10s\n", "-");
+    fflush(stdout);
+}
+
+int main(int argc, char** argv) {
+    const char* only = NULL;
+    int maxPsize = MAX_BOX * MAX_BOX;
+    long sampleNs = SAMPLE_NS;
+    int opt;
+    while ((opt = getopt(argc, argv, "k:m:t:")) != -1) {
+        switch (opt) {
+        case 'k':
+            only = optarg;
+            break;
+        case 'm':
+            maxPsize = atoi(optarg);
+            break;
+        case 't':
+            sampleNs = (long)(atof(optarg) * 1000000);
+            break;
+        default:
+            printf("usage: ./kernels [-k kernel] [-m max_psize] [-t sample_ms]\n");
+            return EXIT_FAILURE;
+        }
+    }
+    // one thread, so the times are the kernels' and not the scheduler's
+    setWorkerCount(1);
+    counters_t counters;
+    counters.instructions = openCounter(PERF_COUNT_HW_INSTRUCTIONS);
+    counters.cycles = openCounter(PERF_COUNT_HW_CPU_CYCLES);
+    if (counters.instructions < 0) printf("# no hardware counters, instr/op and cycles/op are left blank\n");
+    printf("%-16s %4s %12s %10s %12s %12s %10s\n", "# kernel", "size", "ns/op", "stddev", "min", "instr/op", "cycles/op");
+    for (int box = MIN_BOX; box <= MAX_BOX && box * box <= maxPsize; ++box) {
+        benchInput_t in;
+        createInput(&in, box);
+        for (int k = 0; k < NUM_KERNELS; ++k) {
+            if (only && strcmp(only, kernels[k].name) != 0) continue;
+            if (kernels[k].run == benchSelectCell && !in.hasSubset) continue;
+            bool bitboard = kernels[k].run == benchBitboardDeduce || kernels[k].run == benchLoadBitboard;
+            if (bitboard && in.psize != BITBOARD_PSIZE) continue;
+            runKernel(&kernels[k], &in, &counters, sampleNs);
+        }
+        deleteInput(&in);
+    }
+    if (counters.instructions >= 0) close(counters.instructions);
+    if (counters.cycles >= 0) close(counters.cycles);
+    return EXIT_SUCCESS;
+}
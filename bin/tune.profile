@@ -0,0 +1,10 @@
+# tuned on 25 puzzles: 3744.4/s, p99 0.160ms (defaults 3127.5/s, p99 0.182ms)
+workers 1
+sweep_threads 1
+ring 16
+batch 0
+interleave 1
+# max_psize min_clues max_density min_singles engine
+route 4 0 1 0 sweep
+route 9 0 1 0 prop
+route 16 0 1 0 prop
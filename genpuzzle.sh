@@ -0,0 +1,40 @@
+#!/bin/bash
+
+# Script to generate a solvable puzzle
+# usage: ./genpuzzle.sh box_size blank_percent [seed] > puzzle.txt
+# a box_size of 10 gives a 100x100 puzzle
+# starts from a pattern solution, shuffles digits, rows within bands,
+# bands, cols within stacks and stacks, then blanks cells at random
+if [ $# -lt 2 ]; then
+    echo "usage: ./genpuzzle.sh box_size blank_percent [seed]" >&2
+    exit 1
+fi
+awk -v b="$1" -v blank="$2" -v seed="${3:-1}" '
+function shuffle(a, lo, n,    i, j, t) {
+    for (i = n - 1; i > 0; --i) {
+        j = int(rand() * (i + 1))
+        t = a[lo + i]; a[lo + i] = a[lo + j]; a[lo + j] = t
+    }
+}
+BEGIN {
+    srand(seed)
+    n = b * b
+    for (i = 0; i < n; ++i) { digit[i] = i + 1; row[i] = i; col[i] = i }
+    shuffle(digit, 0, n)
+    for (i = 0; i < b; ++i) { band[i] = i; stack[i] = i }
+    shuffle(band, 0, b)
+    shuffle(stack, 0, b)
+    for (i = 0; i < b; ++i) { shuffle(row, i * b, b); shuffle(col, i * b, b) }
+    print n
+    for (r = 0; r < n; ++r) {
+        sr = band[int(r / b)] * b + row[r] % b
+        line = ""
+        for (c = 0; c < n; ++c) {
+            sc = stack[int(c / b)] * b + col[c] % b
+            num = digit[(b * (sr % b) + int(sr / b) + sc) % n]
+            if (rand() * 100 < blank) num = 0
+            line = line num " "
+        }
+        print line
+    }
+}'
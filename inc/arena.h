@@ -0,0 +1,55 @@
+/**
+ * @file arena.h
+ * @author Hayden Lauritzen (haydenlauritzen@gmail.com)
+ * @date 2023-1-16
+ *
+ * @copyright Copyright (c) 2023
+ *
+ */
+
+#ifndef ARENA_H
+#define ARENA_H
+
+#include <stddef.h> // size_t
+
+ /**
+ *  Arena
+ * Bump allocator for everything a solve needs. Memory is handed out
+ * from one block by moving an offset forward; nothing is freed on its
+ * own. A search node takes a mark on entry and releases back to it on
+ * exit, and the whole arena is reset in O(1) after each puzzle.
+ *
+ * If a block runs out another one is chained on, so a bad size guess
+ * costs a malloc rather than a crash. Blocks are kept across resets.
+*/
+
+typedef struct arenaBlock_t {
+  struct arenaBlock_t* next;
+  size_t size;
+  size_t used;
+  char* data;
+} arenaBlock_t;
+
+typedef struct arena_t {
+  arenaBlock_t* first;
+  arenaBlock_t* current;
+  size_t inUse;    // bytes handed out since the last reset
+  size_t peak;     // largest inUse since the last reset
+  size_t capacity; // bytes across all blocks
+} arena_t;
+
+// position to release back to
+typedef struct arenaMark_t {
+  arenaBlock_t* block;
+  size_t used;
+  size_t inUse;
+} arenaMark_t;
+
+arena_t* createArena(size_t size); // returns malloc!
+void* arenaAlloc(arena_t* arena, size_t bytes); // zeroed, 16 byte aligned
+arenaMark_t arenaMark(arena_t* arena);
+void arenaRelease(arena_t* arena, arenaMark_t mark);
+void arenaReset(arena_t* arena);
+void deleteArena(arena_t* arena);
+
+#endif // ARENA_H
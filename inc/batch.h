@@ -0,0 +1,74 @@
+/**
+ * @file batch.h
+ * @author Hayden Lauritzen (haydenlauritzen@gmail.com)
+ * @date 2023-1-16
+ *
+ * @copyright Copyright (c) 2023
+ *
+ */
+
+#ifndef BATCH_H
+#define BATCH_H
+
+#include "sudoku.h"
+
+ /**
+ *  Batch Lanes
+ * Propagates up to BATCH_LANES small puzzles of one size at once. The
+ * candidates are stored structure-of-arrays: for every cell, one 16 bit
+ * mask per lane, side by side. Each step of naked and hidden singles is
+ * the same masks and compares on every lane with no branches, so the
+ * lane loops compile to vector code (16 lanes of 16 bits is one AVX2
+ * register, half an AVX-512 one) and to plain loops everywhere else.
+ * Build with -O2 -march=native to get the wide instructions.
+ *
+ * Lanes run until none of them changes. A lane that is then full is
+ * solved; one that needs a guess is left for the scalar engines.
+ * Boards up to 16x16 with their size's default box shape fit (a batch
+ * holds one set of unit tables per size), others are never batched.
+*/
+
+#define BATCH_LANES 16
+#define BATCH_MAX_PSIZE 16
+
+typedef enum laneStatus_e {
+  LANE_OPEN,   // singles ran out, a guess is needed
+  LANE_SOLVED,
+  LANE_FAILED  // no solution
+} laneStatus_e;
+
+typedef struct batch_t {
+  int psize;
+  int cells;       // psize * psize
+  int lanes;       // lanes loaded since the last batchClear
+  int* units;      // 3 * psize units of psize cells: rows, columns, boxes
+  uint16_t* cand;  // cells * BATCH_LANES, lane masks of a cell side by side
+  uint16_t failed[BATCH_LANES]; // 0xFFFF once a lane hits a contradiction
+  long loaded;     // stats over every batch run
+  long solved;
+  long open;
+  long unsolvable;
+  long passes;
+} batch_t;
+
+// true for the boards batch lanes can hold
+bool batchFits(int psize, num_t** grid);
+
+batch_t* createBatch(int psize); // returns malloc! psize must fit
+void deleteBatch(batch_t* batch);
+
+// empties every lane
+void batchClear(batch_t* batch);
+
+// copies grid into the next lane, returns the lane
+int batchLoad(batch_t* batch, num_t** grid);
+
+// propagates every loaded lane until none changes
+void batchPropagate(batch_t* batch);
+
+// fills every decided cell of lane into grid; leaves grid alone if the lane failed
+laneStatus_e batchStore(batch_t* batch, int lane, num_t** grid);
+
+void printBatchStats(batch_t* batch);
+
+#endif // BATCH_H
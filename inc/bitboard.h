@@ -0,0 +1,63 @@
+/**
+ * @file bitboard.h
+ * @author Hayden Lauritzen (haydenlauritzen@gmail.com)
+ * @date 2023-1-16
+ *
+ * @copyright Copyright (c) 2023
+ *
+ */
+
+#ifndef BITBOARD_H
+#define BITBOARD_H
+
+#include "sudoku.h"
+
+ /**
+ *  Bitboards
+ * A digit-major view of a 9x9 board kept beside grid: for every digit, a
+ * 128-bit board of the cells where it can still go, bit (row - 1) * 9 +
+ * (col - 1). Every row, column and box, and the peers of every cell, are
+ * 128-bit masks made once, so a unit's rule for one digit is an AND and a
+ * popcount:
+ *  - no place: cand[d] & unit is empty while d isn't placed in the unit
+ *  - hidden single: cand[d] & unit has one bit
+ *  - pointing / claiming: cand[d] & box fits in one row or column, or
+ *    cand[d] & row or column fits in one box, and d goes from the rest
+ * and naked singles come out of all nine boards at once, as the cells
+ * set in exactly one of them.
+ *
+ * The sweep keeps one with 9x9 boards and makes its moves with placeMove,
+ * which updates both; scan based solveUnit is used for other sizes.
+*/
+
+#define BITBOARD_PSIZE 9
+#define BITBOARD_CELLS (BITBOARD_PSIZE * BITBOARD_PSIZE)
+
+typedef unsigned __int128 bits81_t;
+
+typedef struct bitboard_t {
+  bits81_t cand[BITBOARD_PSIZE + 1];   // empty cells each digit can go in
+  bits81_t placed[BITBOARD_PSIZE + 1]; // cells holding each digit
+  bits81_t empty;
+} bitboard_t;
+
+// a cell bitboardDeduce found the number of, all 1-indexed
+typedef struct bitMove_t {
+  int row;
+  int col;
+  int num;
+} bitMove_t;
+
+// fills board from a 9x9 grid, returns false if two givens clash
+bool loadBitboard(bitboard_t* board, num_t** grid);
+
+// true if num can still go in the cell, 1-indexed
+bool bitboardFits(bitboard_t* board, int row, int col, int num);
+void bitboardPlace(bitboard_t* board, int row, int col, int num);
+
+// writes the singles it finds to moves, at most one per cell, after
+// taking out what pointing and claiming can; returns how many, 0 if
+// nothing is left to find and -1 if the board has no solution
+int bitboardDeduce(bitboard_t* board, bitMove_t* moves);
+
+#endif // BITBOARD_H
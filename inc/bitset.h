@@ -0,0 +1,144 @@
+/**
+ * @file bitset.h
+ * @author Hayden Lauritzen (haydenlauritzen@gmail.com)
+ * @date 2023-1-16
+ *
+ * @copyright Copyright (c) 2023
+ *
+ */
+
+#ifndef BITSET_H
+#define BITSET_H
+
+#include <stdbool.h> // bool
+#include <stdint.h>  // uint64_t
+
+ /**
+ *  Bitset
+ * A set of numbers from 0 to MASK_BITS - 1, bit n of words[n / 64] is
+ * number n. Sets are passed by value; every loop runs over a fixed
+ * MASK_WORDS so the compiler can unroll it.
+ *
+ * MASK_WORDS * 64 must be above MAX_PSIZE.
+*/
+
+#define MASK_WORDS 4
+#define MASK_BITS (MASK_WORDS * 64)
+
+typedef struct mask_t {
+  uint64_t words[MASK_WORDS];
+} mask_t;
+
+// numbers 1 to psize
+static inline mask_t maskAll(int psize) {
+    mask_t mask;
+    for (int w = 0; w < MASK_WORDS; ++w) {
+        int low = w * 64;
+        if (psize + 1 >= low + 64) mask.words[w] = ~(uint64_t)0;
+        else if (psize + 1 <= low) mask.words[w] = 0;
+        else mask.words[w] = ((uint64_t)1 << (psize + 1 - low)) - 1;
+    }
+    mask.words[0] &= ~(uint64_t)1;
+    return mask;
+}
+
+static inline mask_t maskNone(void) {
+    mask_t mask = { { 0 } };
+    return mask;
+}
+
+static inline mask_t maskBit(int num) {
+    mask_t mask = { { 0 } };
+    mask.words[num >> 6] = (uint64_t)1 << (num & 63);
+    return mask;
+}
+
+static inline bool maskTest(mask_t mask, int num) {
+    return (mask.words[num >> 6] >> (num & 63)) & 1;
+}
+
+static inline void maskSet(mask_t* mask, int num) {
+    mask->words[num >> 6] |= (uint64_t)1 << (num & 63);
+}
+
+static inline void maskClear(mask_t* mask, int num) {
+    mask->words[num >> 6] &= ~((uint64_t)1 << (num & 63));
+}
+
+static inline mask_t maskOr(mask_t a, mask_t b) {
+    for (int w = 0; w < MASK_WORDS; ++w) {
+        a.words[w] |= b.words[w];
+    }
+    return a;
+}
+
+static inline mask_t maskAnd(mask_t a, mask_t b) {
+    for (int w = 0; w < MASK_WORDS; ++w) {
+        a.words[w] &= b.words[w];
+    }
+    return a;
+}
+
+// numbers in a but not in b
+static inline mask_t maskAndNot(mask_t a, mask_t b) {
+    for (int w = 0; w < MASK_WORDS; ++w) {
+        a.words[w] &= ~b.words[w];
+    }
+    return a;
+}
+
+static inline bool maskEmpty(mask_t mask) {
+    uint64_t any = 0;
+    for (int w = 0; w < MASK_WORDS; ++w) {
+        any |= mask.words[w];
+    }
+    return any == 0;
+}
+
+static inline bool maskEquals(mask_t a, mask_t b) {
+    uint64_t diff = 0;
+    for (int w = 0; w < MASK_WORDS; ++w) {
+        diff |= a.words[w] ^ b.words[w];
+    }
+    return diff == 0;
+}
+
+static inline int maskCount(mask_t mask) {
+    int count = 0;
+    for (int w = 0; w < MASK_WORDS; ++w) {
+        count += __builtin_popcountll(mask.words[w]);
+    }
+    return count;
+}
+
+// true if exactly one number is set
+static inline bool maskSingle(mask_t mask) {
+    int words = 0;
+    bool single = true;
+    for (int w = 0; w < MASK_WORDS; ++w) {
+        if (mask.words[w] == 0) continue;
+        ++words;
+        single = single && (mask.words[w] & (mask.words[w] - 1)) == 0;
+    }
+    return words == 1 && single;
+}
+
+// how many numbers in the set are below num
+static inline int maskRank(mask_t mask, int num) {
+    int rank = 0;
+    for (int w = 0; w < (num >> 6); ++w) {
+        rank += __builtin_popcountll(mask.words[w]);
+    }
+    if (num & 63) rank += __builtin_popcountll(mask.words[num >> 6] << (64 - (num & 63)));
+    return rank;
+}
+
+// smallest number in the set, -1 if empty
+static inline int maskFirst(mask_t mask) {
+    for (int w = 0; w < MASK_WORDS; ++w) {
+        if (mask.words[w]) return w * 64 + __builtin_ctzll(mask.words[w]);
+    }
+    return -1;
+}
+
+#endif // BITSET_H
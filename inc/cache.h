@@ -0,0 +1,87 @@
+/**
+ * @file cache.h
+ * @author Hayden Lauritzen (haydenlauritzen@gmail.com)
+ * @date 2023-1-16
+ *
+ * @copyright Copyright (c) 2023
+ *
+ */
+
+#ifndef CACHE_H
+#define CACHE_H
+
+#include "sudoku.h"
+
+ /**
+ *  Canonical Form
+ * Two puzzles are equivalent if one can be turned into the other by
+ *  - relabeling the digits
+ *  - transposing the grid
+ *  - permuting the bands (rows of boxes) or stacks (columns of boxes)
+ *  - permuting the rows inside a band or the columns inside a stack
+ * The canonical form is the lexicographically smallest relabeled grid
+ * (read row by row, 0 before any digit) over all of these transforms.
+ *
+ * Boards larger than 9x9 only search band/stack permutations, the full
+ * group is too large to walk. This still gives a valid form, some
+ * variants just map to a different key. Bands are a box's rows and
+ * stacks a box's columns, so only square boxes are transposed; a board
+ * whose boxes are rows (1 x psize) is only relabeled. The box shape is
+ * part of the key.
+*/
+
+// transform taking a puzzle to its canonical form
+// canonical cell (r, c) is source cell (rowMap[r], colMap[c]),
+// read from the transposed grid when transposed is set
+typedef struct canon_t {
+  int psize;
+  int boxRows;  // grid[0][0], 0 for the default shape
+  bool transposed;
+  int* rowMap;  // 1-indexed, like grid
+  int* colMap;  // 1-indexed, like grid
+  int* label;   // label[num] = canonical digit for num
+  num_t* key;   // canonical puzzle, psize * psize row-major
+  unsigned long hash;
+} canon_t;
+
+typedef struct cacheEntry_t {
+  int psize;
+  int boxRows;
+  unsigned long hash;
+  num_t* key;      // canonical puzzle
+  num_t* solution; // solution of the canonical puzzle
+  struct cacheEntry_t* next;   // bucket chain
+  struct cacheEntry_t* newer;  // lru list
+  struct cacheEntry_t* older;  // lru list
+} cacheEntry_t;
+
+typedef struct cache_t {
+  int capacity;
+  int size;
+  int numBuckets;
+  cacheEntry_t** buckets;
+  cacheEntry_t* newest;
+  cacheEntry_t* oldest;
+  long hits;
+  long misses;
+  long evictions;
+} cache_t;
+
+// finds the canonical form of the puzzle
+canon_t* canonicalize(int psize, num_t** grid); // returns malloc!
+void deleteCanon(canon_t* canon);
+
+// capacity is the number of solutions kept before the least recently
+// used one is evicted
+cache_t* createCache(int capacity); // returns malloc!
+
+// on a hit the solution is mapped back and written into grid
+bool cacheLookup(cache_t* cache, canon_t* canon, num_t** grid);
+
+// stores the solution of the puzzle canon was made from
+void cacheInsert(cache_t* cache, canon_t* canon, num_t** solution);
+
+void printCacheStats(cache_t* cache);
+void deleteCache(cache_t* cache);
+
+#endif // CACHE_H
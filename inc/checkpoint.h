@@ -0,0 +1,68 @@
+/**
+ * @file checkpoint.h
+ * @author Hayden Lauritzen (haydenlauritzen@gmail.com)
+ * @date 2023-1-16
+ *
+ * @copyright Copyright (c) 2023
+ *
+ */
+
+#ifndef CHECKPOINT_H
+#define CHECKPOINT_H
+
+#include "sudoku.h"
+#include "deadend.h"
+
+ /**
+ *  Checkpoints
+ * A long sweep search writes its whole frontier to a file now and then:
+ * the board, every frame on the guess stack with the moves it has left
+ * and the position to undo to, and the search counters. A later run on
+ * the same puzzle picks the search up from the file instead of starting
+ * over. The file is removed once the search ends.
+ *
+ * File layout, native byte order:
+ *   "SDKCKPT1", hash of the puzzle as given, psize, status, depth,
+ *   maxDepth, guesses, board, missing counts, then per frame
+ *   row, col, gridIdx, next, number of moves, moves, saved board,
+ *   saved missing counts
+ * Boards are rows 1 to psize of psize + 1 num_t, missing counts
+ * 3 * psize int32.
+ *
+ * A checkpoint is written at most every interval seconds, and never
+ * sooner than CHECKPOINT_RATIO times the last write took, so writing
+ * stays under 1 / CHECKPOINT_RATIO of the run however slow the disk is.
+*/
+
+// search time per second of writing, at least
+#define CHECKPOINT_RATIO 100
+
+typedef struct checkpoint_t {
+  char* filename;
+  double interval;    // seconds between checkpoints
+  long writes;
+  long bytes;         // size of the last checkpoint
+  double writeTime;   // seconds spent writing
+  double searchTime;  // seconds spent in the search
+  long resumes;       // searches picked up from a file
+} checkpoint_t;
+
+checkpoint_t* createCheckpoint(const char* filename, double interval); // returns malloc!
+void deleteCheckpoint(checkpoint_t* checkpoint);
+
+// solvePuzzle, resuming from and saving to the checkpoint file
+bool solveWithCheckpoints(checkpoint_t* checkpoint, missing_t* missingNums, int psize, num_t** grid, deadEnds_t* deadEnds, arena_t* arena);
+
+// returns bytes written, 0 on failure
+long saveSearch(search_t* search, unsigned long hash, const char* filename);
+
+// restores grid, missingNums and the guess stack from filename,
+// returns NULL if there is no file or it is for another puzzle
+search_t* loadSearch(const char* filename, unsigned long hash, missing_t* missingNums, int psize, num_t** grid, arena_t* arena); // returns arena memory
+
+// FNV-1a of the cells of a puzzle
+unsigned long puzzleHash(int psize, num_t** grid);
+
+void printCheckpointStats(checkpoint_t* checkpoint);
+
+#endif // CHECKPOINT_H
@@ -0,0 +1,60 @@
+/**
+ * @file deadend.h
+ * @author Hayden Lauritzen (haydenlauritzen@gmail.com)
+ * @date 2023-1-16
+ *
+ * @copyright Copyright (c) 2023
+ *
+ */
+
+#ifndef DEADEND_H
+#define DEADEND_H
+
+#include "sudoku.h"
+
+ /**
+ *  Dead End Table
+ * The sweep can reach one board through guesses made in different
+ * orders. Once every guess on a board has failed, the board's hash goes
+ * in this table and the search never goes into that board again.
+ *
+ * A board is hashed Zobrist style: each (row, col, num) has its own
+ * random 64 bit key, and the hash is the xor of the keys of the filled
+ * cells (and one for the board size). Filling a cell is one xor, and an
+ * undo puts back the hash saved with the guess. Keys are mixed from the
+ * cell and number on demand; a table of them for 255x255 would be 130MB.
+ *
+ * Whether a board can be finished depends only on the board, so one
+ * table serves every puzzle of a run and all the pipeline workers.
+ * Slots are atomic 64 bit hashes with no locks. A lookup reads the
+ * DEADEND_PROBE slots after the hash's home slot, an insert takes the
+ * first empty one or writes over the home slot. Entries can be lost to
+ * racing inserts, which only costs a repeat search. Two boards sharing a
+ * hash would make the search skip a live board; across 2^64 hashes that
+ * is left to chance.
+*/
+
+// slots looked at for one hash
+#define DEADEND_PROBE 4
+// smaller searched out boards are cheaper to search again than to store
+#define DEADEND_MIN_GUESSES 8
+
+typedef struct deadEnds_t {
+  _Atomic uint64_t* slots; // 0 is empty
+  size_t mask;             // slots - 1, slots is a power of 2
+  atomic_long hits;
+  atomic_long misses;
+  atomic_long inserts;
+} deadEnds_t;
+
+// holds at least entries hashes
+deadEnds_t* createDeadEnds(size_t entries); // returns malloc!
+void deleteDeadEnds(deadEnds_t* deadEnds);
+
+// true if hash was recorded as a dead end, counts a hit or miss
+bool isDeadEnd(deadEnds_t* deadEnds, uint64_t hash);
+void addDeadEnd(deadEnds_t* deadEnds, uint64_t hash);
+
+void printDeadEndStats(deadEnds_t* deadEnds);
+
+#endif // DEADEND_H
@@ -0,0 +1,70 @@
+/**
+ * @file dispatch.h
+ * @author Hayden Lauritzen (haydenlauritzen@gmail.com)
+ * @date 2023-1-16
+ *
+ * @copyright Copyright (c) 2023
+ *
+ */
+
+#ifndef DISPATCH_H
+#define DISPATCH_H
+
+#include "engine.h"
+
+ /**
+ *  Dispatcher
+ * Looks at a few cheap features of a parsed puzzle and picks the engine
+ * from a routing table. The first route the puzzle fits wins.
+ *
+ * A routing table file has one route per line, '#' starts a comment:
+ *   max_psize min_clues max_density min_singles engine
+ * max_psize may be '*' for any size. clues and singles are fractions of
+ * all cells and of the empty cells, density is the mean number of
+ * candidates of an empty cell over psize.
+*/
+
+typedef struct features_t {
+  int psize;
+  int clues;          // filled cells
+  int singles;        // empty cells with one candidate
+  double clueRatio;   // clues / cells
+  double density;     // mean candidates per empty cell / psize
+  double singleRatio; // singles / empty cells
+} features_t;
+
+typedef struct route_t {
+  int maxPsize;       // 0 is any size
+  double minClues;
+  double maxDensity;
+  double minSingles;
+  engine_e engine;
+} route_t;
+
+typedef struct dispatcher_t {
+  route_t* routes;
+  int numRoutes;
+  long picks[NUM_ENGINES];  // puzzles sent to each engine
+  long solved[NUM_ENGINES]; // of those, how many were solved
+} dispatcher_t;
+
+dispatcher_t* createDispatcher(void); // returns malloc! uses the default table
+
+// replaces the routing table, returns false if the file can't be used
+bool loadRoutes(dispatcher_t* dispatcher, const char* filename);
+// one line of a table, comment and all; returns 1 for a route, 0 for a
+// blank line and -1 if it isn't a route
+int parseRoute(char* line, route_t* route);
+// routes that are tried before the current ones
+void prependRoutes(dispatcher_t* dispatcher, route_t* routes, int count);
+
+void getFeatures(int psize, num_t** grid, features_t* features, arena_t* arena);
+
+// picks an engine and counts the pick
+engine_e dispatch(dispatcher_t* dispatcher, features_t* features);
+
+void printFeatures(features_t* features, engine_e engine);
+void printDispatchStats(dispatcher_t* dispatcher);
+void deleteDispatcher(dispatcher_t* dispatcher);
+
+#endif // DISPATCH_H
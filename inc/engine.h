@@ -0,0 +1,48 @@
+/**
+ * @file engine.h
+ * @author Hayden Lauritzen (haydenlauritzen@gmail.com)
+ * @date 2023-1-16
+ *
+ * @copyright Copyright (c) 2023
+ *
+ */
+
+#ifndef ENGINE_H
+#define ENGINE_H
+
+#include "sudoku.h"
+#include "checkpoint.h"
+
+ /**
+ *  Engines
+ * sweep - solvePuzzle; threaded row/col/box sweeps, then guesses
+ * prop  - propagateSolve; naked and hidden singles, then guesses
+ * sat   - satSolvePuzzle; CDCL over cell/number variables, for big boards
+ * portfolio races several of them at once, see portfolio.h
+*/
+
+typedef enum engine_e {
+  ENGINE_SWEEP,
+  ENGINE_PROP,
+  ENGINE_SAT,
+  NUM_ENGINES,
+  ENGINE_AUTO = NUM_ENGINES, // let the dispatcher pick
+  ENGINE_PORTFOLIO          // race several engines and seeds
+} engine_e;
+
+const char* engineName(engine_e engine);
+
+// returns ENGINE_AUTO for "auto", ENGINE_PORTFOLIO for "portfolio",
+// -1 if the name is unknown
+int parseEngine(const char* name);
+
+// solves grid in place, missing is the result of checkPuzzle
+// checkpoint and deadEnds may be NULL; only the sweep engine uses them
+// returns true if the puzzle ended complete and valid, prints nothing
+bool runEngine(engine_e engine, int psize, num_t** grid, missing_t* missing, checkpoint_t* checkpoint,
+    deadEnds_t* deadEnds, arena_t* arena);
+
+// what to say when runEngine returned false
+void printNoSolution(engine_e engine);
+
+#endif // ENGINE_H
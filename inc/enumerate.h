@@ -0,0 +1,71 @@
+/**
+ * @file enumerate.h
+ * @author Hayden Lauritzen (haydenlauritzen@gmail.com)
+ * @date 2023-1-16
+ *
+ * @copyright Copyright (c) 2023
+ *
+ */
+
+#ifndef ENUMERATE_H
+#define ENUMERATE_H
+
+#include "propagate.h"
+
+ /**
+ *  Enumeration
+ * Walks every solution of a board, empty or not, instead of stopping at
+ * the first. Solutions that are the same up to a symmetry of the board
+ * are written once, with the number of solutions they stand for.
+ *
+ * Symmetries are the transforms of the canonical form (cache.h) that
+ * leave the givens where they are:
+ *  - digits missing from the givens can be relabeled freely; the search
+ *    breaks this by only taking such a digit once every smaller one has
+ *    been placed, cells read row by row
+ *  - transposing, permuting bands and stacks and the rows and columns
+ *    inside them, each with the relabeling of the given digits it needs,
+ *    for 4x4 and 9x9 boards with at most ENUM_SYM_MAX such transforms;
+ *    a solution is kept only if no transform makes it smaller
+ * A kept solution stands for (transforms * free digits!) / its own
+ * symmetries solutions, so the multipliers add up to the full count.
+ *
+ * The first empty cells are filled breadth first into at least
+ * ENUM_TASKS per thread prefixes, and threads take prefixes in order
+ * and search the rest depth first. Each prefix's solutions are kept
+ * until every earlier prefix is written, so the output is the same
+ * whatever the number of threads. A prefix with more than 64KB of lines
+ * waits for its turn and then writes as it goes, so memory stays bounded
+ * and a board with too many solutions to finish still streams.
+ *
+ * A solution is one line, cells row by row then the multiplier:
+ *   1234341221434321 x96
+ * Boards up to 35x35 write a cell as one character, 1-9 then A-Z;
+ * bigger boards separate cells with spaces.
+*/
+
+// transforms kept beyond the relabeling of free digits
+#define ENUM_SYM_MAX 4096
+// prefixes made per thread, so a slow one doesn't hold the others up
+#define ENUM_TASKS 16
+// free digits relabeled at most, 20! still fits a long
+#define ENUM_MAX_FREE 20
+
+typedef struct enumStats_t {
+  long representatives; // lines written
+  long solutions;       // sum of their multipliers
+  long transforms;      // board symmetries kept, 1 is the identity
+  int freeDigits;       // digits relabeled freely
+  long relabelings;     // freeDigits!
+  int skippedFree;      // free digits left alone, more than ENUM_MAX_FREE
+  long tasks;           // prefixes searched
+  double elapsed;
+} enumStats_t;
+
+// writes a line per solution kept to out using threads threads,
+// returns false if the givens clash
+bool enumerateSolutions(int psize, num_t** grid, int threads, FILE* out, enumStats_t* stats);
+
+void printEnumStats(enumStats_t* stats, bool verbose);
+
+#endif // ENUMERATE_H
@@ -0,0 +1,84 @@
+/**
+ * @file latency.h
+ * @author Hayden Lauritzen (haydenlauritzen@gmail.com)
+ * @date 2023-1-16
+ *
+ * @copyright Copyright (c) 2023
+ *
+ */
+
+#ifndef LATENCY_H
+#define LATENCY_H
+
+#include "sudoku.h"
+#include "engine.h"
+
+ /**
+ *  Latency Histograms
+ * Every check and solve is timed into a histogram for its board size and
+ * what did the work: the check itself, an engine, the cache or the batch
+ * lanes. Histograms are made the first time a size and kind is seen.
+ *
+ * Buckets are log-linear, HDR style: values under 2 * LATENCY_SUB ns get a
+ * bucket each, and every power of two above that is cut into LATENCY_SUB
+ * buckets, so a bucket is never wider than 1 / LATENCY_SUB of its values
+ * (about 3%). Nanoseconds up to 2^LATENCY_BITS (73 minutes) fit; longer
+ * times go in the last bucket. Recording is a few relaxed atomic adds on
+ * counters shared by every thread, with no locks.
+ *
+ * writeLatency dumps p50, p90, p99, p99.9, max, sum and count of every
+ * histogram as Prometheus text. A dump thread writes the file every
+ * interval seconds and whenever the process gets SIGUSR1, and once more
+ * when the run ends. The file is written beside the old one and renamed
+ * over it, so a scraper never reads half a dump.
+*/
+
+#define LATENCY_SUB_BITS 5
+#define LATENCY_SUB (1 << LATENCY_SUB_BITS)
+#define LATENCY_BITS 42
+#define LATENCY_BUCKETS ((LATENCY_BITS - LATENCY_SUB_BITS + 1) * LATENCY_SUB)
+
+// what a histogram times; solves are kept per engine
+typedef enum latencyKind_e {
+  LATENCY_VERIFY,                                    // checkRun
+  LATENCY_SOLVE,                                     // + engine_e
+  LATENCY_CACHE = LATENCY_SOLVE + ENGINE_PORTFOLIO + 1, // answered from the cache
+  LATENCY_BATCH,                                     // finished in batch lanes
+  NUM_LATENCY_KINDS
+} latencyKind_e;
+
+typedef struct histogram_t {
+  atomic_long counts[LATENCY_BUCKETS];
+  atomic_long total;
+  atomic_long sum; // ns
+  atomic_long max; // ns
+} histogram_t;
+
+typedef struct latency_t {
+  _Atomic(histogram_t*) hists[MAX_PSIZE + 1][NUM_LATENCY_KINDS]; // NULL until used
+  char* filename;    // NULL if nothing is dumped
+  double interval;   // seconds between dumps, 0 for only on signal and at the end
+  long dumps;
+  pthread_t dumper;
+  bool dumping;      // dumper was started
+  atomic_bool stop;
+} latency_t;
+
+// dumps to filename if it isn't NULL, see above
+latency_t* createLatency(const char* filename, double interval); // returns malloc!
+// writes the last dump and stops the dump thread
+void deleteLatency(latency_t* latency);
+
+// monotonic clock in ns, for the start and end of what is recorded
+long latencyNow(void);
+void recordLatency(latency_t* latency, int psize, latencyKind_e kind, long ns);
+
+// value in ns at quantile q (0 to 1) of the histogram, 0 if it is empty
+long latencyQuantile(histogram_t* hist, double q);
+
+// returns false if the file could not be written
+bool writeLatency(latency_t* latency, const char* filename);
+// p50, p99 and max per histogram
+void printLatencyStats(latency_t* latency);
+
+#endif // LATENCY_H
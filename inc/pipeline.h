@@ -0,0 +1,86 @@
+/**
+ * @file pipeline.h
+ * @author Hayden Lauritzen (haydenlauritzen@gmail.com)
+ * @date 2023-1-16
+ *
+ * @copyright Copyright (c) 2023
+ *
+ */
+
+#ifndef PIPELINE_H
+#define PIPELINE_H
+
+#include "run.h"
+#include "ring.h"
+#include "batch.h"
+#include "place.h"
+#include "propagate.h"
+
+ /**
+ *  Pipeline
+ * Solves a stream of puzzles in three stages that run at once:
+ *   reader  - parses puzzles one after another from the inputs
+ *   workers - each checks and solves its share with its own arena
+ *   writer  - prints results in the order the puzzles were read
+ * The reader deals puzzle i to worker i % workers and the writer
+ * collects from the workers in the same order, so every ring has one
+ * producer and one consumer and the output keeps the input order.
+ *
+ * Rings are bounded. A stage that finds its next ring full waits, so a
+ * slow writer holds up the workers and they hold up the reader; at most
+ * workers * (2 * ringSize + 1) + 2 puzzles are in memory however long
+ * the stream is.
+ *
+ * With batching a worker takes every puzzle waiting in its ring, up to
+ * BATCH_LANES, and propagates the small ones together in batch lanes;
+ * the bound becomes workers * (2 * ringSize + BATCH_LANES) + 2.
+ *
+ * With pinning each worker is fixed to a core, spread evenly over the
+ * NUMA nodes, before it allocates anything, so its arena and batches
+ * are on its node. On machines with more than one node a worker also
+ * copies each board the reader made into its own memory, which puts
+ * every puzzle a socket works on in that socket's memory.
+ *
+ * With interleaving a worker keeps up to `interleave` puzzles in flight.
+ * Each is checked as it comes in, and one headed for the prop engine
+ * becomes a propTask_t (propagate.h) with an arena of its own; the rest
+ * are solved there and then. The worker steps every task in turn, so
+ * while one step works the boards the other tasks' prefetches asked for
+ * are on their way. Finished puzzles leave in the order they came, so a
+ * slow one holds the ones behind it in the window; the bound becomes
+ * workers * (2 * ringSize + interleave) + 2. Batching takes precedence.
+*/
+
+// default ring size between stages
+#define PIPE_RING 16
+// most puzzles a worker can interleave
+#define PIPE_MAX_INTERLEAVE 64
+
+typedef struct pipeConfig_t {
+  int workers;
+  size_t ringSize;
+  bool batch;      // run puzzles up to 16x16 through batch lanes before the engines
+  bool pin;        // pin workers to cores, node by node
+  int interleave;  // puzzles each worker keeps in flight, 1 solves one at a time
+} pipeConfig_t;
+
+typedef struct pipeItem_t {
+  int psize;      // 0 marks the end of the stream
+  num_t** grid;
+  num_t** puzzle; // the puzzle as read, kept if a solve is attempted
+  result_t result;
+} pipeItem_t;
+
+typedef struct stageStats_t {
+  long items;
+  double elapsed;  // seconds from start to finish
+  double blocked;  // seconds waiting on a full or empty ring
+  long depthSum;   // depth of the next ring at each push, summed
+  size_t depthMax;
+} stageStats_t;
+
+// solves every puzzle in files, "-" is stdin; prints stage metrics with run->stats
+// returns the number of puzzles written
+long runPipeline(run_t* run, char** files, int numFiles, pipeConfig_t* config);
+
+#endif // PIPELINE_H
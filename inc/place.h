@@ -0,0 +1,43 @@
+/**
+ * @file place.h
+ * @author Hayden Lauritzen (haydenlauritzen@gmail.com)
+ * @date 2023-1-16
+ *
+ * @copyright Copyright (c) 2023
+ *
+ */
+
+#ifndef PLACE_H
+#define PLACE_H
+
+#include <stdbool.h> // bool
+
+ /**
+ *  Placement
+ * Where threads run on machines with more than one NUMA node (socket).
+ * The layout is read once from /sys/devices/system/node; anywhere it
+ * can't be read counts as one node holding every online cpu.
+ *
+ * Memory isn't bound directly. Linux puts a page on the node of the
+ * thread that first writes it, so a thread pinned before it allocates
+ * and fills its boards and arena gets them on its own node.
+ *
+ * Pinning only works on Linux; elsewhere every call reports failure and
+ * threads stay where the scheduler puts them.
+*/
+
+// nodes and cpus that are online
+int placeNodes(void);
+int placeCpus(void);
+
+// cpu for worker w: workers go round the nodes, then through each node's cpus
+int workerCpu(int worker, int* node);
+
+// pins this thread to one cpu / to any cpu of a node, false if it can't
+bool pinToCpu(int cpu, int node);
+bool pinToNode(int node);
+
+// the node this thread was pinned to, -1 if it wasn't
+int currentNode(void);
+
+#endif // PLACE_H
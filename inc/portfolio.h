@@ -0,0 +1,68 @@
+/**
+ * @file portfolio.h
+ * @author Hayden Lauritzen (haydenlauritzen@gmail.com)
+ * @date 2023-1-16
+ *
+ * @copyright Copyright (c) 2023
+ *
+ */
+
+#ifndef PORTFOLIO_H
+#define PORTFOLIO_H
+
+#include "engine.h"
+#include "deadend.h"
+
+ /**
+ *  Portfolio
+ * How long a hard puzzle takes depends a lot on which guesses happen to
+ * come first. A portfolio races a few strategies (engines, and guess
+ * orders shuffled by different seeds) on copies of one puzzle. Each
+ * racer has its own thread and arena. The first to finish wins; the
+ * others are told to stop and joined before the winner's board is
+ * copied back.
+ *
+ * prop and sat look at the stop flag at every guess; the sweep does
+ * every PORTFOLIO_MOVES guesses. A racer that proves there is no
+ * solution also wins, since the others can only agree.
+ *
+ * Sweeps seeded differently walk the same tree in different orders, so
+ * with a dead end table each skips the boards the other searched out.
+*/
+
+// fewest and most racers, whatever the cpu count
+#define PORTFOLIO_MIN 3
+#define PORTFOLIO_MAX 8
+// sweep guesses between looks at the stop flag
+#define PORTFOLIO_MOVES 64
+
+typedef struct strategy_t {
+  engine_e engine;
+  unsigned seed;    // 0 is the engine's own order
+  const char* name;
+} strategy_t;
+
+typedef struct portfolio_t {
+  int numStrategies;
+  strategy_t strategies[PORTFOLIO_MAX];
+  arena_t* arenas[PORTFOLIO_MAX]; // one per racer, kept between puzzles
+  deadEnds_t* deadEnds;           // NULL, or shared by the sweep racers
+  long races;
+  long unsolvable;                // races won by finding no solution
+  long wins[PORTFOLIO_MAX];
+  double winTime[PORTFOLIO_MAX];  // seconds to win, summed
+} portfolio_t;
+
+// races the first numStrategies of the built in strategies, at most PORTFOLIO_MAX
+portfolio_t* createPortfolio(int numStrategies); // returns malloc!
+void deletePortfolio(portfolio_t* portfolio);
+
+// solves grid in place like runEngine; returns the winning strategy
+// and sets solved, or returns -1 if no racer could be started
+int portfolioSolve(portfolio_t* portfolio, int psize, num_t** grid, bool* solved);
+
+// adds the wins of from to into, for portfolios of the same strategies
+void mergePortfolio(portfolio_t* into, portfolio_t* from);
+void printPortfolioStats(portfolio_t* portfolio);
+
+#endif // PORTFOLIO_H
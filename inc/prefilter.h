@@ -0,0 +1,59 @@
+/**
+ * @file prefilter.h
+ * @author Hayden Lauritzen (haydenlauritzen@gmail.com)
+ * @date 2023-1-16
+ *
+ * @copyright Copyright (c) 2023
+ *
+ */
+
+#ifndef PREFILTER_H
+#define PREFILTER_H
+
+#include "sudoku.h"
+
+ /**
+ *  Prefilter
+ * Turns away boards that can't have a solution before they are checked
+ * or searched, and says why:
+ *  - range: a cell the parser read outside 0 to psize (kept as BAD_CELL)
+ *  - duplicate: a number given twice in a row, column or box
+ *  - no candidates: an empty cell every number is taken from
+ *  - no place: a number missing from a unit that none of its empty cells
+ *    can take
+ * One pass over the givens builds a mask of the numbers each unit uses,
+ * one pass over the empty cells ORs their candidates into masks of what
+ * each unit can still take, and a unit has no place for the numbers in
+ * neither. Masks are as many 64-bit words as the board needs, one below
+ * 64x64. Nothing is placed, so boards these miss are left to the search.
+*/
+
+typedef enum reject_e {
+  REJECT_NONE,
+  REJECT_RANGE,
+  REJECT_DUPLICATE,
+  REJECT_NO_CANDIDATES,
+  REJECT_NO_PLACE,
+  NUM_REJECTS
+} reject_e;
+
+// what was wrong and where, 1-indexed; fields that don't apply are 0
+typedef struct rejection_t {
+  reject_e reason;
+  int row;
+  int col;
+  int num;
+  enum subset unit;
+  int unitIdx;
+} rejection_t;
+
+// fills rejection, returns its reason; scratch comes from the arena
+// and is released before returning
+reject_e prefilter(int psize, num_t** grid, rejection_t* rejection, arena_t* arena);
+
+const char* rejectName(reject_e reason);
+
+// "Rejected: ..." with where it was found
+void printRejection(rejection_t* rejection);
+
+#endif // PREFILTER_H
@@ -0,0 +1,135 @@
+/**
+ * @file propagate.h
+ * @author Hayden Lauritzen (haydenlauritzen@gmail.com)
+ * @date 2023-1-16
+ *
+ * @copyright Copyright (c) 2023
+ *
+ */
+
+#ifndef PROPAGATE_H
+#define PROPAGATE_H
+
+#include "sudoku.h"
+#include "shape.h"
+#include "bitset.h"
+
+ /**
+ *  Propagation Engine
+ * Keeps a bitmask of the numbers used in every row, column and box.
+ * The candidates of a cell are the numbers none of its units use.
+ * Before each guess it fills
+ *  - naked singles: a cell with one candidate
+ *  - hidden singles: a number with one possible cell in a unit
+ * until nothing changes, then guesses on the cell with the fewest
+ * candidates. A board is copied onto the arena before each guess.
+ * A seeded search breaks ties between cells and orders each cell's
+ * guesses at random, so differently seeded copies explore differently.
+ *
+ * Masks are multi-word bitsets, so every board up to MAX_PSIZE fits.
+ * A state takes psize^2 bytes of cells plus 3 * psize masks of
+ * MASK_WORDS * 8 bytes.
+*/
+
+typedef struct propState_t {
+  int psize;
+  const shape_t* shape; // box tables
+  num_t* cells;   // psize * psize, row-major, 0 is empty
+  mask_t* rowUsed;
+  mask_t* colUsed;
+  mask_t* boxUsed;
+  int empty;      // cells left to fill
+} propState_t;
+
+// the box of a cell, all 0-indexed
+static inline int boxOf(propState_t* state, int row, int col) {
+    return state->shape->boxOf[row * state->psize + col];
+}
+
+// row and col of the i'th cell of a unit, all 0-indexed
+static inline void unitCell(propState_t* state, enum subset type, int unit, int i, int* row, int* col) {
+    switch (type) {
+    case rows:
+        *row = unit;
+        *col = i;
+        break;
+    case cols:
+        *row = i;
+        *col = unit;
+        break;
+    case grids:
+        *row = state->shape->cells[unit * state->psize + i].row;
+        *col = state->shape->cells[unit * state->psize + i].col;
+        break;
+    }
+}
+
+// the mask of numbers a unit uses
+static inline mask_t* unitUsed(propState_t* state, enum subset type, int unit) {
+    switch (type) {
+    case rows: return &state->rowUsed[unit];
+    case cols: return &state->colUsed[unit];
+    default: return &state->boxUsed[unit];
+    }
+}
+
+// fills the puzzle, returns false if it has no solution
+bool propagateSolve(int psize, num_t** grid, arena_t* arena);
+// the same with a seeded guess order; also false if opts->stop was set
+bool propagateSearch(int psize, num_t** grid, searchOpts_t* opts, arena_t* arena);
+
+// loads grid into a new state, returns NULL if two givens clash
+propState_t* createPropState(int psize, num_t** grid, arena_t* arena); // returns arena memory
+
+// numbers that can still go in a cell
+mask_t getCandidates(propState_t* state, int row, int col);
+
+// fills singles until none are left, returns false on a contradiction
+bool propagate(propState_t* state);
+
+ /**
+ *  Propagation Tasks
+ * The same search with its stack kept in a propTask_t instead of on the
+ * C stack, run a step per call, so one thread can keep several puzzles
+ * going and switch between them. A step propagates the board of the last
+ * guess and picks the next cell, then takes the next guess, backing out
+ * of frames that have none left. Before returning it prefetches the board
+ * the next step starts on, which has the other tasks' steps to arrive in.
+ * Guesses go in propagateSolve's order, so a task finds the same solution.
+*/
+
+// most bytes of a board prefetched at the end of a step
+#define PROP_PREFETCH_MAX 4096
+
+typedef enum taskStatus_e {
+  TASK_RUNNING,
+  TASK_SOLVED, // grid holds the solution
+  TASK_FAILED  // no solution, grid is as it was
+} taskStatus_e;
+
+// a board guessed on
+typedef struct propFrame_t {
+  propState_t* state;
+  int row;          // the cell guessed on, 0-indexed
+  int col;
+  mask_t cand;      // guesses not taken yet
+  arenaMark_t mark; // where the copy for the current guess starts
+} propFrame_t;
+
+typedef struct propTask_t {
+  int psize;
+  num_t** grid;
+  arena_t* arena;      // holds the frames and boards until the task ends
+  propFrame_t* frames; // at most one per cell
+  int depth;
+  propState_t* next;   // board the next step propagates, NULL to take a guess
+  long steps;
+} propTask_t;
+
+// loads grid into a task, false if two givens clash
+bool startPropTask(propTask_t* task, int psize, num_t** grid, arena_t* arena);
+
+// runs one step, fills the task's grid once solved
+taskStatus_e stepPropTask(propTask_t* task);
+
+#endif // PROPAGATE_H
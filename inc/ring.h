@@ -0,0 +1,47 @@
+/**
+ * @file ring.h
+ * @author Hayden Lauritzen (haydenlauritzen@gmail.com)
+ * @date 2023-1-16
+ *
+ * @copyright Copyright (c) 2023
+ *
+ */
+
+#ifndef RING_H
+#define RING_H
+
+#include <stdatomic.h>
+#include <stdbool.h> // bool
+#include <stddef.h>  // size_t
+
+ /**
+ *  Ring Buffer
+ * Bounded queue of pointers between exactly one producer thread and one
+ * consumer thread. No locks: the producer only moves tail, the consumer
+ * only moves head, and each reads the other's index with acquire so a
+ * slot is written before it is seen. head and tail are on their own
+ * cache lines so the two threads don't fight over one.
+*/
+
+#define RING_LINE 64
+
+typedef struct ring_t {
+  _Atomic size_t head; // next slot to pop, moved by the consumer
+  char headPad[RING_LINE - sizeof(size_t)];
+  _Atomic size_t tail; // next slot to push, moved by the producer
+  char tailPad[RING_LINE - sizeof(size_t)];
+  size_t capacity;     // a power of two
+  void** slots;
+} ring_t;
+
+ring_t* createRing(size_t capacity); // returns malloc! capacity is rounded up to a power of two
+void deleteRing(ring_t* ring);
+
+// returns false if the ring is full
+bool ringPush(ring_t* ring, void* item);
+// returns NULL if the ring is empty
+void* ringPop(ring_t* ring);
+// items in the ring; exact for the producer and consumer, a snapshot for anyone else
+size_t ringDepth(ring_t* ring);
+
+#endif // RING_H
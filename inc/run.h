@@ -0,0 +1,96 @@
+/**
+ * @file run.h
+ * @author Hayden Lauritzen (haydenlauritzen@gmail.com)
+ * @date 2023-1-16
+ *
+ * @copyright Copyright (c) 2023
+ *
+ */
+
+#ifndef RUN_H
+#define RUN_H
+
+#include "sudoku.h"
+#include "cache.h"
+#include "dispatch.h"
+#include "portfolio.h"
+#include "latency.h"
+#include "prefilter.h"
+#include "store.h"
+
+ /**
+ *  Runs
+ * Checking and solving one puzzle, apart from reading and printing it,
+ * so puzzles can be solved in one place and reported in another.
+ * A puzzle goes through
+ *   checkRun - prefilter, then complete and valid and the missing counts
+ *   solveRun - cache, store, engine choice and solve, if it needs one
+ * and its result_t says what to print.
+*/
+
+// largest arena made up front, 64MB
+#define ARENA_START_MAX ((size_t)64 << 20)
+
+// settings shared by every puzzle in a run
+typedef struct run_t {
+  cache_t* cache;
+  pthread_mutex_t* cacheLock; // held around the cache when it is shared
+  arena_t* arena;
+  dispatcher_t* dispatcher;
+  checkpoint_t* checkpoint; // NULL unless -k was given
+  engine_e engine;          // ENGINE_AUTO lets the dispatcher pick
+  bool stats;
+  portfolio_t* portfolio;   // racers when engine is ENGINE_PORTFOLIO, else NULL
+  deadEnds_t* deadEnds;     // NULL unless -d was given, shared by every worker
+  latency_t* latency;       // NULL unless -m was given, shared by every worker
+  store_t* store;           // NULL unless -g was given, shared by every worker
+} run_t;
+
+// what happened to one puzzle
+typedef struct result_t {
+  bool complete;
+  bool valid;
+  bool attempted;  // incomplete but valid, so a solve was tried
+  bool fromCache;
+  bool fromStore;
+  bool solved;
+  bool routed;     // the dispatcher picked the engine from features
+  engine_e engine;
+  int winner;      // strategy that won the portfolio race, -1 if none
+  features_t features;
+  rejection_t rejection; // why the prefilter turned it away, REJECT_NONE if it didn't
+} result_t;
+
+// makes sure run->arena can hold a search of a psize board
+void prepareArena(run_t* run, int psize);
+
+// fills complete and valid, returns the missing counts from the arena,
+// or NULL if the prefilter turned the board away without checking it
+// checks and solves are timed into run->latency when there is one
+missing_t* checkRun(run_t* run, int psize, num_t** grid, result_t* result);
+
+// what a solve carries from picking the engine to counting the result
+typedef struct solveJob_t {
+  canon_t* canon; // cache key, NULL without a cache
+  unsigned long key; // store key, the hash of the puzzle as given
+  long start;     // ns, for run->latency
+} solveJob_t;
+
+// solves grid in place if the result says it needs it
+void solveRun(run_t* run, int psize, num_t** grid, missing_t* missing, result_t* result);
+
+// solveRun in three parts, for callers that search some other way:
+//   startSolve  - cache and store lookups and engine choice, false if answered
+//   searchRun   - the chosen engine or the portfolio
+//   endSolve    - counts, caches, stores and times whatever result->solved says
+bool startSolve(run_t* run, int psize, num_t** grid, result_t* result, solveJob_t* job);
+void searchRun(run_t* run, int psize, num_t** grid, missing_t* missing, result_t* result);
+void endSolve(run_t* run, int psize, num_t** grid, result_t* result, solveJob_t* job);
+
+// "Complete puzzle?" and "Valid puzzle?", and why it was rejected
+void printCheck(result_t* result);
+
+// cache and store hits, engine choices and failures, after "Attempting Solve of"
+void printSolve(run_t* run, result_t* result);
+
+#endif // RUN_H
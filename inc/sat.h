@@ -0,0 +1,108 @@
+/**
+ * @file sat.h
+ * @author Hayden Lauritzen (haydenlauritzen@gmail.com)
+ * @date 2023-1-16
+ *
+ * @copyright Copyright (c) 2023
+ *
+ */
+
+#ifndef SAT_H
+#define SAT_H
+
+#include "sudoku.h"
+
+ /**
+ *  SAT Engine
+ * Every candidate (row, col, num) left after propagation becomes a
+ * boolean variable, with clauses saying
+ *  - every empty cell holds at least one and at most one number
+ *  - every number missing from a row/col/box goes in exactly one cell
+ * At most one is pairwise for small groups and a sequential counter
+ * for big ones. A CDCL solver then finds an assignment:
+ *  - two watched literals, binary clauses kept as implication lists
+ *  - first-UIP clause learning with backjumping and minimization
+ *  - VSIDS branching with phase saving
+ *  - Luby restarts and halving of the learnt clauses by activity
+ *
+ * Literals are 2 * var + sign, sign 1 is the negation.
+*/
+
+#define SAT_UNDEF -1
+
+typedef struct satClause_t {
+  int size;
+  bool learnt;
+  bool deleted;
+  double activity;
+  int* lits; // lits[0] and lits[1] are watched
+} satClause_t;
+
+typedef struct satWatch_t {
+  int clause;
+  int blocker; // if this literal is true the clause can be skipped
+} satWatch_t;
+
+typedef struct satVec_t {
+  int size;
+  int capacity;
+  void* data;
+} satVec_t;
+
+typedef struct satSolver_t {
+  int numVars;
+  satClause_t* clauses;
+  int numClauses;
+  int clauseCapacity;
+  int numLearnts;
+  satVec_t* watches; // per literal, satWatch_t of clauses watching it
+  satVec_t* binary;  // per literal, literals implied once it is true
+  signed char* value; // per var, SAT_UNDEF, 0 or 1
+  bool* polarity;     // per var, last value given
+  int* level;
+  int* reason;        // clause index, SAT_UNDEF, or -2 - lit for a binary clause
+  int* trail;
+  int trailSize;
+  int qhead;
+  int* trailLim;      // trail size at the start of each level
+  int numLevels;
+  double* activity;
+  double varInc;
+  double clauseInc;
+  int* heap;          // vars ordered by activity
+  int* heapIdx;       // position of a var in heap, -1 if absent
+  int heapSize;
+  bool* seen;
+  int* analyzeStack;  // scratch for clause minimization
+  int* analyzeClear;  // vars marked seen during minimization
+  int binaryConflict[2]; // both literals of a binary clause found false
+  bool unsat;         // a conflict at level 0 was found
+  atomic_bool* stop;  // NULL, or set by another thread to give up
+  long conflicts;
+  long decisions;
+  long propagations;
+} satSolver_t;
+
+satSolver_t* createSat(int numVars); // returns malloc!
+void deleteSat(satSolver_t* sat);
+
+// adds a clause of size lits, returns false if the formula became unsat
+bool satAddClause(satSolver_t* sat, int* lits, int size);
+
+// returns 1 if sat, 0 if unsat, SAT_UNDEF if maxConflicts was hit or
+// sat->stop was set; maxConflicts <= 0 means no limit
+int satSolve(satSolver_t* sat, long maxConflicts);
+
+// random starting phases and a little random activity to break ties,
+// so differently seeded solvers branch differently; seed must not be 0
+void satShuffle(satSolver_t* sat, unsigned seed);
+
+// value of var in the model after satSolve returned 1
+bool satModel(satSolver_t* sat, int var);
+
+// fills the puzzle, returns false if it has no solution
+bool satSolvePuzzle(int psize, num_t** grid, arena_t* arena);
+// the same, shuffled by opts->seed; also false if opts->stop was set
+bool satSearchPuzzle(int psize, num_t** grid, searchOpts_t* opts, arena_t* arena);
+
+#endif // SAT_H
@@ -0,0 +1,80 @@
+/**
+ * @file session.h
+ * @author Hayden Lauritzen (haydenlauritzen@gmail.com)
+ * @date 2023-1-16
+ *
+ * @copyright Copyright (c) 2023
+ *
+ */
+
+#ifndef SESSION_H
+#define SESSION_H
+
+#include "propagate.h"
+
+ /**
+ *  Sessions
+ * A board kept between edits, for front ends that change one cell at a
+ * time. Every row, column and box counts how often it holds each
+ * number, so setting or clearing a cell updates the used masks, the
+ * conflicts and the empty cells left with no candidates by looking at
+ * that cell's units only, O(psize) instead of checking the whole board.
+ *
+ * A hint is the next step a person could take without guessing:
+ *  - a conflict or an empty cell with no candidates, if there is one
+ *  - a naked single: a cell with one candidate
+ *  - a hidden single: a number with one place left in a unit
+ * and when neither single is left, the cell with the fewest candidates
+ * to guess on. Hints look at the board and don't change it.
+ *
+ * Only sessionSolvable searches; it works on a copy with the prop engine.
+*/
+
+typedef enum hintKind_e {
+  HINT_SOLVED,        // board is full with no conflicts
+  HINT_CONFLICT,      // cell's number repeats in one of its units
+  HINT_NO_CANDIDATES, // empty cell that nothing can go in
+  HINT_NO_PLACE,      // number that fits nowhere in a unit
+  HINT_NAKED_SINGLE,
+  HINT_HIDDEN_SINGLE,
+  HINT_GUESS          // no single left; cell has the fewest candidates
+} hintKind_e;
+
+typedef struct hint_t {
+  hintKind_e kind;
+  int row;         // 1-indexed like grid, 0 if the hint has no cell
+  int col;
+  int num;         // number to place, or the one that clashes or has no place
+  enum subset unit; // unit of a hidden single, conflict or missing place
+  int unitIdx;     // 1-indexed
+} hint_t;
+
+typedef struct session_t {
+  propState_t state;    // cells and used masks; cells are 0-indexed
+  unsigned char* count; // [type][unit][num] times num is in the unit
+  bool* dead;           // per cell, empty with no candidates
+  mask_t* cand;         // scratch for nextHint, per cell
+  int conflicts;        // (unit, number) pairs seen more than once
+  int deadCells;
+  arena_t* arena;       // the session's arrays, then scratch above them
+} session_t;
+
+session_t* createSession(int psize, num_t** grid); // returns malloc!
+void deleteSession(session_t* session);
+
+// puts num in the cell, 0 clears it; false if row, col or num is out of range
+bool setCell(session_t* session, int row, int col, int num);
+int getCell(session_t* session, int row, int col);
+mask_t cellCandidates(session_t* session, int row, int col);
+// true if the cell's number repeats in its row, column or box
+bool cellConflicts(session_t* session, int row, int col);
+
+hint_t nextHint(session_t* session);
+const char* hintName(hintKind_e kind);
+
+// true if the board can still be finished; searches a copy
+bool sessionSolvable(session_t* session);
+// copies the board out to a grid of the same size
+void sessionBoard(session_t* session, num_t** grid);
+
+#endif // SESSION_H
@@ -0,0 +1,51 @@
+/**
+ * @file shape.h
+ * @author Hayden Lauritzen (haydenlauritzen@gmail.com)
+ * @date 2023-1-16
+ *
+ * @copyright Copyright (c) 2023
+ *
+ */
+
+#ifndef SHAPE_H
+#define SHAPE_H
+
+#include "sudoku.h"
+
+ /**
+ *  Box Shapes
+ * Boxes are boxRows rows by boxCols columns, boxRows * boxCols == psize.
+ * A puzzle's size line may give them after the size, rows first:
+ *   12 3 4
+ * otherwise they are the squarest split with boxRows <= boxCols: 3x3 for
+ * 9x9, 2x3 for 6x6, 2x4 for 8x8, 3x4 for 12x12, and 1 x psize (boxes are
+ * rows) for a prime size. A board keeps boxRows in grid[0][0], which is
+ * never a cell, 0 for the default, so copies of a grid keep their shape.
+ *
+ * Boxes are numbered row by row. Each shape's tables, the box of every
+ * cell and the cells of every box, are made the first time a board of
+ * that shape is seen and kept until the process ends, so units are looked
+ * up rather than worked out with divisions.
+*/
+
+typedef struct shape_t {
+  int psize;
+  int boxRows;   // rows in a box
+  int boxCols;   // columns in a box
+  int* boxOf;    // psize * psize, the box of each cell, row-major, 0-indexed
+  cell_t* cells; // psize * psize, box b's cells from b * psize, row by row, 0-indexed
+  struct shape_t* next; // other shapes of the same size
+} shape_t;
+
+// boxRows of the default shape
+int defaultBoxRows(int psize);
+
+// gives grid boxes of boxRows by boxCols, false if they don't tile it
+bool setBoxShape(int psize, num_t** grid, int boxRows, int boxCols);
+
+// the shape with boxRows rows per box, 0 for the default; any thread
+const shape_t* findShape(int psize, int boxRows);
+// the shape a board was read with
+const shape_t* getShape(int psize, num_t** grid);
+
+#endif // SHAPE_H
@@ -0,0 +1,63 @@
+/**
+ * @file shard.h
+ * @author Hayden Lauritzen (haydenlauritzen@gmail.com)
+ * @date 2023-1-16
+ *
+ * @copyright Copyright (c) 2023
+ *
+ */
+
+#ifndef SHARD_H
+#define SHARD_H
+
+#include "run.h"
+
+ /**
+ *  Shards
+ * Splits a corpus over processes, each standing in for a node. Shard k
+ * is puzzles k * records to (k + 1) * records - 1, counted from 0 over
+ * every input in order, so the same corpus always splits the same way
+ * however many processes run it. The coordinator writes each shard to a
+ * file in a scratch directory as soon as it is read and hands it to the
+ * next free process, at most procs at a time.
+ *
+ * A process is this program run again with the coordinator's options,
+ * -p and its shard file, and stdout sent to a file of its own. It tells
+ * the coordinator how it went in a stats file (the SHARD_STATS_ENV
+ * variable names it): puzzles written, dispatch counts and cache, store
+ * and dead end counters, one "name value ..." line each. A shard whose
+ * process fails, dies or writes fewer puzzles than it was given is run
+ * again, up to SHARD_ATTEMPTS times in all.
+ *
+ * Outputs are copied to stdout in shard order as soon as every shard
+ * before them is done, so the merged output is what -p would print, and
+ * stats are summed over the shards. A process keeps its own cache, so a
+ * puzzle repeated in two shards is solved in both.
+*/
+
+// puzzles per shard by default
+#define SHARD_RECORDS 256
+// runs of a shard before it is given up on
+#define SHARD_ATTEMPTS 3
+// set in a shard's process to its shard number
+#define SHARD_ENV "SUDOKU_SHARD"
+// set in a shard's process to the file it writes its stats to
+#define SHARD_STATS_ENV "SUDOKU_SHARD_STATS"
+
+typedef struct shardConfig_t {
+  int procs;        // processes at once
+  int records;      // puzzles per shard
+  int workers;      // -w for each process, 0 to leave its options alone
+  char** args;      // argv up to the puzzle files, passed to every process
+  int numArgs;
+  bool stats;
+} shardConfig_t;
+
+// solves every puzzle in files, "-" is stdin, in shards; the dispatcher
+// gets every process's counts. false if a shard failed every attempt
+bool runShards(char** files, int numFiles, shardConfig_t* config, dispatcher_t* dispatcher);
+
+// in a shard's process, what the coordinator sums; puzzles is what the pipeline wrote
+void writeShardStats(const char* filename, run_t* run, long puzzles);
+
+#endif // SHARD_H
@@ -0,0 +1,95 @@
+/**
+ * @file store.h
+ * @author Hayden Lauritzen (haydenlauritzen@gmail.com)
+ * @date 2023-1-16
+ *
+ * @copyright Copyright (c) 2023
+ *
+ */
+
+#ifndef STORE_H
+#define STORE_H
+
+#include "sudoku.h"
+
+ /**
+ *  Solution Store
+ * Solutions kept on disk from one run to the next. The store is an open
+ * addressing hash table in a file mapped into memory, keyed by the hash
+ * of the puzzle as given (puzzleHash), so a puzzle solved by any earlier
+ * run is answered without a search.
+ *
+ * File layout, native byte order:
+ *   header: "SDKSTOR1", slots (a power of 2), entries, data bytes used,
+ *           data bytes the file has room for
+ *   slots:  hash, data offset, psize, box rows; hash 0 is empty
+ *   data:   solutions back to back, each cell num - 1 in as few bits as
+ *           psize needs (4 for 9x9, 41 bytes a solution), 8 byte aligned
+ *
+ * Lookups take no file lock. An insert appends the solution, fills in
+ * the slot and stores its hash last, so a reader in any process sees a
+ * slot either empty or whole. Inserts hold flock on the file, so runs
+ * can share a store; the file grows by doubling its data, and a reader
+ * that finds a slot past the end of its mapping maps the file again.
+ * A hit is only taken if the solution agrees with every given, so two
+ * puzzles sharing a hash can't hand one the other's answer.
+ *
+ * Slots are never reused and the table is not resized in place: past
+ * STORE_LOAD_PCT percent full, new solutions are dropped (and counted).
+ * compactStore rewrites the file with the table at half load (never
+ * fewer than STORE_SLOTS) and no data a crashed run left unlinked; run it between jobs, since runs
+ * still holding the old file write to it rather than the new one.
+*/
+
+#define STORE_MAGIC "SDKSTOR1"
+// slots of a new store, about 49000 solutions before it is full
+#define STORE_SLOTS ((uint64_t)1 << 16)
+// data bytes of a new store
+#define STORE_DATA ((uint64_t)1 << 20)
+#define STORE_LOAD_PCT 75
+
+typedef struct storeHeader_t {
+  char magic[8];
+  uint64_t slots;
+  _Atomic uint64_t entries;
+  _Atomic uint64_t dataUsed;
+  _Atomic uint64_t dataSize;
+  uint64_t reserved[3]; // 64 bytes, so the slots are aligned
+} storeHeader_t;
+
+typedef struct storeSlot_t {
+  _Atomic uint64_t hash; // stored last, 0 is empty
+  uint64_t offset;       // from the start of the data
+  uint32_t psize;
+  uint32_t boxRows;      // grid[0][0] of the puzzle
+} storeSlot_t;
+
+typedef struct store_t {
+  char* filename;
+  int fd;
+  char* map;        // the whole file as of the last mapping
+  size_t mapped;    // bytes mapped
+  pthread_rwlock_t lock; // lookups share it, inserts and remaps take it alone
+  atomic_long hits;
+  atomic_long misses;
+  atomic_long added;
+  atomic_long dropped;    // the table was full
+  atomic_long mismatches; // a hash matched but a given didn't
+} store_t;
+
+// opens filename, making an empty store if there is no file
+store_t* openStore(const char* filename); // returns malloc! NULL on failure
+void closeStore(store_t* store);
+
+// writes the stored solution of the puzzle into grid, false if none
+bool storeLookup(store_t* store, unsigned long key, int psize, num_t** grid);
+// stores the solution of the puzzle whose hash is key
+void storeInsert(store_t* store, unsigned long key, int psize, num_t** solution);
+
+// rewrites filename with only its live entries, at half load
+bool compactStore(const char* filename);
+
+// hits, misses and how full the table is
+void printStoreStats(store_t* store);
+
+#endif // STORE_H
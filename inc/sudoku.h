@@ -7,13 +7,29 @@
  *
  */
 
+#ifndef SUDOKU_H
+#define SUDOKU_H
+
 #include <math.h>    // sqrt; gcc requires the '-lm' option when compiling 
 #include <stdbool.h> // bool
+#include <stdint.h>  // uint8_t
 #include <stdio.h>
 #include <stdlib.h>
 #include <pthread.h> // threads; gcc requires the '-pthread' option when compiling
+#include <stdatomic.h> // atomic_bool
 #include <string.h> // memcpy()
 
+#include "arena.h"
+#include "trace.h"
+
+// a cell holds 0 (empty) or a number from 1 to psize
+typedef uint8_t num_t;
+
+// largest board a num_t can hold
+#define MAX_PSIZE 255
+// a cell read out of range, for prefilter to turn the board away
+#define BAD_CELL MAX_PSIZE
+
  /**
  *  Board Structure
  * grid[row][col]
@@ -49,17 +65,25 @@
  * - - psize
  * grid
  *
+ * Boxes need not be square: a 6x6 board has 2x3 boxes, numbered
+ * row by row, see shape.h
 */
 
 // threaded functions for validation
 void* solveRow(void* args);
 void* solveCol(void* args);
 void* solveGrid(void* args);
+void* solveUnit(void* args); // one of the above, by type
 
 // threaded functions for solving
 void* checkRow(void* args);
 void* checkCol(void* args);
 void* checkGrid(void* args);
+void* checkUnit(void* args); // one of the above, by type
+
+enum subset { rows, cols, grids };
+
+struct shape_t; // box tables, see shape.h
 
 // missing number information 
 typedef struct missing_t {
@@ -70,45 +94,112 @@ typedef struct missing_t {
 
 // storage for pthreads
 typedef struct checkpuzzle_t {
+  enum subset type;
   int idx;
   int psize;
-  int** grid;
+  const struct shape_t* shape;
+  num_t** grid;
   bool valid;
   bool complete;
   int numMissing;
+  bool* numCount; // scratch, drawn from the solve arena
 } checkpuzzle_t;
 
-typedef struct solvepuzzle_t {
-  int idx;
-  int psize;
-  int** grid;
-  missing_t* missingNums;
-} solvepuzzle_t;
-
-enum subset { rows, cols, grids };
-
 typedef struct cell_t {
   int row;
   int col;
 } cell_t;
 
+// a unit with one empty cell; the task only reads grid, the caller
+// makes the move
+typedef struct solvepuzzle_t {
+  enum subset type;
+  int idx;
+  int psize;
+  const struct shape_t* shape;
+  num_t** grid;
+  bool* numCount; // scratch, drawn from the solve arena
+  cell_t cell;    // the empty cell
+  int num;        // number it is forced to, 0 if that can't be right
+} solvepuzzle_t;
+
 typedef struct smallestSolve_t {
   enum subset type;
   int idx;
 } smallestSolve_t;
 
 typedef struct savedPos_t {
-  int** grid;
+  num_t* grid; // (psize + 1) * (psize + 1), row-major
   missing_t* missing;
 } savedPos_t;
 
+// one guess on the search stack
+typedef struct searchFrame_t {
+  cell_t cell;
+  int gridIdx;
+  int* moves;        // zero terminated legal numbers
+  int next;          // moves[next] is tried next
+  savedPos_t* saved; // position before the guess
+  struct bitboard_t* board; // the search's bitboard before the guess, NULL if not kept
+  uint64_t hash;     // zobrist hash of saved
+  long guesses;      // search guesses when the frame was pushed
+  arenaMark_t mark;  // releases the frame and everything above it
+} searchFrame_t;
+
+typedef enum searchStatus_e {
+  SEARCH_START,   // easy solves not made yet
+  SEARCH_RUNNING,
+  SEARCH_SOLVED,
+  SEARCH_FAILED
+} searchStatus_e;
+
+// sweep search over an explicit stack of guesses rather than recursion
+typedef struct search_t {
+  int psize;
+  const struct shape_t* shape;
+  num_t** grid;
+  missing_t* missingNums;
+  arena_t* arena;
+  searchFrame_t* frames; // psize * psize + 1, every guess fills a cell
+  int depth;             // frames in use
+  int maxDepth;
+  long guesses;
+  unsigned seed;         // 0 guesses in order, else shuffles each cell's numbers
+  uint64_t hash;         // zobrist hash of grid, see deadend.h
+  struct deadEnds_t* deadEnds; // NULL, or boards known to have no solution
+  struct bitboard_t* board;    // 9x9 only, grid by digit, see bitboard.h
+  searchStatus_e status;
+} search_t;
+
+// how a search may differ from the default one, so copies of it can race
+typedef struct searchOpts_t {
+  unsigned seed;     // 0 keeps the default order, else ties and guesses are shuffled
+  atomic_bool* stop; // NULL, or set by another thread to give up
+} searchOpts_t;
+
+// runs task on count args of argSize bytes each, spread over at most
+// getWorkerCount() threads; a single worker runs them inline
+void runTasks(void* (*task)(void*), void* args, size_t argSize, int count, arena_t* arena);
+int getWorkerCount(void); // defaults to the number of online cpus
+void setWorkerCount(int count);
+
 // helper functions
-inline int getGridIdx(int row, int col, int psize);
-inline bool isSolvable(missing_t* missingNums, int psize);
-inline bool isComplete(missing_t* missingNums, int psize);
-void makeMove(missing_t* missingNums, int row, int col, int grids, int** grid, int num);
-void undoMove(savedPos_t* savedPos, int** grid, missing_t* missingNums, int psize); // free's savedPos_t
-savedPos_t* savePos(int** grid, missing_t* missingNums, int psize); // returns malloc!
+int getGridIdx(int row, int col, const struct shape_t* shape); // 1-indexed
+bool isSolvable(missing_t* missingNums, int psize);
+bool isComplete(missing_t* missingNums, int psize);
+// returns the zobrist key of the move, to xor into the board's hash
+uint64_t makeMove(missing_t* missingNums, int row, int col, int grids, num_t** grid, int num);
+// makeMove that also keeps board in step, unless it is NULL
+uint64_t placeMove(missing_t* missingNums, struct bitboard_t* board, int row, int col, int grids, num_t** grid,
+    int num);
+void undoMove(savedPos_t* savedPos, num_t** grid, missing_t* missingNums, int psize);
+savedPos_t* savePos(num_t** grid, missing_t* missingNums, int psize, arena_t* arena); // returns arena memory
+unsigned nextRandom(unsigned* state); // xorshift, state must not be 0
+uint64_t zobristKey(int row, int col, int num);
+uint64_t zobristBoard(int psize, num_t** grid); // hash of every filled cell and psize
+
+// bytes of arena a full search of a psize puzzle can need
+size_t solveArenaSize(int psize);
 
 // takes puzzle size and grid[][] representing sudoku puzzle
 // and tow booleans to be assigned: complete and valid.
@@ -117,22 +208,48 @@ savedPos_t* savePos(int** grid, missing_t* missingNums, int psize); // returns m
 // A puzzle is complete if it can be completed with no 0s in it
 // If complete, a puzzle is valid if all rows/columns/boxes have numbers from 1
 // to psize For incomplete puzzles, we cannot say anything about validity
-// returns int[3][10] of num missing in each subsection
-missing_t* checkPuzzle(int psize, int** grid, bool* complete, bool* valid);
-
-void solvePuzzle(missing_t* missingNums, int psize, int** grid);
-int* solveCell(int row_n, int col_n, int grid_n, int psize, int** grid); // returns malloc!
-smallestSolve_t* getSmallestSolve(missing_t* missingNums, int psize); // returns malloc
-cell_t* selectCell(smallestSolve_t* subset, int psize, int** grid); // returns malloc!
+// returns int[3][10] of num missing in each subsection, from the arena
+missing_t* checkPuzzle(int psize, num_t** grid, bool* complete, bool* valid, arena_t* arena);
+
+// all scratch comes from the arena and is released before returning
+// deadEnds may be NULL, else it is read and filled as the search goes
+// returns true if the puzzle ended complete and valid, prints nothing
+bool solvePuzzle(missing_t* missingNums, int psize, num_t** grid, struct deadEnds_t* deadEnds, arena_t* arena);
+
+// search in steps; the search and its frames are arena memory, so it
+// lives until the arena is released below where it was created
+search_t* createSearch(missing_t* missingNums, int psize, num_t** grid, arena_t* arena);
+// tries at most maxMoves guesses, no limit if maxMoves <= 0;
+// call again while it returns SEARCH_RUNNING to pick up where it left off
+searchStatus_e stepSearch(search_t* search, long maxMoves);
+int* solveCell(int row_n, int col_n, int grid_n, int psize, num_t** grid, arena_t* arena); // returns arena memory
+smallestSolve_t* getSmallestSolve(missing_t* missingNums, int psize, arena_t* arena); // returns arena memory
+cell_t* selectCell(smallestSolve_t* subset, int psize, num_t** grid, arena_t* arena); // returns arena memory
 
 // takes filename and pointer to grid[][]
 // returns size of Sudoku puzzle and fills grid
-int readSudokuPuzzle(char* filename, int*** grid);
+// rows share one block, so grid[1] + (psize + 1) == grid[2]
+// the size may be followed by the box rows and columns on its line
+int readSudokuPuzzle(char* filename, num_t*** grid);
+
+// reads the next puzzle of a stream holding any number of them,
+// returns 0 at the end of the stream or at text that is not a size; name is used in errors
+// a number outside 0 to psize is kept as BAD_CELL, except on the largest
+// boards, where BAD_CELL is a number and reading stops
+int readSudokuStream(FILE* fp, const char* name, num_t*** grid);
+
+// empty grid[][] in the layout readSudokuPuzzle uses
+num_t** createSudokuPuzzle(int psize); // returns malloc!
+num_t** copySudokuPuzzle(int psize, num_t** grid); // returns malloc!
 
 // takes puzzle size and grid[][]
-// prints the puzzle
-void printSudokuPuzzle(int psize, int** grid);
+// prints the puzzle, and the box shape if it isn't the default
+void printSudokuPuzzle(int psize, num_t** grid);
+// the same to fp, which readSudokuStream reads back as it was
+void writeSudokuPuzzle(FILE* fp, int psize, num_t** grid);
 
 // takes puzzle size and grid[][]
 // frees the memory allocated
-void deleteSudokuPuzzle(int psize, int** grid);
+void deleteSudokuPuzzle(int psize, num_t** grid);
+
+#endif // SUDOKU_H
@@ -0,0 +1,75 @@
+/**
+ * @file trace.h
+ * @author Hayden Lauritzen (haydenlauritzen@gmail.com)
+ * @date 2023-1-16
+ *
+ * @copyright Copyright (c) 2023
+ *
+ */
+
+#ifndef TRACE_H
+#define TRACE_H
+
+#include <stdbool.h> // bool
+#include <stdint.h>  // uint64_t
+
+ /**
+ *  Tracing
+ * Timestamped spans of what each thread was doing, written out as
+ * Chrome trace-event JSON (load it in chrome://tracing or Perfetto).
+ *
+ * Only built with -DSUDOKU_TRACE. Without it every TRACE_ macro is
+ * empty and trace.c compiles to nothing, so a normal build pays nothing.
+ * With it, nothing is recorded until traceStart.
+ *
+ * Each thread appends to its own buffer with no locks. A buffer is
+ * handed to the next new thread when its thread exits, so the many short
+ * sweep threads share a few buffers. Rows in the viewer are logical
+ * threads, not OS ones: a thread running tasks for row r is row
+ * r * TRACE_FANOUT + its slot.
+*/
+
+// events kept per buffer; later ones are counted and dropped
+#define TRACE_MAX_EVENTS (1 << 20)
+// rows set aside under each row for the task threads it starts
+#define TRACE_FANOUT 1000
+
+// rows of the threads that aren't task threads
+#define TRACE_MAIN 1
+#define TRACE_READER 2
+#define TRACE_WRITER 3
+#define TRACE_WORKERS 10 // pipeline worker w is TRACE_WORKERS + w
+
+#ifdef SUDOKU_TRACE
+
+extern bool traceOn;
+
+// starts recording; filename is written by traceFinish
+void traceStart(const char* filename);
+// writes every span recorded so far, returns false if the file can't be written
+bool traceFinish(void);
+
+uint64_t traceNow(void); // nanoseconds since traceStart
+// records name from start to now on this thread's row
+void traceSpan(const char* name, uint64_t start);
+// puts this thread's spans on row tid and names the row
+void traceThread(int tid, const char* name);
+// this thread's row
+int traceTid(void);
+
+// name must be a string literal, or live until traceFinish
+#define TRACE_BEGIN(span) uint64_t span = traceOn ? traceNow() : 0
+#define TRACE_END(span, name) do { if (traceOn) traceSpan(name, span); } while (0)
+#define TRACE_THREAD(tid, name) do { if (traceOn) traceThread(tid, name); } while (0)
+#define TRACE_TID() (traceOn ? traceTid() : 0)
+
+#else
+
+#define TRACE_BEGIN(span)
+#define TRACE_END(span, name) do { } while (0)
+#define TRACE_THREAD(tid, name) do { } while (0)
+#define TRACE_TID() 0
+
+#endif // SUDOKU_TRACE
+
+#endif // TRACE_H
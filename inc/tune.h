@@ -0,0 +1,76 @@
+/**
+ * @file tune.h
+ * @author Hayden Lauritzen (haydenlauritzen@gmail.com)
+ * @date 2023-1-16
+ *
+ * @copyright Copyright (c) 2023
+ *
+ */
+
+#ifndef TUNE_H
+#define TUNE_H
+
+#include "pipeline.h"
+
+ /**
+ *  Autotuning
+ * The best settings differ between workloads: a stream of easy 9x9s
+ * wants many pipeline workers, a few hard 16x16s want the sweep's own
+ * threads and a different engine. autotune runs a sample of puzzle files
+ * through the pipeline over and over, a setting at a time:
+ *  - engine, per board size: each engine on its own, one worker, lowest
+ *    mean solve time wins and becomes a route for that size
+ *  - pipeline workers, the sweep's threads per puzzle, ring size, batch
+ *    lanes on or off, and puzzles interleaved per worker against one at a
+ *    time, each tried with the others held at their best
+ * Every trial is run TUNE_REPEATS times and its median kept. A setting
+ * wins on throughput, as long as the slowest size's p99 solve time doesn't
+ * grow by more than TUNE_TAIL_SLACK; a setting within TUNE_MIN_GAIN of the
+ * best throughput also wins if it cuts that p99 by TUNE_MIN_GAIN.
+ *
+ * The winner is written as a profile, one setting per line, '#' starts a
+ * comment:
+ *   workers 2
+ *   sweep_threads 1
+ *   ring 16
+ *   batch 0
+ *   interleave 4
+ *   route 9 0 1 0 prop
+ * Routes are dispatch.h's and go in front of the default table. Every run
+ * loads $SUDOKU_PROFILE, or PROFILE_FILE if that isn't set, when the file
+ * exists; options on the command line still win over it.
+*/
+
+#define PROFILE_FILE "sudoku.profile"
+#define PROFILE_MAX_ROUTES 16
+
+#define TUNE_REPEATS 3
+#define TUNE_MIN_GAIN 0.05
+#define TUNE_TAIL_SLACK 1.25
+
+typedef struct profile_t {
+  int workers;        // pipeline workers and enumeration threads, 0 for the default
+  int sweepThreads;   // threads of one sweep, 0 for the default
+  size_t ringSize;    // 0 for the default
+  int batch;          // 1 on, 0 off, -1 for the default
+  int interleave;     // puzzles in flight per pipeline worker, 0 for the default
+  route_t routes[PROFILE_MAX_ROUTES];
+  int numRoutes;
+} profile_t;
+
+// the profile every run loads, NULL if $SUDOKU_PROFILE is set but empty
+const char* profilePath(void);
+
+// fills profile from the file; false if it doesn't exist, or can't be
+// used, which is also printed
+bool loadProfile(const char* filename, profile_t* profile);
+bool writeProfile(const char* filename, profile_t* profile, const char* note);
+
+// sets the defaults options have not changed yet
+void applyProfile(profile_t* profile, run_t* run, pipeConfig_t* pipe);
+
+// tunes on the puzzles in files and writes the profile to filename,
+// printing every trial when verbose; false if no trial could run
+bool autotune(char** files, int numFiles, const char* filename, bool verbose);
+
+#endif // TUNE_H
@@ -1,5 +1,5 @@
 rm -f bin/sudoku.out
-gcc -Wall -Wextra -g3 src/sudoku.c -o bin/sudoku.out -lm -pthread
+gcc -Wall -Wextra -g3 src/*.c -o bin/sudoku.out -lm -pthread
 valgrind ./bin/sudoku.out tests/puzzle9-valid.txt -s --leak-check=full
 valgrind ./bin/sudoku.out tests/puzzle2-valid.txt -s --leak-check=full
 valgrind ./bin/sudoku.out tests/puzzle2-invalid.txt -s --leak-check=full
@@ -9,3 +9,5 @@ valgrind ./bin/sudoku.out tests/puzzle-hard2.txt -s --leak-check=full
 valgrind ./bin/sudoku.out tests/puzzle-hard3.txt -s --leak-check=full
 valgrind ./bin/sudoku.out tests/puzzle-hard4.txt -s --leak-check=full
 valgrind ./bin/sudoku.out tests/puzzle-invalid-hard4.txt -s --leak-check=full
+valgrind -s --leak-check=full ./bin/sudoku.out -c 8 tests/puzzle-hard4.txt tests/puzzle-hard4-variant.txt
+valgrind -s --leak-check=full ./bin/sudoku.out -p -w 2 -q 2 tests/puzzle9-valid.txt tests/puzzle-hard.txt tests/puzzle-hard3.txt
@@ -0,0 +1,45 @@
+#!/bin/bash
+
+# Script to time the solver's kernels one at a time
+# usage: ./microbench.sh [baseline.txt] [kernels options]
+# results go to bin/kernels.txt; given an earlier one as the baseline,
+# kernels more than 10% slower than it are flagged
+mkdir -p bin
+baseline=""
+if [ -f "$1" ]; then
+    baseline=$1
+    shift
+fi
+gcc -Wall -Wextra -O2 bench/kernels.c $(ls src/*.c | grep -v src/main.c) -o bin/kernels.out -lm -pthread || exit 1
+./bin/kernels.out "$@" | tee bin/kernels.txt
+status=${PIPESTATUS[0]}
+if [ "$status" -ne 0 ]; then
+    echo "kernels.out failed with status $status, bin/kernels.txt is incomplete"
+fi
+if [ -n "$baseline" ]; then
+    echo
+    echo "Compared to $baseline:"
+    # a kernel and size the baseline has but this run doesn't is a failure too
+    awk 'NR == FNR {
+            if ($1 ~ /^#/ || NF < 3) next
+            if (!(($1 " " $2) in base)) order[n++] = $1 " " $2
+            base[$1 " " $2] = $3
+            next
+        }
+        $1 !~ /^#/ && (($1 " " $2) in base) {
+            ratio = $3 / base[$1 " " $2]
+            printf "%-16s %4d %6.2fx%s\n", $1, $2, ratio, (ratio > 1.10 ? "  SLOWER" : "")
+            if (ratio > 1.10) slower++
+            seen[$1 " " $2] = 1
+        }
+        END {
+            for (i = 0; i < n; ++i) {
+                if (order[i] in seen) continue
+                split(order[i], k, " ")
+                printf "%-16s %4d    MISSING\n", k[1], k[2]
+                missing++
+            }
+            exit slower + missing > 0
+        }' "$baseline" bin/kernels.txt || status=1
+fi
+exit $status
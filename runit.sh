@@ -2,7 +2,7 @@
 
 # Script to compile and run sudoku program
 rm -f bin/sudoku.out
-gcc -Wall -Wextra src/sudoku.c -o bin/sudoku.out -lm -pthread
+gcc -Wall -Wextra src/*.c -o bin/sudoku.out -lm -pthread
 ./bin/sudoku.out tests/puzzle9-valid.txt
 ./bin/sudoku.out tests/puzzle2-valid.txt
 ./bin/sudoku.out tests/puzzle2-invalid.txt
@@ -10,8 +10,32 @@ gcc -Wall -Wextra src/sudoku.c -o bin/sudoku.out -lm -pthread
 ./bin/sudoku.out tests/puzzle-hard.txt
 ./bin/sudoku.out tests/puzzle-hard2.txt
 ./bin/sudoku.out tests/puzzle-hard3.txt
+./bin/sudoku.out -s -r tests/routes.txt tests/puzzle2-fill-valid.txt tests/puzzle-hard2.txt
+./bin/sudoku.out -e sweep tests/puzzle-hard.txt
+./bin/sudoku.out -e sweep -d 65536 tests/puzzle9-long.txt tests/puzzle9-long.txt
+rm -f bin/checkpoint.bin; sh -c "timeout -s KILL 1.5 ./bin/sudoku.out -s -e sweep -k bin/checkpoint.bin -i 0 tests/puzzle16-long.txt > /dev/null" 2> /dev/null; test -s bin/checkpoint.bin && echo "Checkpoint left by the stopped search"
+./bin/sudoku.out -s -e sweep -k bin/checkpoint.bin tests/puzzle16-long.txt | sed "s/after [0-9]* guesses/after N guesses/; s/resumed, .*/resumed/"; test -e bin/checkpoint.bin || echo "Checkpoint removed once solved"
+./bin/sudoku.out -s tests/puzzle36.txt tests/puzzle49.txt tests/puzzle100.txt
+./bin/sudoku.out -e sat tests/puzzle-hard4.txt tests/puzzle-invalid-hard4.txt
+./bin/sudoku.out -e portfolio tests/puzzle-hard3.txt tests/puzzle-invalid-hard4.txt
 ./bin/sudoku.out tests/puzzle-hard4.txt
 ./bin/sudoku.out tests/puzzle-invalid-hard4.txt
+./bin/sudoku.out -c 8 -s tests/puzzle-hard4.txt tests/puzzle-hard4-variant.txt tests/puzzle-hard3.txt
+printf 'hint\nclear 1 1\nclear 1 2\nhint\nset 1 1 2\nhint\ncheck\nclear 1 1\nstep\nsolvable\nprint\nquit\n' | ./bin/sudoku.out -l tests/puzzle9-valid.txt
+./bin/sudoku.out -p -w 2 -q 2 tests/puzzle9-valid.txt tests/puzzle2-invalid.txt tests/puzzle-hard.txt tests/puzzle-hard2.txt tests/puzzle-hard3.txt
+./bin/sudoku.out -p -b -s -w 2 -q 4 tests/puzzles-stream.txt
+./bin/sudoku.out -p -w 2 -m bin/metrics.prom tests/puzzles-stream.txt > /dev/null && grep -c _count bin/metrics.prom
+./bin/sudoku.out -n -w 2 tests/puzzle2-empty.txt tests/puzzle2-fill-valid.txt
+./bin/sudoku.out -o bin/tune.profile tests/puzzles-stream.txt > /dev/null && grep -c "^route" bin/tune.profile
+./bin/sudoku.out -p tests/puzzles-bad.txt
+./bin/sudoku.out -p -s -w 1 -j 8 tests/puzzles-stream.txt | grep "^Interleave"
+./bin/sudoku.out tests/puzzle6.txt tests/puzzle8-tall.txt tests/puzzle12.txt
+./bin/sudoku.out -p -b -s -w 2 tests/puzzle6.txt tests/puzzle8-tall.txt tests/puzzle12.txt | grep "^Batch"
+./bin/sudoku.out -s -c 8 tests/puzzle12.txt tests/puzzle12.txt | grep "^Cache"
+rm -f bin/store.bin && ./bin/sudoku.out -g bin/store.bin tests/puzzle-hard.txt tests/puzzle12.txt > /dev/null && ./bin/sudoku.out -g bin/store.bin tests/puzzle-hard.txt tests/puzzle12.txt | grep "store\|^Store"
+./bin/sudoku.out -g bin/store.bin -x
+./bin/sudoku.out -f 2 -y 10 -s tests/puzzles-stream.txt | grep "^Shards\|^  shard\|^Dispatch" | sed "s/[0-9.]*s (.*//"
+./bin/sudoku.out -f 2 -y 2 tests/puzzles-bad.txt tests/puzzle6.txt tests/puzzle12.txt
 
 # to check for memory leaks, use
 # valgrind ./sudoku puzzle9-good.txt
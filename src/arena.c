@@ -0,0 +1,87 @@
+/**
+ * @file arena.c
+ * @author Hayden Lauritzen (haydenlauritzen@gmail.com)
+ * @date 2023-1-16
+ *
+ * @copyright Copyright (c) 2023
+ *
+ */
+
+#include <stdlib.h>
+#include <string.h> // memset()
+
+#include "../inc/arena.h"
+
+#define ARENA_ALIGN 16
+
+static arenaBlock_t* createBlock(size_t size) {
+    arenaBlock_t* block = (arenaBlock_t*)malloc(sizeof(arenaBlock_t));
+    block->next = NULL;
+    block->size = size;
+    block->used = 0;
+    block->data = (char*)malloc(size);
+    return block;
+}
+
+arena_t* createArena(size_t size) {
+    arena_t* arena = (arena_t*)malloc(sizeof(arena_t));
+    arena->first = createBlock(size);
+    arena->current = arena->first;
+    arena->inUse = 0;
+    arena->peak = 0;
+    arena->capacity = size;
+    return arena;
+}
+
+void* arenaAlloc(arena_t* arena, size_t bytes) {
+    bytes = (bytes + ARENA_ALIGN - 1) & ~(size_t)(ARENA_ALIGN - 1);
+    arenaBlock_t* block = arena->current;
+    while (block->used + bytes > block->size) {
+        // move on to the next block, chaining a new one if needed
+        if (block->next == NULL || block->next->size < bytes) {
+            size_t size = block->size > bytes ? block->size : bytes;
+            arenaBlock_t* added = createBlock(size);
+            added->next = block->next;
+            block->next = added;
+            arena->capacity += size;
+        }
+        block = block->next;
+        block->used = 0;
+    }
+    arena->current = block;
+    void* ptr = block->data + block->used;
+    block->used += bytes;
+    arena->inUse += bytes;
+    if (arena->inUse > arena->peak) arena->peak = arena->inUse;
+    memset(ptr, 0, bytes);
+    return ptr;
+}
+
+arenaMark_t arenaMark(arena_t* arena) {
+    arenaMark_t mark = { arena->current, arena->current->used, arena->inUse };
+    return mark;
+}
+
+void arenaRelease(arena_t* arena, arenaMark_t mark) {
+    arena->current = mark.block;
+    mark.block->used = mark.used;
+    arena->inUse = mark.inUse;
+}
+
+void arenaReset(arena_t* arena) {
+    arena->current = arena->first;
+    arena->first->used = 0;
+    arena->inUse = 0;
+    arena->peak = 0;
+}
+
+void deleteArena(arena_t* arena) {
+    arenaBlock_t* block = arena->first;
+    while (block != NULL) {
+        arenaBlock_t* next = block->next;
+        free(block->data);
+        free(block);
+        block = next;
+    }
+    free(arena);
+}
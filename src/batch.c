@@ -0,0 +1,172 @@
+/**
+ * @file batch.c
+ * @author Hayden Lauritzen (haydenlauritzen@gmail.com)
+ * @date 2023-1-16
+ *
+ * @copyright Copyright (c) 2023
+ *
+ */
+
+#include "../inc/batch.h"
+#include "../inc/shape.h"
+
+bool batchFits(int psize, num_t** grid) {
+    return psize <= BATCH_MAX_PSIZE && grid[0][0] == 0;
+}
+
+batch_t* createBatch(int psize) {
+    batch_t* batch = (batch_t*)calloc(1, sizeof(batch_t));
+    batch->psize = psize;
+    batch->cells = psize * psize;
+    batch->units = (int*)malloc(sizeof(int) * 3 * psize * psize);
+    batch->cand = (uint16_t*)malloc(sizeof(uint16_t) * batch->cells * BATCH_LANES);
+    const shape_t* shape = findShape(psize, 0);
+    for (int i = 0; i < psize; ++i) {
+        int* row = batch->units + i * psize;
+        int* col = batch->units + (psize + i) * psize;
+        int* box = batch->units + (2 * psize + i) * psize;
+        for (int j = 0; j < psize; ++j) {
+            row[j] = i * psize + j;
+            col[j] = j * psize + i;
+            box[j] = shape->cells[i * psize + j].row * psize + shape->cells[i * psize + j].col;
+        }
+    }
+    batchClear(batch);
+    return batch;
+}
+
+void deleteBatch(batch_t* batch) {
+    free(batch->units);
+    free(batch->cand);
+    free(batch);
+}
+
+void batchClear(batch_t* batch) {
+    // empty lanes hold every candidate everywhere, which never changes
+    uint16_t all = (uint16_t)((1u << batch->psize) - 1);
+    for (int i = 0; i < batch->cells * BATCH_LANES; ++i) {
+        batch->cand[i] = all;
+    }
+    memset(batch->failed, 0, sizeof(batch->failed));
+    batch->lanes = 0;
+}
+
+int batchLoad(batch_t* batch, num_t** grid) {
+    int lane = batch->lanes++;
+    int psize = batch->psize;
+    uint16_t all = (uint16_t)((1u << psize) - 1);
+    for (int row = 1; row <= psize; ++row) {
+        for (int col = 1; col <= psize; ++col) {
+            int num = grid[row][col];
+            uint16_t* cell = batch->cand + ((row - 1) * psize + col - 1) * BATCH_LANES;
+            cell[lane] = num ? (uint16_t)(1u << (num - 1)) : all;
+        }
+    }
+    ++(batch->loaded);
+    return lane;
+}
+
+// one pass of naked then hidden singles over every unit, returns true if any lane changed
+static bool propagatePass(batch_t* batch) {
+    int psize = batch->psize;
+    uint16_t all = (uint16_t)((1u << psize) - 1);
+    uint16_t changed[BATCH_LANES] = { 0 };
+    // a local copy can't alias the candidates, so the lane loops vectorize
+    uint16_t failed[BATCH_LANES];
+    memcpy(failed, batch->failed, sizeof(failed));
+    for (int u = 0; u < 3 * psize; ++u) {
+        int* unit = batch->units + u * psize;
+        uint16_t fixed[BATCH_LANES] = { 0 };
+        uint16_t fixedTwice[BATCH_LANES] = { 0 };
+        // naked singles: numbers already placed in the unit
+        for (int i = 0; i < psize; ++i) {
+            uint16_t* cell = batch->cand + unit[i] * BATCH_LANES;
+            for (int l = 0; l < BATCH_LANES; ++l) {
+                uint16_t x = cell[l];
+                uint16_t single = (uint16_t)-((x & (x - 1)) == 0);
+                fixedTwice[l] |= fixed[l] & x & single;
+                fixed[l] |= x & single;
+            }
+        }
+        uint16_t once[BATCH_LANES] = { 0 };
+        uint16_t twice[BATCH_LANES] = { 0 };
+        for (int i = 0; i < psize; ++i) {
+            uint16_t* cell = batch->cand + unit[i] * BATCH_LANES;
+            for (int l = 0; l < BATCH_LANES; ++l) {
+                uint16_t x = cell[l];
+                uint16_t single = (uint16_t)-((x & (x - 1)) == 0);
+                uint16_t y = x & (~fixed[l] | single);
+                changed[l] |= x ^ y;
+                cell[l] = y;
+                twice[l] |= once[l] & y;
+                once[l] |= y;
+            }
+        }
+        // hidden singles: numbers with one place left in the unit
+        for (int i = 0; i < psize; ++i) {
+            uint16_t* cell = batch->cand + unit[i] * BATCH_LANES;
+            for (int l = 0; l < BATCH_LANES; ++l) {
+                uint16_t x = cell[l];
+                uint16_t hidden = x & once[l] & ~twice[l];
+                uint16_t take = (uint16_t)-(hidden != 0);
+                uint16_t y = (hidden & take) | (x & ~take);
+                // an empty cell, or a cell that is the only place for two numbers
+                failed[l] |= (uint16_t)-((y == 0) | (((y & (y - 1)) != 0) & (hidden != 0)));
+                changed[l] |= x ^ y;
+                cell[l] = y;
+            }
+        }
+        for (int l = 0; l < BATCH_LANES; ++l) {
+            // a number placed twice or with nowhere to go
+            failed[l] |= (uint16_t)-((fixedTwice[l] != 0) | (once[l] != all));
+        }
+    }
+    memcpy(batch->failed, failed, sizeof(failed));
+    bool any = false;
+    for (int l = 0; l < BATCH_LANES; ++l) {
+        // failed lanes may keep changing, they don't hold the batch up
+        any |= (changed[l] & ~failed[l]) != 0;
+    }
+    return any;
+}
+
+void batchPropagate(batch_t* batch) {
+    TRACE_BEGIN(span);
+    while (propagatePass(batch)) {
+        ++(batch->passes);
+    }
+    ++(batch->passes);
+    TRACE_END(span, "batch lanes");
+}
+
+laneStatus_e batchStore(batch_t* batch, int lane, num_t** grid) {
+    if (batch->failed[lane]) {
+        ++(batch->unsolvable);
+        return LANE_FAILED;
+    }
+    int psize = batch->psize;
+    bool full = true;
+    for (int row = 1; row <= psize; ++row) {
+        for (int col = 1; col <= psize; ++col) {
+            uint16_t x = batch->cand[((row - 1) * psize + col - 1) * BATCH_LANES + lane];
+            if (x & (x - 1)) {
+                full = false;
+                continue;
+            }
+            int num = 1;
+            while (!(x & 1)) {
+                x >>= 1;
+                ++num;
+            }
+            grid[row][col] = (num_t)num;
+        }
+    }
+    if (full) ++(batch->solved);
+    else ++(batch->open);
+    return full ? LANE_SOLVED : LANE_OPEN;
+}
+
+void printBatchStats(batch_t* batch) {
+    printf("Batch %dx%d: %ld lanes loaded, %ld solved in lanes, %ld left for search, %ld unsolvable, %ld passes\n",
+        batch->psize, batch->psize, batch->loaded, batch->solved, batch->open, batch->unsolvable, batch->passes);
+}
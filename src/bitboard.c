@@ -0,0 +1,151 @@
+/**
+ * @file bitboard.c
+ * @author Hayden Lauritzen (haydenlauritzen@gmail.com)
+ * @date 2023-1-16
+ *
+ * @copyright Copyright (c) 2023
+ *
+ */
+
+#include "../inc/bitboard.h"
+
+#define BOX 3
+#define NUM_UNITS (3 * BITBOARD_PSIZE)
+
+// rows, then columns, then boxes
+static bits81_t units[NUM_UNITS];
+static bits81_t peers[BITBOARD_CELLS];
+static pthread_once_t tablesOnce = PTHREAD_ONCE_INIT;
+
+static bits81_t cellBit(int cell) {
+    return (bits81_t)1 << cell;
+}
+
+static bool isSingle(bits81_t bits) {
+    return bits && !(bits & (bits - 1));
+}
+
+static int lowestCell(bits81_t bits) {
+    uint64_t low = (uint64_t)bits;
+    if (low) return __builtin_ctzll(low);
+    return 64 + __builtin_ctzll((uint64_t)(bits >> 64));
+}
+
+static void makeTables(void) {
+    for (int cell = 0; cell < BITBOARD_CELLS; ++cell) {
+        int row = cell / BITBOARD_PSIZE, col = cell % BITBOARD_PSIZE;
+        int box = (row / BOX) * BOX + col / BOX;
+        units[row] |= cellBit(cell);
+        units[BITBOARD_PSIZE + col] |= cellBit(cell);
+        units[2 * BITBOARD_PSIZE + box] |= cellBit(cell);
+    }
+    for (int cell = 0; cell < BITBOARD_CELLS; ++cell) {
+        int row = cell / BITBOARD_PSIZE, col = cell % BITBOARD_PSIZE;
+        int box = (row / BOX) * BOX + col / BOX;
+        peers[cell] = (units[row] | units[BITBOARD_PSIZE + col] | units[2 * BITBOARD_PSIZE + box]) & ~cellBit(cell);
+    }
+}
+
+bool loadBitboard(bitboard_t* board, num_t** grid) {
+    pthread_once(&tablesOnce, makeTables);
+    memset(board, 0, sizeof(bitboard_t));
+    board->empty = units[0] | units[1] | units[2] | units[3] | units[4] | units[5] | units[6] | units[7] | units[8];
+    for (int num = 1; num <= BITBOARD_PSIZE; ++num) {
+        board->cand[num] = board->empty;
+    }
+    for (int row = 1; row <= BITBOARD_PSIZE; ++row) {
+        for (int col = 1; col <= BITBOARD_PSIZE; ++col) {
+            int num = grid[row][col];
+            if (num == 0) continue;
+            if (!bitboardFits(board, row, col, num)) return false;
+            bitboardPlace(board, row, col, num);
+        }
+    }
+    return true;
+}
+
+bool bitboardFits(bitboard_t* board, int row, int col, int num) {
+    return (board->cand[num] & cellBit((row - 1) * BITBOARD_PSIZE + col - 1)) != 0;
+}
+
+void bitboardPlace(bitboard_t* board, int row, int col, int num) {
+    int cell = (row - 1) * BITBOARD_PSIZE + col - 1;
+    bits81_t bit = cellBit(cell);
+    for (int n = 1; n <= BITBOARD_PSIZE; ++n) {
+        board->cand[n] &= ~bit;
+    }
+    board->cand[num] &= ~peers[cell];
+    board->placed[num] |= bit;
+    board->empty &= ~bit;
+}
+
+// naked and hidden singles, -1 if a cell or a unit has run out of places
+static int findSingles(bitboard_t* board, bitMove_t* moves) {
+    // cells in one candidate board and in two or more
+    bits81_t once = 0, twice = 0;
+    for (int num = 1; num <= BITBOARD_PSIZE; ++num) {
+        twice |= once & board->cand[num];
+        once |= board->cand[num];
+    }
+    if (board->empty & ~once) return -1;
+    bits81_t found = 0;
+    int count = 0;
+    for (int num = 1; num <= BITBOARD_PSIZE; ++num) {
+        bits81_t cand = board->cand[num];
+        // naked: the only board the cell is in
+        bits81_t naked = cand & once & ~twice;
+        // hidden: the only cell of a unit the number can go in
+        for (int unit = 0; unit < NUM_UNITS; ++unit) {
+            if (board->placed[num] & units[unit]) continue;
+            bits81_t places = cand & units[unit];
+            if (places == 0) return -1;
+            if (isSingle(places)) naked |= places;
+        }
+        naked &= ~found;
+        found |= naked;
+        while (naked) {
+            int cell = lowestCell(naked);
+            naked &= naked - 1;
+            moves[count++] = (bitMove_t){ cell / BITBOARD_PSIZE + 1, cell % BITBOARD_PSIZE + 1, num };
+        }
+    }
+    return count;
+}
+
+// takes out candidates a box locks into a line or a line into a box,
+// returns true if any went
+static bool lockCandidates(bitboard_t* board) {
+    bool changed = false;
+    for (int num = 1; num <= BITBOARD_PSIZE; ++num) {
+        bits81_t cand = board->cand[num];
+        for (int box = 0; box < BITBOARD_PSIZE; ++box) {
+            bits81_t inBox = units[2 * BITBOARD_PSIZE + box];
+            for (int i = 0; i < BOX; ++i) {
+                bits81_t row = units[(box / BOX) * BOX + i];
+                bits81_t col = units[BITBOARD_PSIZE + (box % BOX) * BOX + i];
+                for (int k = 0; k < 2; ++k) {
+                    bits81_t line = k ? col : row;
+                    bits81_t shared = cand & inBox & line;
+                    if (shared == 0) continue;
+                    // pointing: the box's places are all on the line
+                    if (!(cand & inBox & ~line)) cand &= ~(line & ~inBox);
+                    // claiming: the line's places are all in the box
+                    else if (!(cand & line & ~inBox)) cand &= ~(inBox & ~line);
+                }
+            }
+        }
+        if (cand != board->cand[num]) {
+            board->cand[num] = cand;
+            changed = true;
+        }
+    }
+    return changed;
+}
+
+int bitboardDeduce(bitboard_t* board, bitMove_t* moves) {
+    while (true) {
+        int count = findSingles(board, moves);
+        if (count != 0) return count;
+        if (!lockCandidates(board)) return 0;
+    }
+}
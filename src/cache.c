@@ -0,0 +1,349 @@
+/**
+ * @file cache.c
+ * @author Hayden Lauritzen (haydenlauritzen@gmail.com)
+ * @date 2023-1-16
+ *
+ * @copyright Copyright (c) 2023
+ *
+ */
+
+#include "../inc/cache.h"
+#include "../inc/shape.h"
+
+// largest board that searches the full symmetry group
+#define CANON_FULL_MAX 9
+// cells read before the search settles for the best form so far,
+// so big boards give up after fewer rows
+#define CANON_BUDGET (1L << 25)
+
+// state for the canonical form search
+typedef struct canonSearch_t {
+    int psize;
+    int bandSize;   // rows in a band
+    int stackSize;  // cols in a stack
+    bool full;      // permute rows and cols inside bands and stacks
+    num_t** grid;
+    bool transposed;
+    int* rowMap;
+    int* colMap;
+    bool* usedRow;  // source rows already placed
+    bool* usedCol;  // source cols already placed
+    int** labels;   // labels[k] = labeling after k rows
+    int* nextLabel; // nextLabel[k] = labels handed out after k rows
+    int* row;       // scratch row
+    int* best;      // best rows found so far
+    bool* bestSet;  // best[k] has been filled
+    long budget;
+    canon_t* canon;
+} canonSearch_t;
+
+static int sourceCell(canonSearch_t* s, int row, int col) {
+    return s->transposed ? s->grid[col][row] : s->grid[row][col];
+}
+
+static void recordCanon(canonSearch_t* s) {
+    canon_t* canon = s->canon;
+    int psize = s->psize;
+    canon->transposed = s->transposed;
+    memcpy(canon->rowMap, s->rowMap, sizeof(int) * (psize + 1));
+    memcpy(canon->colMap, s->colMap, sizeof(int) * (psize + 1));
+    memcpy(canon->label, s->labels[psize], sizeof(int) * (psize + 1));
+    // digits missing from the puzzle are interchangeable, keep them in order
+    int next = s->nextLabel[psize];
+    for (int num = 1; num <= psize; ++num) {
+        if (canon->label[num] == 0) canon->label[num] = ++next;
+    }
+}
+
+static void searchRows(canonSearch_t* s, int k, bool improved) {
+    int psize = s->psize;
+    if (k == psize) {
+        if (improved) recordCanon(s);
+        return;
+    }
+    int bandSize = s->bandSize;
+    // rows are taken band by band
+    int firstBand = 0;
+    int lastBand = psize / bandSize - 1;
+    if (k % bandSize != 0) {
+        firstBand = lastBand = (s->rowMap[k] - 1) / bandSize;
+    }
+    for (int band = firstBand; band <= lastBand; ++band) {
+        if (k % bandSize == 0 && s->usedRow[band * bandSize + 1]) continue;
+        for (int i = 0; i < bandSize; ++i) {
+            int row = band * bandSize + i + 1;
+            if (s->usedRow[row] || (!s->full && i != k % bandSize)) continue;
+            s->budget -= psize;
+            if (s->budget < 0 && s->canon->rowMap[1] != 0) return;
+            // relabel the row in the order digits are first seen
+            int* label = s->labels[k + 1];
+            memcpy(label, s->labels[k], sizeof(int) * (psize + 1));
+            int next = s->nextLabel[k];
+            for (int col = 1; col <= psize; ++col) {
+                int num = sourceCell(s, row, s->colMap[col]);
+                if (num != 0 && label[num] == 0) label[num] = ++next;
+                s->row[col - 1] = num == 0 ? 0 : label[num];
+            }
+            s->nextLabel[k + 1] = next;
+            int* best = s->best + k * psize;
+            int cmp = -1;
+            if (s->bestSet[k]) {
+                cmp = 0;
+                for (int col = 0; col < psize && cmp == 0; ++col) {
+                    if (s->row[col] != best[col]) cmp = s->row[col] < best[col] ? -1 : 1;
+                }
+            }
+            if (cmp > 0) continue;
+            if (cmp < 0) {
+                memcpy(best, s->row, sizeof(int) * psize);
+                s->bestSet[k] = true;
+                for (int j = k + 1; j < psize; ++j) {
+                    s->bestSet[j] = false;
+                }
+            }
+            s->rowMap[k + 1] = row;
+            s->usedRow[row] = true;
+            searchRows(s, k + 1, improved || cmp < 0);
+            s->usedRow[row] = false;
+        }
+    }
+}
+
+static void searchCols(canonSearch_t* s, int k) {
+    int psize = s->psize;
+    if (s->budget < 0 && s->canon->rowMap[1] != 0) return;
+    if (k == psize) {
+        searchRows(s, 0, false);
+        return;
+    }
+    int stackSize = s->stackSize;
+    // cols are taken stack by stack
+    int firstStack = 0;
+    int lastStack = psize / stackSize - 1;
+    if (k % stackSize != 0) {
+        firstStack = lastStack = (s->colMap[k] - 1) / stackSize;
+    }
+    for (int stack = firstStack; stack <= lastStack; ++stack) {
+        if (k % stackSize == 0 && s->usedCol[stack * stackSize + 1]) continue;
+        for (int i = 0; i < stackSize; ++i) {
+            int col = stack * stackSize + i + 1;
+            if (s->usedCol[col] || (!s->full && i != k % stackSize)) continue;
+            s->colMap[k + 1] = col;
+            s->usedCol[col] = true;
+            searchCols(s, k + 1);
+            s->usedCol[col] = false;
+        }
+    }
+}
+
+canon_t* canonicalize(int psize, num_t** grid) {
+    canon_t* canon = (canon_t*)malloc(sizeof(canon_t));
+    canon->psize = psize;
+    canon->boxRows = grid[0][0];
+    canon->rowMap = (int*)calloc(psize + 1, sizeof(int));
+    canon->colMap = (int*)calloc(psize + 1, sizeof(int));
+    canon->label = (int*)calloc(psize + 1, sizeof(int));
+    canon->key = (num_t*)malloc(sizeof(num_t) * psize * psize);
+
+    canonSearch_t s;
+    s.psize = psize;
+    const shape_t* shape = getShape(psize, grid);
+    s.bandSize = shape->boxRows;
+    s.stackSize = shape->boxCols;
+    s.full = psize <= CANON_FULL_MAX;
+    if (shape->boxRows == 1 && psize > 1) {
+        // no bands to permute, only relabel and transpose
+        s.bandSize = s.stackSize = psize;
+        s.full = false;
+    }
+    // swapping rows for cols only keeps boxes as boxes when they're square
+    bool transposes = shape->boxRows == shape->boxCols || s.bandSize == psize;
+    s.grid = grid;
+    s.rowMap = (int*)calloc(psize + 1, sizeof(int));
+    s.colMap = (int*)calloc(psize + 1, sizeof(int));
+    s.usedRow = (bool*)calloc(psize + 1, sizeof(bool));
+    s.usedCol = (bool*)calloc(psize + 1, sizeof(bool));
+    s.labels = (int**)malloc(sizeof(int*) * (psize + 1));
+    for (int k = 0; k <= psize; ++k) {
+        s.labels[k] = (int*)calloc(psize + 1, sizeof(int));
+    }
+    s.nextLabel = (int*)calloc(psize + 1, sizeof(int));
+    s.row = (int*)malloc(sizeof(int) * psize);
+    s.best = (int*)malloc(sizeof(int) * psize * psize);
+    s.bestSet = (bool*)calloc(psize, sizeof(bool));
+    s.budget = CANON_BUDGET;
+    s.canon = canon;
+    for (int t = 0; t < (transposes ? 2 : 1); ++t) {
+        s.transposed = t;
+        searchCols(&s, 0);
+    }
+
+    // build the key from the transform that won
+    for (int row = 1; row <= psize; ++row) {
+        for (int col = 1; col <= psize; ++col) {
+            int r = canon->rowMap[row];
+            int c = canon->colMap[col];
+            int num = canon->transposed ? grid[c][r] : grid[r][c];
+            canon->key[(row - 1) * psize + (col - 1)] = num == 0 ? 0 : canon->label[num];
+        }
+    }
+    // FNV-1a
+    canon->hash = 2166136261UL;
+    if (canon->boxRows) canon->hash = (canon->hash ^ (unsigned long)canon->boxRows) * 16777619UL;
+    for (int i = 0; i < psize * psize; ++i) {
+        canon->hash = (canon->hash ^ (unsigned long)canon->key[i]) * 16777619UL;
+    }
+
+    for (int k = 0; k <= psize; ++k) {
+        free(s.labels[k]);
+    }
+    free(s.labels);
+    free(s.rowMap);
+    free(s.colMap);
+    free(s.usedRow);
+    free(s.usedCol);
+    free(s.nextLabel);
+    free(s.row);
+    free(s.best);
+    free(s.bestSet);
+    return canon;
+}
+
+void deleteCanon(canon_t* canon) {
+    free(canon->rowMap);
+    free(canon->colMap);
+    free(canon->label);
+    free(canon->key);
+    free(canon);
+}
+
+cache_t* createCache(int capacity) {
+    cache_t* cache = (cache_t*)calloc(1, sizeof(cache_t));
+    cache->capacity = capacity;
+    cache->numBuckets = 2 * capacity + 1;
+    cache->buckets = (cacheEntry_t**)calloc(cache->numBuckets, sizeof(cacheEntry_t*));
+    return cache;
+}
+
+static cacheEntry_t* findEntry(cache_t* cache, canon_t* canon) {
+    cacheEntry_t* entry = cache->buckets[canon->hash % cache->numBuckets];
+    while (entry != NULL) {
+        if (entry->hash == canon->hash && entry->psize == canon->psize && entry->boxRows == canon->boxRows &&
+            memcmp(entry->key, canon->key, sizeof(num_t) * canon->psize * canon->psize) == 0) {
+            return entry;
+        }
+        entry = entry->next;
+    }
+    return NULL;
+}
+
+static void unlinkEntry(cache_t* cache, cacheEntry_t* entry) {
+    if (entry->newer) entry->newer->older = entry->older;
+    else cache->newest = entry->older;
+    if (entry->older) entry->older->newer = entry->newer;
+    else cache->oldest = entry->newer;
+    entry->newer = entry->older = NULL;
+}
+
+static void pushNewest(cache_t* cache, cacheEntry_t* entry) {
+    entry->older = cache->newest;
+    entry->newer = NULL;
+    if (cache->newest) cache->newest->newer = entry;
+    cache->newest = entry;
+    if (cache->oldest == NULL) cache->oldest = entry;
+}
+
+static void evictOldest(cache_t* cache) {
+    cacheEntry_t* entry = cache->oldest;
+    unlinkEntry(cache, entry);
+    cacheEntry_t** link = &cache->buckets[entry->hash % cache->numBuckets];
+    while (*link != entry) {
+        link = &(*link)->next;
+    }
+    *link = entry->next;
+    free(entry->key);
+    free(entry->solution);
+    free(entry);
+    --(cache->size);
+    ++(cache->evictions);
+}
+
+bool cacheLookup(cache_t* cache, canon_t* canon, num_t** grid) {
+    cacheEntry_t* entry = findEntry(cache, canon);
+    if (entry == NULL) {
+        ++(cache->misses);
+        return false;
+    }
+    ++(cache->hits);
+    unlinkEntry(cache, entry);
+    pushNewest(cache, entry);
+    // map the canonical solution back onto the puzzle
+    int psize = canon->psize;
+    int* inv = (int*)calloc(psize + 1, sizeof(int));
+    for (int num = 1; num <= psize; ++num) {
+        inv[canon->label[num]] = num;
+    }
+    for (int row = 1; row <= psize; ++row) {
+        for (int col = 1; col <= psize; ++col) {
+            int r = canon->rowMap[row];
+            int c = canon->colMap[col];
+            int num = inv[entry->solution[(row - 1) * psize + (col - 1)]];
+            if (canon->transposed) grid[c][r] = num;
+            else grid[r][c] = num;
+        }
+    }
+    free(inv);
+    return true;
+}
+
+void cacheInsert(cache_t* cache, canon_t* canon, num_t** solution) {
+    if (cache->capacity <= 0) return;
+    cacheEntry_t* entry = findEntry(cache, canon);
+    if (entry != NULL) {
+        unlinkEntry(cache, entry);
+        pushNewest(cache, entry);
+        return;
+    }
+    if (cache->size >= cache->capacity) evictOldest(cache);
+    int psize = canon->psize;
+    entry = (cacheEntry_t*)calloc(1, sizeof(cacheEntry_t));
+    entry->psize = psize;
+    entry->boxRows = canon->boxRows;
+    entry->hash = canon->hash;
+    entry->key = (num_t*)malloc(sizeof(num_t) * psize * psize);
+    memcpy(entry->key, canon->key, sizeof(num_t) * psize * psize);
+    entry->solution = (num_t*)malloc(sizeof(num_t) * psize * psize);
+    for (int row = 1; row <= psize; ++row) {
+        for (int col = 1; col <= psize; ++col) {
+            int r = canon->rowMap[row];
+            int c = canon->colMap[col];
+            int num = canon->transposed ? solution[c][r] : solution[r][c];
+            entry->solution[(row - 1) * psize + (col - 1)] = canon->label[num];
+        }
+    }
+    cacheEntry_t** bucket = &cache->buckets[entry->hash % cache->numBuckets];
+    entry->next = *bucket;
+    *bucket = entry;
+    pushNewest(cache, entry);
+    ++(cache->size);
+}
+
+void printCacheStats(cache_t* cache) {
+    long lookups = cache->hits + cache->misses;
+    printf("Cache: %ld hits, %ld misses, %ld evictions, %d/%d entries, hit rate %.1f%%\n",
+        cache->hits, cache->misses, cache->evictions, cache->size, cache->capacity,
+        lookups ? 100.0 * cache->hits / lookups : 0.0);
+}
+
+void deleteCache(cache_t* cache) {
+    cacheEntry_t* entry = cache->newest;
+    while (entry != NULL) {
+        cacheEntry_t* older = entry->older;
+        free(entry->key);
+        free(entry->solution);
+        free(entry);
+        entry = older;
+    }
+    free(cache->buckets);
+    free(cache);
+}
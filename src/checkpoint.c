@@ -0,0 +1,234 @@
+/**
+ * @file checkpoint.c
+ * @author Hayden Lauritzen (haydenlauritzen@gmail.com)
+ * @date 2023-1-16
+ *
+ * @copyright Copyright (c) 2023
+ *
+ */
+
+#include <time.h> // clock_gettime()
+
+#include "../inc/checkpoint.h"
+#include "../inc/bitboard.h"
+
+#define CHECKPOINT_MAGIC "SDKCKPT1"
+// guesses between looks at the clock
+#define CHECKPOINT_MOVES 64
+
+static double now(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+checkpoint_t* createCheckpoint(const char* filename, double interval) {
+    checkpoint_t* checkpoint = (checkpoint_t*)calloc(1, sizeof(checkpoint_t));
+    checkpoint->filename = strdup(filename);
+    checkpoint->interval = interval;
+    return checkpoint;
+}
+
+void deleteCheckpoint(checkpoint_t* checkpoint) {
+    free(checkpoint->filename);
+    free(checkpoint);
+}
+
+unsigned long puzzleHash(int psize, num_t** grid) {
+    unsigned long hash = 2166136261UL;
+    hash = (hash ^ (unsigned long)psize) * 16777619UL;
+    // the box shape, 0 for the default
+    hash = (hash ^ grid[0][0]) * 16777619UL;
+    for (int row = 1; row <= psize; ++row) {
+        for (int col = 1; col <= psize; ++col) {
+            hash = (hash ^ grid[row][col]) * 16777619UL;
+        }
+    }
+    return hash;
+}
+
+// rows 1 to psize of a board, psize + 1 cells each
+static bool writeBoard(FILE* fp, num_t* cells, int psize) {
+    size_t count = (size_t)psize * (psize + 1);
+    return fwrite(cells + psize + 1, sizeof(num_t), count, fp) == count;
+}
+
+static bool readBoard(FILE* fp, num_t* cells, int psize) {
+    size_t count = (size_t)psize * (psize + 1);
+    return fread(cells + psize + 1, sizeof(num_t), count, fp) == count;
+}
+
+long saveSearch(search_t* search, unsigned long hash, const char* filename) {
+    int psize = search->psize;
+    // write beside the old checkpoint, then swap it in
+    size_t length = strlen(filename);
+    char* temp = (char*)malloc(length + 5);
+    memcpy(temp, filename, length);
+    memcpy(temp + length, ".tmp", 5);
+    FILE* fp = fopen(temp, "wb");
+    if (fp == NULL) {
+        free(temp);
+        return 0;
+    }
+    uint64_t hash64 = hash;
+    int32_t header[4] = { psize, search->status, search->depth, search->maxDepth };
+    int64_t guesses = search->guesses;
+    bool ok = fwrite(CHECKPOINT_MAGIC, 1, 8, fp) == 8
+        && fwrite(&hash64, sizeof(hash64), 1, fp) == 1
+        && fwrite(header, sizeof(header), 1, fp) == 1
+        && fwrite(&guesses, sizeof(guesses), 1, fp) == 1;
+    for (int row = 1; ok && row <= psize; ++row) {
+        ok = fwrite(search->grid[row], sizeof(num_t), psize + 1, fp) == (size_t)(psize + 1);
+    }
+    ok = ok && fwrite(search->missingNums, sizeof(missing_t), psize, fp) == (size_t)psize;
+    for (int i = 0; ok && i < search->depth; ++i) {
+        searchFrame_t* frame = &search->frames[i];
+        int32_t numMoves = 0;
+        while (frame->moves[numMoves] != 0) {
+            ++numMoves;
+        }
+        int32_t fields[5] = { frame->cell.row, frame->cell.col, frame->gridIdx, frame->next, numMoves };
+        ok = fwrite(fields, sizeof(fields), 1, fp) == 1
+            && fwrite(frame->moves, sizeof(int), numMoves, fp) == (size_t)numMoves
+            && writeBoard(fp, frame->saved->grid, psize)
+            && fwrite(frame->saved->missing, sizeof(missing_t), psize, fp) == (size_t)psize;
+    }
+    long bytes = ftell(fp);
+    if (fclose(fp) != 0) ok = false;
+    if (ok) ok = rename(temp, filename) == 0;
+    if (!ok) remove(temp);
+    free(temp);
+    return ok ? bytes : 0;
+}
+
+// zobristBoard of a board stored back to back; its row 0 isn't saved,
+// so the shape comes from the live board
+static uint64_t savedHash(num_t* board, int psize, int boxRows) {
+    uint64_t hash = zobristKey(0, boxRows, psize);
+    for (int row = 1; row <= psize; ++row) {
+        for (int col = 1; col <= psize; ++col) {
+            int num = board[row * (psize + 1) + col];
+            if (num) hash ^= zobristKey(row, col, num);
+        }
+    }
+    return hash;
+}
+
+search_t* loadSearch(const char* filename, unsigned long hash, missing_t* missingNums, int psize, num_t** grid, arena_t* arena) {
+    FILE* fp = fopen(filename, "rb");
+    if (fp == NULL) return NULL;
+    arenaMark_t mark = arenaMark(arena);
+    char magic[8];
+    uint64_t hash64;
+    int32_t header[4];
+    int64_t guesses;
+    bool ok = fread(magic, 1, 8, fp) == 8 && memcmp(magic, CHECKPOINT_MAGIC, 8) == 0
+        && fread(&hash64, sizeof(hash64), 1, fp) == 1 && hash64 == (uint64_t)hash
+        && fread(header, sizeof(header), 1, fp) == 1 && header[0] == psize
+        && header[1] == SEARCH_RUNNING && header[2] >= 0 && header[2] <= psize * psize + 1
+        && fread(&guesses, sizeof(guesses), 1, fp) == 1;
+    search_t* search = NULL;
+    // the puzzle is only overwritten once the whole file has been read
+    num_t* board = (num_t*)arenaAlloc(arena, sizeof(num_t) * (psize + 1) * (psize + 1));
+    missing_t* missing = (missing_t*)arenaAlloc(arena, sizeof(missing_t) * psize);
+    ok = ok && readBoard(fp, board, psize)
+        && fread(missing, sizeof(missing_t), psize, fp) == (size_t)psize;
+    if (ok) {
+        search = createSearch(missingNums, psize, grid, arena);
+        search->status = (searchStatus_e)header[1];
+        search->depth = header[2];
+        search->maxDepth = header[3];
+        search->guesses = guesses;
+    }
+    for (int i = 0; ok && i < search->depth; ++i) {
+        searchFrame_t* frame = &search->frames[i];
+        // same order as pushFrame, so releasing a frame frees the ones above
+        frame->mark = arenaMark(arena);
+        int32_t fields[5];
+        ok = fread(fields, sizeof(fields), 1, fp) == 1
+            && fields[0] >= 1 && fields[0] <= psize && fields[1] >= 1 && fields[1] <= psize
+            && fields[2] >= 1 && fields[2] <= psize && fields[4] >= 0 && fields[4] <= psize && fields[3] >= 0 && fields[3] <= fields[4];
+        if (!ok) break;
+        frame->cell.row = fields[0];
+        frame->cell.col = fields[1];
+        frame->gridIdx = fields[2];
+        frame->next = fields[3];
+        frame->moves = (int*)arenaAlloc(arena, sizeof(int) * (fields[4] + 1));
+        frame->saved = (savedPos_t*)arenaAlloc(arena, sizeof(savedPos_t));
+        frame->saved->grid = (num_t*)arenaAlloc(arena, sizeof(num_t) * (psize + 1) * (psize + 1));
+        frame->saved->missing = (missing_t*)arenaAlloc(arena, sizeof(missing_t) * psize);
+        ok = fread(frame->moves, sizeof(int), fields[4], fp) == (size_t)fields[4]
+            && readBoard(fp, frame->saved->grid, psize)
+            && fread(frame->saved->missing, sizeof(missing_t), psize, fp) == (size_t)psize;
+        // placeMove indexes the grid and missing by these
+        for (int m = 0; ok && m < fields[4]; ++m) {
+            ok = frame->moves[m] >= 1 && frame->moves[m] <= psize;
+        }
+    }
+    fclose(fp);
+    if (!ok) {
+        printf("Ignoring checkpoint %s, it does not match this puzzle\n", filename);
+        arenaRelease(arena, mark);
+        return NULL;
+    }
+    for (int row = 1; row <= psize; ++row) {
+        memcpy(grid[row], board + row * (psize + 1), sizeof(num_t) * (psize + 1));
+    }
+    memcpy(missingNums, missing, sizeof(missing_t) * psize);
+    if (search->board) loadBitboard(search->board, grid);
+    // hashes aren't saved, they are cheap to work out again
+    search->hash = zobristBoard(psize, grid);
+    for (int i = 0; i < search->depth; ++i) {
+        search->frames[i].hash = savedHash(search->frames[i].saved->grid, psize, grid[0][0]);
+    }
+    return search;
+}
+
+bool solveWithCheckpoints(checkpoint_t* checkpoint, missing_t* missingNums, int psize, num_t** grid, deadEnds_t* deadEnds, arena_t* arena) {
+    double start = now();
+    unsigned long hash = puzzleHash(psize, grid);
+    // everything the search allocates is released on return
+    arenaMark_t mark = arenaMark(arena);
+    search_t* search = loadSearch(checkpoint->filename, hash, missingNums, psize, grid, arena);
+    // a file left by another puzzle is kept until this one writes over it
+    bool owned = search != NULL;
+    if (search != NULL) {
+        printf("Resuming from %s after %ld guesses\n", checkpoint->filename, search->guesses);
+        ++(checkpoint->resumes);
+    }
+    else {
+        search = createSearch(missingNums, psize, grid, arena);
+    }
+    search->deadEnds = deadEnds;
+    double deadline = now() + checkpoint->interval;
+    searchStatus_e status;
+    while ((status = stepSearch(search, CHECKPOINT_MOVES)) == SEARCH_RUNNING) {
+        double before = now();
+        if (before < deadline) continue;
+        TRACE_BEGIN(span);
+        long bytes = saveSearch(search, hash, checkpoint->filename);
+        TRACE_END(span, "checkpoint");
+        double after = now();
+        if (bytes == 0) printf("Could not write checkpoint %s\n", checkpoint->filename);
+        else owned = true;
+        ++(checkpoint->writes);
+        checkpoint->bytes = bytes;
+        checkpoint->writeTime += after - before;
+        // a slow write pushes the next one back
+        double wait = (after - before) * CHECKPOINT_RATIO;
+        deadline = after + (wait > checkpoint->interval ? wait : checkpoint->interval);
+    }
+    // a finished search has nothing left to resume
+    if (owned) remove(checkpoint->filename);
+    bool solved = status == SEARCH_SOLVED;
+    arenaRelease(arena, mark);
+    checkpoint->searchTime += now() - start;
+    return solved;
+}
+
+void printCheckpointStats(checkpoint_t* checkpoint) {
+    double total = checkpoint->searchTime;
+    printf("Checkpoint: %ld writes, %ld bytes last, %ld resumed, %.3fs of %.3fs writing (%.2f%%)\n",
+        checkpoint->writes, checkpoint->bytes, checkpoint->resumes, checkpoint->writeTime, total,
+        total > 0 ? 100.0 * checkpoint->writeTime / total : 0.0);
+}
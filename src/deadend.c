@@ -0,0 +1,61 @@
+/**
+ * @file deadend.c
+ * @author Hayden Lauritzen (haydenlauritzen@gmail.com)
+ * @date 2023-1-16
+ *
+ * @copyright Copyright (c) 2023
+ *
+ */
+
+#include "../inc/deadend.h"
+
+deadEnds_t* createDeadEnds(size_t entries) {
+    deadEnds_t* deadEnds = (deadEnds_t*)calloc(1, sizeof(deadEnds_t));
+    size_t size = DEADEND_PROBE;
+    while (size < entries) {
+        size *= 2;
+    }
+    deadEnds->slots = (_Atomic uint64_t*)calloc(size, sizeof(uint64_t));
+    deadEnds->mask = size - 1;
+    return deadEnds;
+}
+
+void deleteDeadEnds(deadEnds_t* deadEnds) {
+    free((void*)deadEnds->slots);
+    free(deadEnds);
+}
+
+bool isDeadEnd(deadEnds_t* deadEnds, uint64_t hash) {
+    if (hash == 0) hash = 1; // 0 marks an empty slot
+    for (int i = 0; i < DEADEND_PROBE; ++i) {
+        uint64_t slot = atomic_load_explicit(&deadEnds->slots[(hash + i) & deadEnds->mask], memory_order_relaxed);
+        if (slot == hash) {
+            atomic_fetch_add_explicit(&deadEnds->hits, 1, memory_order_relaxed);
+            return true;
+        }
+        if (slot == 0) break;
+    }
+    atomic_fetch_add_explicit(&deadEnds->misses, 1, memory_order_relaxed);
+    return false;
+}
+
+void addDeadEnd(deadEnds_t* deadEnds, uint64_t hash) {
+    if (hash == 0) hash = 1;
+    atomic_fetch_add_explicit(&deadEnds->inserts, 1, memory_order_relaxed);
+    for (int i = 0; i < DEADEND_PROBE; ++i) {
+        _Atomic uint64_t* slot = &deadEnds->slots[(hash + i) & deadEnds->mask];
+        uint64_t empty = 0;
+        if (atomic_compare_exchange_strong_explicit(slot, &empty, hash, memory_order_relaxed, memory_order_relaxed)) return;
+        if (empty == hash) return;
+    }
+    // every probe slot is taken, the newest dead end wins the home slot
+    atomic_store_explicit(&deadEnds->slots[hash & deadEnds->mask], hash, memory_order_relaxed);
+}
+
+void printDeadEndStats(deadEnds_t* deadEnds) {
+    long hits = atomic_load(&deadEnds->hits);
+    long lookups = hits + atomic_load(&deadEnds->misses);
+    printf("Dead ends: %ld stored, %ld hits of %ld lookups (%.1f%%), %zu slots\n",
+        atomic_load(&deadEnds->inserts), hits, lookups, lookups ? 100.0 * hits / lookups : 0.0,
+        deadEnds->mask + 1);
+}
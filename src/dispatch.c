@@ -0,0 +1,145 @@
+/**
+ * @file dispatch.c
+ * @author Hayden Lauritzen (haydenlauritzen@gmail.com)
+ * @date 2023-1-16
+ *
+ * @copyright Copyright (c) 2023
+ *
+ */
+
+#include "../inc/dispatch.h"
+#include "../inc/propagate.h"
+
+// measured on the tests/ puzzles, prop was ahead of sweep on every one
+// (sweep pays for a round of threads at each step of the search)
+// past 25x25 guessing without learning stalls, so those go to sat
+static const route_t defaultRoutes[] = {
+    { 25, 0.0, 1.0, 0.0, ENGINE_PROP },
+    { 0, 0.0, 1.0, 0.0, ENGINE_SAT },
+};
+
+dispatcher_t* createDispatcher(void) {
+    dispatcher_t* dispatcher = (dispatcher_t*)calloc(1, sizeof(dispatcher_t));
+    dispatcher->numRoutes = sizeof(defaultRoutes) / sizeof(route_t);
+    dispatcher->routes = (route_t*)malloc(sizeof(defaultRoutes));
+    memcpy(dispatcher->routes, defaultRoutes, sizeof(defaultRoutes));
+    return dispatcher;
+}
+
+int parseRoute(char* line, route_t* route) {
+    char* comment = strchr(line, '#');
+    if (comment) *comment = '\0';
+    char size[16];
+    char name[16];
+    int fields = sscanf(line, "%15s %lf %lf %lf %15s", size, &route->minClues,
+        &route->maxDensity, &route->minSingles, name);
+    if (fields <= 0) return 0; // blank line
+    int engine = fields == 5 ? parseEngine(name) : -1;
+    if (engine < 0 || engine >= NUM_ENGINES) return -1;
+    route->maxPsize = strcmp(size, "*") == 0 ? 0 : atoi(size);
+    route->engine = (engine_e)engine;
+    return 1;
+}
+
+bool loadRoutes(dispatcher_t* dispatcher, const char* filename) {
+    FILE* fp = fopen(filename, "r");
+    if (fp == NULL) {
+        printf("Could not open file %s\n", filename);
+        return false;
+    }
+    int capacity = 8;
+    int numRoutes = 0;
+    route_t* routes = (route_t*)malloc(sizeof(route_t) * capacity);
+    char line[256];
+    int lineNum = 0;
+    while (fgets(line, sizeof(line), fp) != NULL) {
+        ++lineNum;
+        route_t route;
+        int parsed = parseRoute(line, &route);
+        if (parsed == 0) continue;
+        if (parsed < 0) {
+            printf("%s:%d: expected max_psize min_clues max_density min_singles engine\n", filename, lineNum);
+            free(routes);
+            fclose(fp);
+            return false;
+        }
+        if (numRoutes == capacity) {
+            capacity *= 2;
+            routes = (route_t*)realloc(routes, sizeof(route_t) * capacity);
+        }
+        routes[numRoutes++] = route;
+    }
+    fclose(fp);
+    free(dispatcher->routes);
+    dispatcher->routes = routes;
+    dispatcher->numRoutes = numRoutes;
+    return true;
+}
+
+void prependRoutes(dispatcher_t* dispatcher, route_t* routes, int count) {
+    route_t* table = (route_t*)malloc(sizeof(route_t) * (count + dispatcher->numRoutes));
+    memcpy(table, routes, sizeof(route_t) * count);
+    memcpy(table + count, dispatcher->routes, sizeof(route_t) * dispatcher->numRoutes);
+    free(dispatcher->routes);
+    dispatcher->routes = table;
+    dispatcher->numRoutes += count;
+}
+
+void getFeatures(int psize, num_t** grid, features_t* features, arena_t* arena) {
+    arenaMark_t mark = arenaMark(arena);
+    memset(features, 0, sizeof(features_t));
+    features->psize = psize;
+    propState_t* state = createPropState(psize, grid, arena);
+    long candidates = 0;
+    for (int row = 0; row < psize; ++row) {
+        for (int col = 0; col < psize; ++col) {
+            if (grid[row + 1][col + 1] != 0) {
+                ++(features->clues);
+                continue;
+            }
+            if (state == NULL) continue;
+            int count = maskCount(getCandidates(state, row, col));
+            candidates += count;
+            if (count == 1) ++(features->singles);
+        }
+    }
+    int empty = psize * psize - features->clues;
+    features->clueRatio = (double)features->clues / (psize * psize);
+    features->density = empty ? (double)candidates / empty / psize : 0.0;
+    features->singleRatio = empty ? (double)features->singles / empty : 0.0;
+    arenaRelease(arena, mark);
+}
+
+engine_e dispatch(dispatcher_t* dispatcher, features_t* features) {
+    engine_e engine = ENGINE_PROP;
+    for (int i = 0; i < dispatcher->numRoutes; ++i) {
+        route_t* route = &dispatcher->routes[i];
+        if ((route->maxPsize == 0 || features->psize <= route->maxPsize) &&
+            features->clueRatio >= route->minClues &&
+            features->density <= route->maxDensity &&
+            features->singleRatio >= route->minSingles) {
+            engine = route->engine;
+            break;
+        }
+    }
+    ++(dispatcher->picks[engine]);
+    return engine;
+}
+
+void printFeatures(features_t* features, engine_e engine) {
+    printf("Dispatch: psize %d, %d clues, density %.2f, %d singles -> %s\n",
+        features->psize, features->clues, features->density, features->singles, engineName(engine));
+}
+
+void printDispatchStats(dispatcher_t* dispatcher) {
+    printf("Dispatch:");
+    for (int engine = 0; engine < NUM_ENGINES; ++engine) {
+        printf(" %s %ld/%ld solved", engineName(engine), dispatcher->solved[engine], dispatcher->picks[engine]);
+        printf(engine + 1 < NUM_ENGINES ? "," : "\n");
+    }
+}
+
+void deleteDispatcher(dispatcher_t* dispatcher) {
+    free(dispatcher->routes);
+    free(dispatcher);
+}
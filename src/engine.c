@@ -0,0 +1,51 @@
+/**
+ * @file engine.c
+ * @author Hayden Lauritzen (haydenlauritzen@gmail.com)
+ * @date 2023-1-16
+ *
+ * @copyright Copyright (c) 2023
+ *
+ */
+
+#include "../inc/engine.h"
+#include "../inc/propagate.h"
+#include "../inc/sat.h"
+
+static const char* engineNames[] = { "sweep", "prop", "sat", "auto", "portfolio" };
+
+const char* engineName(engine_e engine) {
+    return engineNames[engine];
+}
+
+int parseEngine(const char* name) {
+    for (int engine = 0; engine <= ENGINE_PORTFOLIO; ++engine) {
+        if (strcmp(name, engineNames[engine]) == 0) return engine;
+    }
+    return -1;
+}
+
+bool runEngine(engine_e engine, int psize, num_t** grid, missing_t* missing, checkpoint_t* checkpoint,
+    deadEnds_t* deadEnds, arena_t* arena) {
+    TRACE_BEGIN(span);
+    bool solved;
+    switch (engine) {
+    case ENGINE_PROP:
+        solved = propagateSolve(psize, grid, arena);
+        break;
+    case ENGINE_SAT:
+        solved = satSolvePuzzle(psize, grid, arena);
+        break;
+    default:
+        if (checkpoint) solved = solveWithCheckpoints(checkpoint, missing, psize, grid, deadEnds, arena);
+        else solved = solvePuzzle(missing, psize, grid, deadEnds, arena);
+        break;
+    }
+    TRACE_END(span, engineName(engine));
+    return solved;
+}
+
+void printNoSolution(engine_e engine) {
+    printf("Could not find a solution :(\n");
+    // the sweep leaves the board as far as it got
+    if (engine == ENGINE_SWEEP) printf("This is as far as I got:\n");
+}
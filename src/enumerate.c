@@ -0,0 +1,548 @@
+/**
+ * @file enumerate.c
+ * @author Hayden Lauritzen (haydenlauritzen@gmail.com)
+ * @date 2023-1-16
+ *
+ * @copyright Copyright (c) 2023
+ *
+ */
+
+#include "../inc/enumerate.h"
+#include "../inc/latency.h"
+
+// each thread's state and frames, it grows for big boards
+#define ENUM_ARENA ((size_t)64 << 10)
+// lines a task holds before it waits for its turn to write them
+#define ENUM_FLUSH ((long)64 << 10)
+
+static const char cellChars[] = "123456789ABCDEFGHIJKLMNOPQRSTUVWXYZ";
+
+// a transform of the board and the relabeling of given digits it needs
+typedef struct symmetry_t {
+    bool transposed;
+    int* rowMap; // 1-indexed, like grid
+    int* colMap;
+    int* label;  // given digit to given digit, 0 for free digits
+} symmetry_t;
+
+// what every thread reads, and the output they take turns writing
+typedef struct enumShared_t {
+    int psize;
+    num_t** grid;
+    int numEmpty;
+    int* order;       // empty cells, row * psize + col, row by row
+    int* rank;        // rank[num] among the free digits, -1 if given
+    int* freeDigits;  // ascending
+    int numFree;      // 0 if there are too many to relabel
+    long relabelings; // numFree!
+    symmetry_t* syms; // syms[0] is the identity
+    int numSyms;
+    int* maps;        // row and col maps the syms point into
+    num_t* prefixes;  // numTasks prefixes of depth cells
+    int depth;
+    int numTasks;
+    atomic_int nextTask;
+    char** outputs;   // a task's lines, kept until earlier ones are written
+    size_t* outputLen;
+    bool* done;
+    int nextWrite;    // first task not written out in full
+    pthread_mutex_t writeLock;
+    pthread_cond_t written; // signalled when nextWrite moves
+    FILE* out;
+} enumShared_t;
+
+typedef struct enumFrame_t {
+    mask_t left; // numbers not tried yet
+    int num;     // number in the cell, 0 if none
+    int nextFree;
+} enumFrame_t;
+
+typedef struct enumWorker_t {
+    enumShared_t* shared;
+    propState_t* state;
+    arena_t* arena;
+    enumFrame_t* frames;
+    int nextFree;  // free digits placed so far, in order
+    int* label;    // scratch for orbitOf
+    int task;      // being searched
+    FILE* buffer;  // its lines not yet written
+    char* output;  // buffer's memory
+    size_t length;
+    long representatives;
+    long solutions;
+    pthread_t id;
+} enumWorker_t;
+
+static void setNum(propState_t* state, int cell, int num) {
+    int row = cell / state->psize, col = cell % state->psize;
+    state->cells[cell] = num;
+    maskSet(&state->rowUsed[row], num);
+    maskSet(&state->colUsed[col], num);
+    maskSet(&state->boxUsed[boxOf(state, row, col)], num);
+    --(state->empty);
+}
+
+static void clearNum(propState_t* state, int cell, int num) {
+    int row = cell / state->psize, col = cell % state->psize;
+    state->cells[cell] = 0;
+    maskClear(&state->rowUsed[row], num);
+    maskClear(&state->colUsed[col], num);
+    maskClear(&state->boxUsed[boxOf(state, row, col)], num);
+    ++(state->empty);
+}
+
+// candidates of the depth'th empty cell, less the free digits that would
+// be placed out of order
+static mask_t choices(enumWorker_t* w, int depth) {
+    enumShared_t* sh = w->shared;
+    int cell = sh->order[depth];
+    mask_t cand = getCandidates(w->state, cell / sh->psize, cell % sh->psize);
+    for (int k = w->nextFree + 1; k < sh->numFree; ++k) {
+        maskClear(&cand, sh->freeDigits[k]);
+    }
+    return cand;
+}
+
+static void place(enumWorker_t* w, int cell, int num) {
+    setNum(w->state, cell, num);
+    if (w->shared->rank[num] == w->nextFree) ++(w->nextFree);
+}
+
+// false if an empty cell sharing a unit with cell has no candidates left
+static bool peersLive(propState_t* state, int cell) {
+    int psize = state->psize;
+    int row = cell / psize, col = cell % psize;
+    cell_t* box = &state->shape->cells[boxOf(state, row, col) * psize];
+    for (int i = 0; i < psize; ++i) {
+        int r = box[i].row, c = box[i].col;
+        if (!state->cells[row * psize + i] && maskEmpty(getCandidates(state, row, i))) return false;
+        if (!state->cells[i * psize + col] && maskEmpty(getCandidates(state, i, col))) return false;
+        if (!state->cells[r * psize + c] && maskEmpty(getCandidates(state, r, c))) return false;
+    }
+    return true;
+}
+
+// solutions the board stands for, 0 if a transform makes it smaller
+static long orbitOf(enumWorker_t* w) {
+    enumShared_t* sh = w->shared;
+    int psize = sh->psize;
+    num_t* cells = w->state->cells;
+    long ties = 1;
+    for (int s = 1; s < sh->numSyms; ++s) {
+        symmetry_t* sym = &sh->syms[s];
+        memcpy(w->label, sym->label, sizeof(int) * (psize + 1));
+        int next = 0;
+        int cmp = 0;
+        for (int row = 1; row <= psize && cmp == 0; ++row) {
+            for (int col = 1; col <= psize && cmp == 0; ++col) {
+                int r = sym->rowMap[row] - 1, c = sym->colMap[col] - 1;
+                int src = sym->transposed ? cells[c * psize + r] : cells[r * psize + c];
+                // free digits take the order they are first seen in
+                if (w->label[src] == 0) w->label[src] = sh->freeDigits[next++];
+                int num = w->label[src];
+                int own = cells[(row - 1) * psize + col - 1];
+                if (num != own) cmp = num < own ? -1 : 1;
+            }
+        }
+        if (cmp < 0) return 0;
+        if (cmp == 0) ++ties;
+    }
+    return sh->numSyms * sh->relabelings / ties;
+}
+
+static void openBuffer(enumWorker_t* w) {
+    w->output = NULL;
+    w->length = 0;
+    w->buffer = open_memstream(&w->output, &w->length);
+}
+
+// waits until every earlier task is written, then writes the lines so far;
+// the first unfinished task never waits, so one is always moving
+static void flushBuffer(enumWorker_t* w) {
+    enumShared_t* sh = w->shared;
+    fclose(w->buffer);
+    pthread_mutex_lock(&sh->writeLock);
+    while (sh->nextWrite != w->task) {
+        pthread_cond_wait(&sh->written, &sh->writeLock);
+    }
+    fwrite(w->output, 1, w->length, sh->out);
+    pthread_mutex_unlock(&sh->writeLock);
+    free(w->output);
+    openBuffer(w);
+}
+
+static void writeSolution(enumWorker_t* w) {
+    long orbit = orbitOf(w);
+    if (orbit == 0) return;
+    int psize = w->shared->psize;
+    num_t* cells = w->state->cells;
+    for (int i = 0; i < psize * psize; ++i) {
+        if (psize < (int)sizeof(cellChars)) fputc(cellChars[cells[i] - 1], w->buffer);
+        else fprintf(w->buffer, "%d ", cells[i]);
+    }
+    fprintf(w->buffer, " x%ld\n", orbit);
+    ++(w->representatives);
+    w->solutions += orbit;
+    if (ftell(w->buffer) >= ENUM_FLUSH) flushBuffer(w);
+}
+
+// every solution with the first from empty cells as they are
+static void walk(enumWorker_t* w, int from) {
+    enumShared_t* sh = w->shared;
+    if (from == sh->numEmpty) {
+        writeSolution(w);
+        return;
+    }
+    int depth = from;
+    w->frames[depth].num = 0;
+    w->frames[depth].left = choices(w, depth);
+    while (depth >= from) {
+        enumFrame_t* frame = &w->frames[depth];
+        int cell = sh->order[depth];
+        if (frame->num) {
+            clearNum(w->state, cell, frame->num);
+            w->nextFree = frame->nextFree;
+            frame->num = 0;
+        }
+        if (maskEmpty(frame->left)) {
+            --depth;
+            continue;
+        }
+        int num = maskFirst(frame->left);
+        maskClear(&frame->left, num);
+        frame->nextFree = w->nextFree;
+        frame->num = num;
+        place(w, cell, num);
+        if (!peersLive(w->state, cell)) continue;
+        if (depth + 1 == sh->numEmpty) {
+            writeSolution(w);
+            continue;
+        }
+        ++depth;
+        w->frames[depth].num = 0;
+        w->frames[depth].left = choices(w, depth);
+    }
+}
+
+static void replay(enumWorker_t* w, num_t* prefix, int depth) {
+    w->nextFree = 0;
+    for (int i = 0; i < depth; ++i) {
+        place(w, w->shared->order[i], prefix[i]);
+    }
+}
+
+static void undoReplay(enumWorker_t* w, num_t* prefix, int depth) {
+    for (int i = depth - 1; i >= 0; --i) {
+        clearNum(w->state, w->shared->order[i], prefix[i]);
+    }
+    w->nextFree = 0;
+}
+
+// fills the first empty cells breadth first until there are enough
+// prefixes to share out
+static void makePrefixes(enumShared_t* sh, enumWorker_t* w, int threads) {
+    int psize = sh->psize;
+    int count = 1, depth = 0;
+    num_t* prefixes = (num_t*)malloc(1);
+    while (count > 0 && count < ENUM_TASKS * threads && depth < sh->numEmpty) {
+        num_t* next = (num_t*)malloc((size_t)count * psize * (depth + 1));
+        int made = 0;
+        for (int i = 0; i < count; ++i) {
+            num_t* prefix = prefixes + (size_t)i * depth;
+            replay(w, prefix, depth);
+            int cell = sh->order[depth];
+            int nextFree = w->nextFree;
+            mask_t cand = choices(w, depth);
+            for (int num = maskFirst(cand); num > 0; num = maskFirst(cand)) {
+                maskClear(&cand, num);
+                place(w, cell, num);
+                if (peersLive(w->state, cell)) {
+                    num_t* grown = next + (size_t)made * (depth + 1);
+                    memcpy(grown, prefix, depth);
+                    grown[depth] = num;
+                    ++made;
+                }
+                clearNum(w->state, cell, num);
+                w->nextFree = nextFree;
+            }
+            undoReplay(w, prefix, depth);
+        }
+        free(prefixes);
+        prefixes = next;
+        count = made;
+        ++depth;
+    }
+    sh->prefixes = prefixes;
+    sh->numTasks = count;
+    sh->depth = depth;
+}
+
+// writes out every finished task no earlier one is waiting on
+static void finishTask(enumWorker_t* w) {
+    enumShared_t* sh = w->shared;
+    fclose(w->buffer);
+    pthread_mutex_lock(&sh->writeLock);
+    sh->outputs[w->task] = w->output;
+    sh->outputLen[w->task] = w->length;
+    sh->done[w->task] = true;
+    while (sh->nextWrite < sh->numTasks && sh->done[sh->nextWrite]) {
+        fwrite(sh->outputs[sh->nextWrite], 1, sh->outputLen[sh->nextWrite], sh->out);
+        free(sh->outputs[sh->nextWrite]);
+        ++(sh->nextWrite);
+    }
+    pthread_cond_broadcast(&sh->written);
+    pthread_mutex_unlock(&sh->writeLock);
+}
+
+static void* enumerateTasks(void* args) {
+    enumWorker_t* w = (enumWorker_t*)args;
+    enumShared_t* sh = w->shared;
+    while ((w->task = atomic_fetch_add(&sh->nextTask, 1)) < sh->numTasks) {
+        TRACE_BEGIN(span);
+        openBuffer(w);
+        num_t* prefix = sh->prefixes + (size_t)w->task * sh->depth;
+        replay(w, prefix, sh->depth);
+        walk(w, sh->depth);
+        undoReplay(w, prefix, sh->depth);
+        finishTask(w);
+        TRACE_END(span, "enumerate");
+    }
+    return NULL;
+}
+
+static int factorial(int n) {
+    return n <= 1 ? 1 : n * factorial(n - 1);
+}
+
+// perms[p * n + i], all n! of them in lexicographic order, identity first
+static int makePerms(int n, int* perms) {
+    int count = factorial(n);
+    int* p = perms;
+    for (int i = 0; i < n; ++i) {
+        p[i] = i;
+    }
+    for (int k = 1; k < count; ++k) {
+        int* q = perms + k * n;
+        memcpy(q, p, sizeof(int) * n);
+        // next permutation
+        int i = n - 2;
+        while (q[i] > q[i + 1]) {
+            --i;
+        }
+        int j = n - 1;
+        while (q[j] < q[i]) {
+            --j;
+        }
+        int t = q[i];
+        q[i] = q[j];
+        q[j] = t;
+        for (int a = i + 1, b = n - 1; a < b; ++a, --b) {
+            t = q[a];
+            q[a] = q[b];
+            q[b] = t;
+        }
+        p = q;
+    }
+    return count;
+}
+
+// true if the transform takes the givens onto themselves, filling label
+static bool keepsGivens(enumShared_t* sh, bool transposed, int* rowMap, int* colMap, int* label, int* inverse) {
+    int psize = sh->psize;
+    num_t** grid = sh->grid;
+    memset(label, 0, sizeof(int) * (psize + 1));
+    memset(inverse, 0, sizeof(int) * (psize + 1));
+    for (int row = 1; row <= psize; ++row) {
+        for (int col = 1; col <= psize; ++col) {
+            int num = grid[row][col];
+            int src = transposed ? grid[colMap[col]][rowMap[row]] : grid[rowMap[row]][colMap[col]];
+            if ((num == 0) != (src == 0)) return false;
+            if (num == 0) continue;
+            if (label[src] == 0 && inverse[num] == 0) {
+                label[src] = num;
+                inverse[num] = src;
+            }
+            else if (label[src] != num) {
+                return false;
+            }
+        }
+    }
+    return true;
+}
+
+static void addSymmetry(enumShared_t* sh, bool transposed, int* rowMap, int* colMap, int* label) {
+    symmetry_t* sym = &sh->syms[sh->numSyms++];
+    sym->transposed = transposed;
+    sym->rowMap = rowMap;
+    sym->colMap = colMap;
+    sym->label = (int*)malloc(sizeof(int) * (sh->psize + 1));
+    memcpy(sym->label, label, sizeof(int) * (sh->psize + 1));
+}
+
+// the transforms of the canonical form that keep the givens in place
+static void makeSymmetries(enumShared_t* sh) {
+    int psize = sh->psize;
+    const shape_t* shape = getShape(psize, sh->grid);
+    int box = shape->boxRows;
+    sh->syms = (symmetry_t*)calloc(ENUM_SYM_MAX, sizeof(symmetry_t));
+    int* label = (int*)malloc(sizeof(int) * (psize + 1));
+    int* inverse = (int*)malloc(sizeof(int) * (psize + 1));
+    // band order, then the order inside each band: (box!)^(box + 1) maps
+    int numMaps = 1;
+    // band and stack moves only swap boxes for boxes when they're square
+    if (shape->boxCols == box && box <= 3) {
+        int perms[6 * 3];
+        int numPerms = makePerms(box, perms);
+        for (int i = 0; i <= box; ++i) {
+            numMaps *= numPerms;
+        }
+        sh->maps = (int*)malloc(sizeof(int) * numMaps * (psize + 1));
+        for (int m = 0; m < numMaps; ++m) {
+            int* map = sh->maps + m * (psize + 1);
+            int digits = m;
+            int* bands = perms + (digits % numPerms) * box;
+            digits /= numPerms;
+            map[0] = 0;
+            for (int band = 0; band < box; ++band) {
+                int* inner = perms + (digits % numPerms) * box;
+                digits /= numPerms;
+                for (int i = 0; i < box; ++i) {
+                    map[band * box + i + 1] = bands[band] * box + inner[i] + 1;
+                }
+            }
+        }
+    }
+    else {
+        sh->maps = (int*)malloc(sizeof(int) * (psize + 1));
+        for (int i = 0; i <= psize; ++i) {
+            sh->maps[i] = i;
+        }
+    }
+    // map 0 is the identity, so the identity comes first
+    bool overflow = false;
+    for (int t = 0; t < 2 && !overflow && numMaps > 1; ++t) {
+        for (int r = 0; r < numMaps && !overflow; ++r) {
+            for (int c = 0; c < numMaps && !overflow; ++c) {
+                int* rowMap = sh->maps + r * (psize + 1);
+                int* colMap = sh->maps + c * (psize + 1);
+                if (!keepsGivens(sh, t, rowMap, colMap, label, inverse)) continue;
+                if (sh->numSyms == ENUM_SYM_MAX) overflow = true;
+                else addSymmetry(sh, t, rowMap, colMap, label);
+            }
+        }
+    }
+    if (overflow || sh->numSyms == 0) {
+        // too many to check every solution against, keep only the identity
+        for (int s = 0; s < sh->numSyms; ++s) {
+            free(sh->syms[s].label);
+        }
+        sh->numSyms = 0;
+        keepsGivens(sh, false, sh->maps, sh->maps, label, inverse);
+        addSymmetry(sh, false, sh->maps, sh->maps, label);
+    }
+    free(label);
+    free(inverse);
+}
+
+bool enumerateSolutions(int psize, num_t** grid, int threads, FILE* out, enumStats_t* stats) {
+    long start = latencyNow();
+    memset(stats, 0, sizeof(enumStats_t));
+    enumShared_t sh;
+    memset(&sh, 0, sizeof(enumShared_t));
+    sh.psize = psize;
+    sh.grid = grid;
+    sh.out = out;
+    pthread_mutex_init(&sh.writeLock, NULL);
+    pthread_cond_init(&sh.written, NULL);
+    if (threads < 1) threads = 1;
+    enumWorker_t* workers = (enumWorker_t*)calloc(threads, sizeof(enumWorker_t));
+    for (int t = 0; t < threads; ++t) {
+        enumWorker_t* w = &workers[t];
+        w->shared = &sh;
+        w->arena = createArena(ENUM_ARENA);
+        w->state = createPropState(psize, grid, w->arena);
+        w->frames = (enumFrame_t*)arenaAlloc(w->arena, sizeof(enumFrame_t) * psize * psize);
+        w->label = (int*)arenaAlloc(w->arena, sizeof(int) * (psize + 1));
+    }
+    bool valid = workers[0].state != NULL;
+    if (valid) {
+        sh.order = (int*)malloc(sizeof(int) * psize * psize);
+        for (int i = 0; i < psize * psize; ++i) {
+            if (workers[0].state->cells[i] == 0) sh.order[sh.numEmpty++] = i;
+        }
+        // digits the givens don't use can be swapped for each other
+        sh.rank = (int*)malloc(sizeof(int) * (psize + 1));
+        sh.freeDigits = (int*)malloc(sizeof(int) * psize);
+        mask_t used = maskNone();
+        for (int i = 0; i < psize * psize; ++i) {
+            if (workers[0].state->cells[i]) maskSet(&used, workers[0].state->cells[i]);
+        }
+        for (int num = 1; num <= psize; ++num) {
+            sh.rank[num] = -1;
+            if (!maskTest(used, num)) sh.freeDigits[sh.numFree++] = num;
+        }
+        if (sh.numFree > ENUM_MAX_FREE) {
+            stats->skippedFree = sh.numFree;
+            sh.numFree = 0;
+        }
+        for (int k = 0; k < sh.numFree; ++k) {
+            sh.rank[sh.freeDigits[k]] = k;
+        }
+        sh.relabelings = 1;
+        for (int k = 2; k <= sh.numFree; ++k) {
+            sh.relabelings *= k;
+        }
+        makeSymmetries(&sh);
+        makePrefixes(&sh, &workers[0], threads);
+        sh.outputs = (char**)calloc(sh.numTasks + 1, sizeof(char*));
+        sh.outputLen = (size_t*)calloc(sh.numTasks + 1, sizeof(size_t));
+        sh.done = (bool*)calloc(sh.numTasks + 1, sizeof(bool));
+        int running = threads < sh.numTasks ? threads : sh.numTasks;
+        for (int t = 1; t < running; ++t) {
+            pthread_create(&workers[t].id, NULL, enumerateTasks, &workers[t]);
+        }
+        // this thread takes tasks too
+        enumerateTasks(&workers[0]);
+        for (int t = 1; t < running; ++t) {
+            pthread_join(workers[t].id, NULL);
+        }
+        fflush(out);
+        for (int t = 0; t < threads; ++t) {
+            stats->representatives += workers[t].representatives;
+            stats->solutions += workers[t].solutions;
+        }
+        stats->transforms = sh.numSyms;
+        stats->freeDigits = sh.numFree;
+        stats->relabelings = sh.relabelings;
+        stats->tasks = sh.numTasks;
+        for (int s = 0; s < sh.numSyms; ++s) {
+            free(sh.syms[s].label);
+        }
+        free(sh.syms);
+        free(sh.maps);
+        free(sh.order);
+        free(sh.rank);
+        free(sh.freeDigits);
+        free(sh.prefixes);
+        free(sh.outputs);
+        free(sh.outputLen);
+        free(sh.done);
+    }
+    for (int t = 0; t < threads; ++t) {
+        deleteArena(workers[t].arena);
+    }
+    free(workers);
+    pthread_mutex_destroy(&sh.writeLock);
+    pthread_cond_destroy(&sh.written);
+    stats->elapsed = (latencyNow() - start) / 1e9;
+    return valid;
+}
+
+void printEnumStats(enumStats_t* stats, bool verbose) {
+    printf("Enumerated: %ld solutions as %ld lines, %ld board symmetries", stats->solutions,
+        stats->representatives, stats->transforms);
+    if (stats->freeDigits) printf(" x %ld relabelings of %d free digits\n", stats->relabelings, stats->freeDigits);
+    else if (stats->skippedFree) printf(", %d free digits not relabeled (more than %d)\n", stats->skippedFree, ENUM_MAX_FREE);
+    else printf(", no free digits\n");
+    if (verbose) printf("Enumeration: %ld tasks in %.3fs\n", stats->tasks, stats->elapsed);
+}
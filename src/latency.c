@@ -0,0 +1,212 @@
+/**
+ * @file latency.c
+ * @author Hayden Lauritzen (haydenlauritzen@gmail.com)
+ * @date 2023-1-16
+ *
+ * @copyright Copyright (c) 2023
+ *
+ */
+
+#include <signal.h> // sigaction()
+#include <time.h>   // clock_gettime(), nanosleep()
+
+#include "../inc/latency.h"
+
+// how often the dump thread looks for a signal or a due dump
+#define LATENCY_POLL_NS 100000000L
+
+static const double quantiles[] = { 0.5, 0.9, 0.99, 0.999 };
+#define NUM_QUANTILES (int)(sizeof(quantiles) / sizeof(quantiles[0]))
+
+// set by SIGUSR1, cleared by the dump thread
+static volatile sig_atomic_t dumpRequested = 0;
+
+static void onDumpSignal(int sig) {
+    (void)sig;
+    dumpRequested = 1;
+}
+
+static int bucketOf(long ns) {
+    if (ns < 0) ns = 0;
+    if (ns >= (1L << LATENCY_BITS)) ns = (1L << LATENCY_BITS) - 1;
+    if (ns < 2 * LATENCY_SUB) return (int)ns;
+    int shift = 63 - __builtin_clzl((unsigned long)ns) - LATENCY_SUB_BITS;
+    return (shift + 1) * LATENCY_SUB + (int)(ns >> shift) - LATENCY_SUB;
+}
+
+// largest value that falls in the bucket
+static long bucketTop(int idx) {
+    if (idx < 2 * LATENCY_SUB) return idx;
+    int shift = idx / LATENCY_SUB - 1;
+    long sub = idx % LATENCY_SUB + LATENCY_SUB;
+    return ((sub + 1) << shift) - 1;
+}
+
+static const char* kindName(latencyKind_e kind) {
+    if (kind == LATENCY_VERIFY) return "verify";
+    if (kind == LATENCY_CACHE) return "cache";
+    if (kind == LATENCY_BATCH) return "batch";
+    return engineName((engine_e)(kind - LATENCY_SOLVE));
+}
+
+long latencyNow(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec * 1000000000L + ts.tv_nsec;
+}
+
+void recordLatency(latency_t* latency, int psize, latencyKind_e kind, long ns) {
+    _Atomic(histogram_t*)* slot = &latency->hists[psize][kind];
+    histogram_t* hist = atomic_load_explicit(slot, memory_order_acquire);
+    if (hist == NULL) {
+        // first of its size and kind; a thread that loses the race frees its copy
+        histogram_t* made = (histogram_t*)calloc(1, sizeof(histogram_t));
+        if (atomic_compare_exchange_strong(slot, &hist, made)) hist = made;
+        else free(made);
+    }
+    atomic_fetch_add_explicit(&hist->counts[bucketOf(ns)], 1, memory_order_relaxed);
+    atomic_fetch_add_explicit(&hist->total, 1, memory_order_relaxed);
+    atomic_fetch_add_explicit(&hist->sum, ns, memory_order_relaxed);
+    long max = atomic_load_explicit(&hist->max, memory_order_relaxed);
+    while (ns > max && !atomic_compare_exchange_weak_explicit(&hist->max, &max, ns, memory_order_relaxed,
+        memory_order_relaxed)) {
+    }
+}
+
+long latencyQuantile(histogram_t* hist, double q) {
+    long total = atomic_load_explicit(&hist->total, memory_order_relaxed);
+    long max = atomic_load_explicit(&hist->max, memory_order_relaxed);
+    if (total == 0) return 0;
+    long rank = (long)ceil(q * total);
+    if (rank < 1) rank = 1;
+    long seen = 0;
+    for (int idx = 0; idx < LATENCY_BUCKETS; ++idx) {
+        seen += atomic_load_explicit(&hist->counts[idx], memory_order_relaxed);
+        if (seen >= rank) return bucketTop(idx) < max ? bucketTop(idx) : max;
+    }
+    // counts still catching up with total
+    return max;
+}
+
+// labels of one histogram, without the braces
+static void writeLabels(FILE* fp, int psize, latencyKind_e kind) {
+    fprintf(fp, "psize=\"%d\"", psize);
+    if (kind != LATENCY_VERIFY) fprintf(fp, ",engine=\"%s\"", kindName(kind));
+}
+
+static void writeFamily(FILE* fp, latency_t* latency, const char* name, const char* help, bool verify) {
+    fprintf(fp, "# HELP %s %s\n# TYPE %s summary\n", name, help, name);
+    for (int psize = 0; psize <= MAX_PSIZE; ++psize) {
+        for (int kind = 0; kind < NUM_LATENCY_KINDS; ++kind) {
+            histogram_t* hist = atomic_load_explicit(&latency->hists[psize][kind], memory_order_acquire);
+            if (hist == NULL || (kind == LATENCY_VERIFY) != verify) continue;
+            for (int q = 0; q < NUM_QUANTILES; ++q) {
+                fprintf(fp, "%s{", name);
+                writeLabels(fp, psize, kind);
+                fprintf(fp, ",quantile=\"%g\"} %.9f\n", quantiles[q], latencyQuantile(hist, quantiles[q]) / 1e9);
+            }
+            fprintf(fp, "%s_sum{", name);
+            writeLabels(fp, psize, kind);
+            fprintf(fp, "} %.9f\n%s_count{", atomic_load(&hist->sum) / 1e9, name);
+            writeLabels(fp, psize, kind);
+            fprintf(fp, "} %ld\n", atomic_load(&hist->total));
+        }
+    }
+    // the max is not part of a summary, so it is a gauge of its own
+    fprintf(fp, "# HELP %s_max Longest of them.\n# TYPE %s_max gauge\n", name, name);
+    for (int psize = 0; psize <= MAX_PSIZE; ++psize) {
+        for (int kind = 0; kind < NUM_LATENCY_KINDS; ++kind) {
+            histogram_t* hist = atomic_load_explicit(&latency->hists[psize][kind], memory_order_acquire);
+            if (hist == NULL || (kind == LATENCY_VERIFY) != verify) continue;
+            fprintf(fp, "%s_max{", name);
+            writeLabels(fp, psize, kind);
+            fprintf(fp, "} %.9f\n", atomic_load(&hist->max) / 1e9);
+        }
+    }
+}
+
+bool writeLatency(latency_t* latency, const char* filename) {
+    // write beside the old dump, then swap it in
+    size_t length = strlen(filename);
+    char* temp = (char*)malloc(length + 5);
+    memcpy(temp, filename, length);
+    memcpy(temp + length, ".tmp", 5);
+    FILE* fp = fopen(temp, "w");
+    if (fp == NULL) {
+        free(temp);
+        return false;
+    }
+    writeFamily(fp, latency, "sudoku_verify_seconds", "Time to check a puzzle is complete and valid.", true);
+    writeFamily(fp, latency, "sudoku_solve_seconds", "Time to solve a valid incomplete puzzle, by what solved it.",
+        false);
+    bool ok = !ferror(fp);
+    if (fclose(fp) != 0) ok = false;
+    if (ok) ok = rename(temp, filename) == 0;
+    if (!ok) remove(temp);
+    free(temp);
+    if (ok) ++(latency->dumps);
+    return ok;
+}
+
+static void* dumpLoop(void* args) {
+    latency_t* latency = (latency_t*)args;
+    struct timespec poll = { 0, LATENCY_POLL_NS };
+    long last = latencyNow();
+    while (!atomic_load(&latency->stop)) {
+        nanosleep(&poll, NULL);
+        bool due = latency->interval > 0 && latencyNow() - last >= (long)(latency->interval * 1e9);
+        if (dumpRequested || due) {
+            dumpRequested = 0;
+            last = latencyNow();
+            if (!writeLatency(latency, latency->filename)) printf("Could not write %s\n", latency->filename);
+        }
+    }
+    return NULL;
+}
+
+latency_t* createLatency(const char* filename, double interval) {
+    latency_t* latency = (latency_t*)calloc(1, sizeof(latency_t));
+    latency->interval = interval;
+    if (filename == NULL) return latency;
+    latency->filename = strdup(filename);
+    struct sigaction action;
+    memset(&action, 0, sizeof(action));
+    action.sa_handler = onDumpSignal;
+    sigemptyset(&action.sa_mask);
+    action.sa_flags = SA_RESTART;
+    sigaction(SIGUSR1, &action, NULL);
+    latency->dumping = pthread_create(&latency->dumper, NULL, dumpLoop, latency) == 0;
+    return latency;
+}
+
+void deleteLatency(latency_t* latency) {
+    if (latency->dumping) {
+        atomic_store(&latency->stop, true);
+        pthread_join(latency->dumper, NULL);
+    }
+    if (latency->filename && !writeLatency(latency, latency->filename)) {
+        printf("Could not write %s\n", latency->filename);
+    }
+    for (int psize = 0; psize <= MAX_PSIZE; ++psize) {
+        for (int kind = 0; kind < NUM_LATENCY_KINDS; ++kind) {
+            free(atomic_load(&latency->hists[psize][kind]));
+        }
+    }
+    free(latency->filename);
+    free(latency);
+}
+
+void printLatencyStats(latency_t* latency) {
+    printf("Latency (us):       count       p50       p90       p99     p99.9       max\n");
+    for (int psize = 0; psize <= MAX_PSIZE; ++psize) {
+        for (int kind = 0; kind < NUM_LATENCY_KINDS; ++kind) {
+            histogram_t* hist = atomic_load(&latency->hists[psize][kind]);
+            if (hist == NULL) continue;
+            printf("  %3d %-9s %9ld", psize, kindName(kind), atomic_load(&hist->total));
+            for (int q = 0; q < NUM_QUANTILES; ++q) {
+                printf(" %9.1f", latencyQuantile(hist, quantiles[q]) / 1e3);
+            }
+            printf(" %9.1f\n", atomic_load(&hist->max) / 1e3);
+        }
+    }
+}
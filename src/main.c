@@ -0,0 +1,383 @@
+/**
+ * @file main.c
+ * @author Hayden Lauritzen (haydenlauritzen@gmail.com)
+ * @date 2023-1-16
+ *
+ * @copyright Copyright (c) 2023
+ *
+ */
+
+#include <limits.h> // PATH_MAX
+#include <time.h>   // clock_gettime()
+#include <unistd.h> // getopt()
+
+#include "../inc/tune.h"
+#include "../inc/session.h"
+#include "../inc/enumerate.h"
+#include "../inc/shard.h"
+
+// reads, checks and solves a single puzzle file
+static void runPuzzle(char* filename, run_t* run) {
+    // grid is a 2D array
+    num_t** grid = NULL;
+    // find grid size and fill grid
+    int sudokuSize = readSudokuPuzzle(filename, &grid);
+    prepareArena(run, sudokuSize);
+    result_t result;
+    missing_t* missing = checkRun(run, sudokuSize, grid, &result);
+    printCheck(&result);
+    if (result.attempted) {
+        printf("Attempting Solve of:\n");
+        printSudokuPuzzle(sudokuSize, grid);
+        solveRun(run, sudokuSize, grid, missing, &result);
+        printSolve(run, &result);
+    }
+    printSudokuPuzzle(sudokuSize, grid);
+    if (run->stats) {
+        printf("Arena: %zu bytes peak, %zu bytes bound\n", run->arena->peak, solveArenaSize(sudokuSize));
+    }
+    // drops everything the puzzle allocated, including missing
+    arenaReset(run->arena);
+    deleteSudokuPuzzle(sudokuSize, grid);
+}
+
+static void printHint(hint_t* hint) {
+    static const char* unitNames[] = { "row", "col", "box" };
+    printf("%s", hintName(hint->kind));
+    if (hint->row) printf(" at %d %d", hint->row, hint->col);
+    if (hint->num) printf(": %d", hint->num);
+    if (hint->kind == HINT_CONFLICT || hint->kind == HINT_NO_PLACE || hint->kind == HINT_HIDDEN_SINGLE) {
+        printf(" in %s %d", unitNames[hint->unit], hint->unitIdx);
+    }
+    printf("\n");
+}
+
+// keeps one puzzle open and edits it with commands read from stdin:
+//   set row col num, clear row col, cands row col, hint, step,
+//   check, solvable, print, quit
+// with stats, each command's time is printed after it
+static void runSession(char* filename, run_t* run) {
+    num_t** grid = NULL;
+    int psize = readSudokuPuzzle(filename, &grid);
+    session_t* session = createSession(psize, grid);
+    char line[256];
+    char cmd[16];
+    while (fgets(line, sizeof(line), stdin) != NULL) {
+        int row = 0, col = 0, num = 0;
+        int fields = sscanf(line, "%15s %d %d %d", cmd, &row, &col, &num);
+        if (fields <= 0) continue;
+        struct timespec start, end;
+        clock_gettime(CLOCK_MONOTONIC, &start);
+        bool ok = true;
+        if (strcmp(cmd, "quit") == 0) {
+            break;
+        }
+        else if (strcmp(cmd, "set") == 0 || strcmp(cmd, "clear") == 0) {
+            ok = fields == (cmd[0] == 's' ? 4 : 3) && setCell(session, row, col, cmd[0] == 's' ? num : 0);
+            if (ok && cmd[0] == 's' && num && cellConflicts(session, row, col)) printf("conflict\n");
+        }
+        else if (strcmp(cmd, "cands") == 0) {
+            ok = fields == 3 && row >= 1 && row <= psize && col >= 1 && col <= psize;
+            if (ok) {
+                mask_t cand = cellCandidates(session, row, col);
+                for (int n = 1; n <= psize; ++n) {
+                    if (maskTest(cand, n)) printf("%d ", n);
+                }
+                printf("\n");
+            }
+        }
+        else if (strcmp(cmd, "hint") == 0 || strcmp(cmd, "step") == 0) {
+            hint_t hint = nextHint(session);
+            printHint(&hint);
+            // only a single is a sure step
+            if (cmd[0] == 's' && (hint.kind == HINT_NAKED_SINGLE || hint.kind == HINT_HIDDEN_SINGLE)) {
+                setCell(session, hint.row, hint.col, hint.num);
+            }
+        }
+        else if (strcmp(cmd, "check") == 0) {
+            printf("%d empty, %d conflicts, %d cells with no candidates\n", session->state.empty,
+                session->conflicts, session->deadCells);
+        }
+        else if (strcmp(cmd, "solvable") == 0) {
+            printf(sessionSolvable(session) ? "true\n" : "false\n");
+        }
+        else if (strcmp(cmd, "print") == 0) {
+            sessionBoard(session, grid);
+            printSudokuPuzzle(psize, grid);
+        }
+        else {
+            ok = false;
+        }
+        clock_gettime(CLOCK_MONOTONIC, &end);
+        if (!ok) printf("? %s", line);
+        if (run->stats) {
+            printf("(%.1fus)\n", (end.tv_sec - start.tv_sec) * 1e6 + (end.tv_nsec - start.tv_nsec) / 1e3);
+        }
+        fflush(stdout);
+    }
+    deleteSession(session);
+    deleteSudokuPuzzle(psize, grid);
+}
+
+// writes every solution of each puzzle, one line per symmetry class
+static void runEnumerate(char* filename, run_t* run, int threads) {
+    num_t** grid = NULL;
+    int psize = readSudokuPuzzle(filename, &grid);
+    prepareArena(run, psize);
+    rejection_t rejection;
+    enumStats_t stats;
+    if (prefilter(psize, grid, &rejection, run->arena) != REJECT_NONE) printRejection(&rejection);
+    else if (enumerateSolutions(psize, grid, threads, stdout, &stats)) printEnumStats(&stats, run->stats);
+    else printf("Givens clash, no solutions\n");
+    deleteSudokuPuzzle(psize, grid);
+}
+
+// expects file names of the puzzles as arguments in command line
+int main(int argc, char** argv) {
+    run_t run = { NULL, NULL, NULL, createDispatcher(), NULL, ENGINE_AUTO, false, NULL, NULL, NULL, NULL };
+    int cacheCapacity = 0;
+    long deadEndSize = 0;
+    char* checkpointFile = NULL;
+    double checkpointInterval = 60.0;
+    char* metricsFile = NULL;
+    char* storeFile = NULL;
+    bool compact = false;
+    double metricsInterval = 0;
+    bool pipeline = false;
+    bool session = false;
+    bool enumerate = false;
+    pipeConfig_t pipe = { getWorkerCount(), PIPE_RING, false, false, 1 };
+    int shardProcs = 0;
+    int shardRecords = SHARD_RECORDS;
+    bool workersGiven = false;
+    char* traceFile = NULL;
+    char* tuneFile = NULL;
+    // settings -o tuned for this machine; options below still win
+    profile_t profile;
+    const char* profileFile = profilePath();
+    bool profiled = profileFile && loadProfile(profileFile, &profile);
+    if (profiled) applyProfile(&profile, &run, &pipe);
+    int opt;
+    while ((opt = getopt(argc, argv, "abc:d:e:f:g:i:j:k:lm:no:pq:r:st:u:w:xy:")) != -1) {
+        switch (opt) {
+        case 'a':
+            pipe.pin = true;
+            break;
+        case 'b':
+            pipe.batch = true;
+            break;
+        case 'c':
+            cacheCapacity = atoi(optarg);
+            break;
+        case 'd':
+            deadEndSize = atol(optarg);
+            break;
+        case 'e': {
+            int engine = parseEngine(optarg);
+            if (engine < 0) {
+                printf("Unknown engine %s\n", optarg);
+                optind = argc + 1;
+            }
+            else {
+                run.engine = (engine_e)engine;
+            }
+            break;
+        }
+        case 'f':
+            shardProcs = atoi(optarg);
+            if (shardProcs < 1) optind = argc + 1;
+            break;
+        case 'g':
+            storeFile = optarg;
+            break;
+        case 'i':
+            checkpointInterval = atof(optarg);
+            break;
+        case 'j':
+            pipe.interleave = atoi(optarg);
+            if (pipe.interleave < 1 || pipe.interleave > PIPE_MAX_INTERLEAVE) optind = argc + 1;
+            break;
+        case 'k':
+            checkpointFile = optarg;
+            break;
+        case 'l':
+            session = true;
+            break;
+        case 'm':
+            metricsFile = optarg;
+            break;
+        case 'n':
+            enumerate = true;
+            break;
+        case 'o':
+            tuneFile = optarg;
+            break;
+        case 'p':
+            pipeline = true;
+            break;
+        case 'q':
+            pipe.ringSize = atoi(optarg) > 0 ? atoi(optarg) : 0;
+            if (pipe.ringSize < 1) optind = argc + 1;
+            break;
+        case 'r':
+            if (!loadRoutes(run.dispatcher, optarg)) optind = argc + 1;
+            break;
+        case 's':
+            run.stats = true;
+            break;
+        case 't':
+            traceFile = optarg;
+            break;
+        case 'u':
+            metricsInterval = atof(optarg);
+            break;
+        case 'w':
+            pipe.workers = atoi(optarg);
+            if (pipe.workers < 1) optind = argc + 1;
+            workersGiven = true;
+            break;
+        case 'x':
+            compact = true;
+            break;
+        case 'y':
+            shardRecords = atoi(optarg);
+            if (shardRecords < 1) optind = argc + 1;
+            break;
+        default:
+            optind = argc + 1;
+            break;
+        }
+    }
+    // rewrites the store and exits, no puzzles
+    if (compact && storeFile) {
+        deleteDispatcher(run.dispatcher);
+        return compactStore(storeFile) ? EXIT_SUCCESS : EXIT_FAILURE;
+    }
+    // the pipeline reads stdin when no files are given
+    static char* stdinArgs[] = { "-" };
+    if (compact || (optind >= argc && !((pipeline || shardProcs) && optind == argc))) {
+        printf("usage: ./sudoku [-c cache_size] [-d dead_ends] [-e sweep|prop|sat|auto|portfolio] [-g store] [-k checkpoint [-i seconds]] [-m metrics.prom [-u seconds]] [-r routes.txt] [-s] [-t trace.json] puzzle.txt [puzzle.txt ...]\n");
+        printf("       ./sudoku -p [-a] [-b] [-j interleave] [-w workers] [-q ring_size] [options] [puzzles.txt|- ...]\n");
+        printf("       ./sudoku -f processes [-y puzzles_per_shard] [options] [puzzles.txt|- ...]\n");
+        printf("       ./sudoku -l [-s] puzzle.txt < commands\n");
+        printf("       ./sudoku -n [-s] [-w threads] puzzle.txt [puzzle.txt ...]\n");
+        printf("       ./sudoku -o profile [-s] puzzles.txt [puzzles.txt ...]\n");
+        printf("       ./sudoku -g store -x\n");
+        deleteDispatcher(run.dispatcher);
+        return EXIT_FAILURE;
+    }
+    // a shard's process is a -p run whose stats go back to the coordinator
+    const char* shardStats = getenv(SHARD_STATS_ENV);
+    static char shardMetrics[PATH_MAX];
+    if (shardStats) {
+        shardProcs = 0;
+        pipeline = true;
+        run.stats = false;
+        if (metricsFile) {
+            snprintf(shardMetrics, sizeof(shardMetrics), "%s.%s", metricsFile, getenv(SHARD_ENV));
+            metricsFile = shardMetrics;
+        }
+    }
+    // the corpus split over processes, their outputs merged in order
+    if (shardProcs > 0 && !session && !enumerate && !tuneFile) {
+        shardConfig_t shards = { shardProcs, shardRecords,
+            workersGiven ? 0 : (pipe.workers / shardProcs > 1 ? pipe.workers / shardProcs : 1), argv, optind,
+            run.stats };
+        bool ok = optind == argc ? runShards(stdinArgs, 1, &shards, run.dispatcher)
+            : runShards(argv + optind, argc - optind, &shards, run.dispatcher);
+        if (run.stats) printDispatchStats(run.dispatcher);
+        deleteDispatcher(run.dispatcher);
+        return ok ? EXIT_SUCCESS : EXIT_FAILURE;
+    }
+    // solutions of earlier runs, and this one's for later ones
+    if (storeFile) {
+        run.store = openStore(storeFile);
+        if (run.store == NULL) {
+            deleteDispatcher(run.dispatcher);
+            return EXIT_FAILURE;
+        }
+    }
+    // equivalent puzzles share one cached solution
+    run.cache = cacheCapacity > 0 ? createCache(cacheCapacity) : NULL;
+    // boards the sweep has searched out are skipped when reached again
+    run.deadEnds = deadEndSize > 0 ? createDeadEnds(deadEndSize) : NULL;
+    // long searches can be stopped and picked up again
+    if (checkpointFile) run.checkpoint = createCheckpoint(checkpointFile, checkpointInterval);
+    // latency of every check and solve, dumped on SIGUSR1 and every -u seconds
+    if (metricsFile) run.latency = createLatency(metricsFile, metricsInterval);
+    // a racer per cpu, but always the two engines and a reordered prop
+    if (run.engine == ENGINE_PORTFOLIO) {
+        run.portfolio = createPortfolio(placeCpus() > PORTFOLIO_MIN ? placeCpus() : PORTFOLIO_MIN);
+        run.portfolio->deadEnds = run.deadEnds;
+    }
+    // a timeline of every thread, for chrome://tracing
+#ifdef SUDOKU_TRACE
+    if (traceFile) traceStart(traceFile);
+#else
+    if (traceFile) printf("Tracing is not built in, rebuild with -DSUDOKU_TRACE\n");
+#endif
+    if (profiled && run.stats) printf("Profile: %s\n", profileFile);
+    if (session) {
+        // one puzzle, edited a cell at a time
+        runSession(argv[optind], &run);
+    }
+    else if (enumerate) {
+        // every solution, not just the first
+        for (int i = optind; i < argc; ++i) {
+            runEnumerate(argv[i], &run, pipe.workers);
+        }
+    }
+    else if (tuneFile) {
+        // a sample run under every setting, the best is written as a profile
+        if (!autotune(argv + optind, argc - optind, tuneFile, run.stats)) {
+            deleteDispatcher(run.dispatcher);
+            return EXIT_FAILURE;
+        }
+    }
+    else if (pipeline) {
+        // many puzzles per file, solved while the next ones are read
+        if (run.checkpoint) printf("Checkpoints are not used in pipeline mode\n");
+        long puzzles = optind == argc ? runPipeline(&run, stdinArgs, 1, &pipe)
+            : runPipeline(&run, argv + optind, argc - optind, &pipe);
+        if (shardStats) writeShardStats(shardStats, &run, puzzles);
+    }
+    else {
+        // one puzzle at a time; its helper threads stay on the first node
+        if (pipe.pin && !pinToNode(0)) printf("Could not pin to node 0\n");
+        for (int i = optind; i < argc; ++i) {
+            runPuzzle(argv[i], &run);
+        }
+    }
+#ifdef SUDOKU_TRACE
+    if (traceFile) traceFinish();
+#endif
+    // a shard's counters were written to its stats, not stdout
+    if (run.cache) {
+        if (!shardStats) printCacheStats(run.cache);
+        deleteCache(run.cache);
+    }
+    if (run.store) {
+        if (!shardStats) printStoreStats(run.store);
+        closeStore(run.store);
+    }
+    if (run.deadEnds) {
+        if (!shardStats) printDeadEndStats(run.deadEnds);
+        deleteDeadEnds(run.deadEnds);
+    }
+    if (run.stats) printDispatchStats(run.dispatcher);
+    if (run.portfolio) {
+        if (run.stats) printPortfolioStats(run.portfolio);
+        deletePortfolio(run.portfolio);
+    }
+    if (run.latency) {
+        if (run.stats) printLatencyStats(run.latency);
+        deleteLatency(run.latency);
+    }
+    if (run.checkpoint) {
+        if (run.stats) printCheckpointStats(run.checkpoint);
+        deleteCheckpoint(run.checkpoint);
+    }
+    deleteDispatcher(run.dispatcher);
+    if (run.arena) deleteArena(run.arena);
+    return EXIT_SUCCESS;
+}
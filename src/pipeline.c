@@ -0,0 +1,532 @@
+/**
+ * @file pipeline.c
+ * @author Hayden Lauritzen (haydenlauritzen@gmail.com)
+ * @date 2023-1-16
+ *
+ * @copyright Copyright (c) 2023
+ *
+ */
+
+#include <sched.h> // sched_yield()
+#include <time.h>  // clock_gettime(), nanosleep()
+
+#include "../inc/pipeline.h"
+
+// yields before sleeping when a ring stays full or empty
+#define PIPE_SPINS 64
+#define PIPE_SLEEP_NS 50000
+// first block of an interleaved task's arena, more are chained as it deepens
+#define PIPE_TASK_ARENA ((size_t)64 << 10)
+
+// state shared by the stages
+typedef struct pipeline_t {
+    run_t* run;
+    char** files;
+    int numFiles;
+    int numWorkers;
+    ring_t** toWorker;   // reader to each worker
+    ring_t** fromWorker; // each worker to the writer
+    run_t* workerRuns;   // own arena and dispatcher counts per worker
+    bool batch;
+    batch_t** batches;   // per worker and psize, made when first needed
+    bool pin;
+    int* workerNode;     // -1 for a worker that isn't pinned
+    int interleave;
+    long* tasks;         // per worker, puzzles searched as interleaved tasks
+    long* steps;         // task steps taken
+    long* passes;        // rounds over the window that stepped a task
+    stageStats_t reader;
+    stageStats_t* workers;
+    stageStats_t writer;
+    pthread_mutex_t cacheLock;
+} pipeline_t;
+
+// a worker's index and the pipeline it is in
+typedef struct workerArgs_t {
+    pipeline_t* pipe;
+    int idx;
+} workerArgs_t;
+
+// a puzzle an interleaving worker has in flight
+typedef struct slot_t {
+    pipeItem_t* item;
+    bool running;   // a task still being stepped
+    propTask_t task;
+    solveJob_t job;
+    arena_t* arena; // the task's, kept for the next puzzle in the slot
+} slot_t;
+
+static double now(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+static void backoff(int* spins) {
+    if (++(*spins) < PIPE_SPINS) {
+        sched_yield();
+        return;
+    }
+    struct timespec ts = { 0, PIPE_SLEEP_NS };
+    nanosleep(&ts, NULL);
+}
+
+// pushes, waiting while the ring is full
+static void pushWait(ring_t* ring, pipeItem_t* item, stageStats_t* stats) {
+    // end markers aren't counted in the depth
+    if (item->psize > 0) {
+        size_t depth = ringDepth(ring);
+        stats->depthSum += depth;
+        if (depth > stats->depthMax) stats->depthMax = depth;
+    }
+    if (ringPush(ring, item)) return;
+    TRACE_BEGIN(span);
+    double start = now();
+    int spins = 0;
+    while (!ringPush(ring, item)) {
+        backoff(&spins);
+    }
+    stats->blocked += now() - start;
+    TRACE_END(span, "wait, ring full");
+}
+
+// pops, waiting while the ring is empty
+static pipeItem_t* popWait(ring_t* ring, stageStats_t* stats) {
+    pipeItem_t* item = (pipeItem_t*)ringPop(ring);
+    if (item) return item;
+    TRACE_BEGIN(span);
+    double start = now();
+    int spins = 0;
+    while ((item = (pipeItem_t*)ringPop(ring)) == NULL) {
+        backoff(&spins);
+    }
+    stats->blocked += now() - start;
+    TRACE_END(span, "wait, ring empty");
+    return item;
+}
+
+static void* readStage(void* args) {
+    pipeline_t* pipe = (pipeline_t*)args;
+    TRACE_THREAD(TRACE_READER, "reader");
+    double start = now();
+    long seq = 0;
+    for (int i = 0; i < pipe->numFiles; ++i) {
+        bool isStdin = strcmp(pipe->files[i], "-") == 0;
+        FILE* fp = isStdin ? stdin : fopen(pipe->files[i], "r");
+        if (fp == NULL) {
+            printf("Could not open file %s\n", pipe->files[i]);
+            exit(EXIT_FAILURE);
+        }
+        num_t** grid = NULL;
+        int psize;
+        while ((psize = readSudokuStream(fp, pipe->files[i], &grid)) > 0) {
+            pipeItem_t* item = (pipeItem_t*)calloc(1, sizeof(pipeItem_t));
+            item->psize = psize;
+            item->grid = grid;
+            pushWait(pipe->toWorker[seq % pipe->numWorkers], item, &pipe->reader);
+            ++seq;
+        }
+        if (!isStdin) fclose(fp);
+    }
+    pipe->reader.items = seq;
+    // every worker gets an end marker after its last puzzle
+    for (int w = 0; w < pipe->numWorkers; ++w) {
+        pushWait(pipe->toWorker[w], (pipeItem_t*)calloc(1, sizeof(pipeItem_t)), &pipe->reader);
+    }
+    pipe->reader.elapsed = now() - start;
+    return NULL;
+}
+
+// the reader's copy of the board may be on another node
+static void rehomeItem(pipeItem_t* item) {
+    num_t** local = copySudokuPuzzle(item->psize, item->grid);
+    deleteSudokuPuzzle(item->psize, item->grid);
+    item->grid = local;
+}
+
+// checks item and solves it on the scalar engines
+static void solveItem(run_t* run, pipeItem_t* item) {
+    prepareArena(run, item->psize);
+    missing_t* missing = checkRun(run, item->psize, item->grid, &item->result);
+    if (item->result.attempted) item->puzzle = copySudokuPuzzle(item->psize, item->grid);
+    solveRun(run, item->psize, item->grid, missing, &item->result);
+    // drops everything the puzzle allocated, including missing
+    arenaReset(run->arena);
+}
+
+// runs the small puzzles among items through batch lanes, the rest and
+// any a lane couldn't finish through solveItem
+static void solveBatch(pipeline_t* pipe, int idx, pipeItem_t** items, int count) {
+    run_t* run = &pipe->workerRuns[idx];
+    batch_t** batches = pipe->batches + idx * (BATCH_MAX_PSIZE + 1);
+    bool queued[BATCH_LANES] = { false };
+    for (int i = 0; i < count; ++i) {
+        pipeItem_t* item = items[i];
+        if (item->psize == 0) continue;
+        if (!batchFits(item->psize, item->grid)) {
+            solveItem(run, item);
+            continue;
+        }
+        prepareArena(run, item->psize);
+        checkRun(run, item->psize, item->grid, &item->result);
+        arenaReset(run->arena);
+        if (item->result.attempted) {
+            item->puzzle = copySudokuPuzzle(item->psize, item->grid);
+            queued[i] = true;
+        }
+    }
+    // one batch per size present
+    for (int first = 0; first < count; ++first) {
+        if (!queued[first]) continue;
+        int psize = items[first]->psize;
+        if (batches[psize] == NULL) batches[psize] = createBatch(psize);
+        batch_t* batch = batches[psize];
+        batchClear(batch);
+        long start = run->latency ? latencyNow() : 0;
+        int lanes[BATCH_LANES];
+        for (int i = first; i < count; ++i) {
+            if (queued[i] && items[i]->psize == psize) lanes[i] = batchLoad(batch, items[i]->grid);
+        }
+        batchPropagate(batch);
+        // every puzzle a lane finishes waited for the whole batch
+        long took = run->latency ? latencyNow() - start : 0;
+        for (int i = first; i < count; ++i) {
+            if (!queued[i] || items[i]->psize != psize) continue;
+            queued[i] = false;
+            pipeItem_t* item = items[i];
+            if (batchStore(batch, lanes[i], item->grid) == LANE_SOLVED) {
+                item->result.solved = true;
+                if (run->latency) recordLatency(run->latency, psize, LATENCY_BATCH, took);
+                continue;
+            }
+            // guesses, and proving there is no solution, are left to the engines;
+            // the puzzle was checked and timed on the way in, this only counts
+            // what the lanes left missing
+            bool complete, valid;
+            prepareArena(run, psize);
+            missing_t* missing = checkPuzzle(psize, item->grid, &complete, &valid, run->arena);
+            solveRun(run, psize, item->grid, missing, &item->result);
+            arenaReset(run->arena);
+        }
+    }
+}
+
+// checks a puzzle as it comes in; a search bound for prop becomes a task,
+// anything else is finished here
+static void admitItem(run_t* run, slot_t* slot) {
+    pipeItem_t* item = slot->item;
+    int psize = item->psize;
+    slot->running = false;
+    prepareArena(run, psize);
+    missing_t* missing = checkRun(run, psize, item->grid, &item->result);
+    if (item->result.attempted) {
+        item->puzzle = copySudokuPuzzle(psize, item->grid);
+        if (!startSolve(run, psize, item->grid, &item->result, &slot->job)) {
+            endSolve(run, psize, item->grid, &item->result, &slot->job);
+        }
+        else if (item->result.engine == ENGINE_PROP) {
+            if (slot->arena == NULL) slot->arena = createArena(PIPE_TASK_ARENA);
+            arenaReset(slot->arena);
+            slot->running = startPropTask(&slot->task, psize, item->grid, slot->arena);
+            if (!slot->running) endSolve(run, psize, item->grid, &item->result, &slot->job);
+        }
+        else {
+            searchRun(run, psize, item->grid, missing, &item->result);
+            endSolve(run, psize, item->grid, &item->result, &slot->job);
+        }
+    }
+    arenaReset(run->arena);
+}
+
+// keeps up to pipe->interleave puzzles in a window and steps their
+// searches in turn, passing them on in the order they came
+static void interleaveItems(pipeline_t* pipe, int idx, bool rehome, stageStats_t* stats) {
+    run_t* run = &pipe->workerRuns[idx];
+    ring_t* in = pipe->toWorker[idx];
+    int most = pipe->interleave;
+    slot_t* slots = (slot_t*)calloc(most, sizeof(slot_t));
+    int head = 0, count = 0;
+    pipeItem_t* end = NULL;
+    while (end == NULL || count > 0) {
+        // tops the window up, waiting only when there is nothing to step
+        while (end == NULL && count < most) {
+            pipeItem_t* item = count == 0 ? popWait(in, stats) : (pipeItem_t*)ringPop(in);
+            if (item == NULL) break;
+            if (item->psize == 0) {
+                end = item;
+                break;
+            }
+            if (rehome) rehomeItem(item);
+            slot_t* slot = &slots[(head + count++) % most];
+            slot->item = item;
+            TRACE_BEGIN(span);
+            admitItem(run, slot);
+            TRACE_END(span, "admit");
+        }
+        bool stepped = false;
+        TRACE_BEGIN(span);
+        for (int i = 0; i < count; ++i) {
+            slot_t* slot = &slots[(head + i) % most];
+            if (!slot->running) continue;
+            taskStatus_e status = stepPropTask(&slot->task);
+            stepped = true;
+            if (status == TASK_RUNNING) continue;
+            pipeItem_t* item = slot->item;
+            slot->running = false;
+            item->result.solved = status == TASK_SOLVED;
+            endSolve(run, item->psize, item->grid, &item->result, &slot->job);
+            pipe->steps[idx] += slot->task.steps;
+            ++(pipe->tasks[idx]);
+        }
+        if (stepped) {
+            ++(pipe->passes[idx]);
+            TRACE_END(span, "task steps");
+        }
+        while (count > 0 && !slots[head].running) {
+            ++(stats->items);
+            pushWait(pipe->fromWorker[idx], slots[head].item, stats);
+            head = (head + 1) % most;
+            --count;
+        }
+    }
+    pushWait(pipe->fromWorker[idx], end, stats);
+    for (int i = 0; i < most; ++i) {
+        if (slots[i].arena) deleteArena(slots[i].arena);
+    }
+    free(slots);
+}
+
+static void* solveStage(void* args) {
+    workerArgs_t* worker = (workerArgs_t*)args;
+    pipeline_t* pipe = worker->pipe;
+    stageStats_t* stats = &pipe->workers[worker->idx];
+    TRACE_THREAD(TRACE_WORKERS + worker->idx, "worker");
+    // pinned before anything is allocated, so it is all on this node
+    if (pipe->pin) {
+        int node;
+        int cpu = workerCpu(worker->idx, &node);
+        if (pinToCpu(cpu, node)) pipe->workerNode[worker->idx] = node;
+    }
+    bool rehome = pipe->workerNode[worker->idx] >= 0 && placeNodes() > 1;
+    double start = now();
+    if (pipe->interleave > 1 && !pipe->batch) {
+        interleaveItems(pipe, worker->idx, rehome, stats);
+        stats->elapsed = now() - start;
+        return NULL;
+    }
+    int most = pipe->batch ? BATCH_LANES : 1;
+    pipeItem_t* items[BATCH_LANES];
+    bool end = false;
+    while (!end) {
+        // waits for one puzzle, then takes whatever else is ready
+        int count = 0;
+        items[count++] = popWait(pipe->toWorker[worker->idx], stats);
+        while (items[count - 1]->psize > 0 && count < most) {
+            pipeItem_t* item = (pipeItem_t*)ringPop(pipe->toWorker[worker->idx]);
+            if (item == NULL) break;
+            items[count++] = item;
+        }
+        // the writer owns an item once it is pushed
+        end = items[count - 1]->psize == 0;
+        for (int i = 0; rehome && i < count; ++i) {
+            if (items[i]->psize > 0) rehomeItem(items[i]);
+        }
+        TRACE_BEGIN(span);
+        if (pipe->batch) {
+            solveBatch(pipe, worker->idx, items, count);
+        }
+        else if (!end) {
+            solveItem(&pipe->workerRuns[worker->idx], items[0]);
+        }
+        TRACE_END(span, "solve");
+        stats->items += end ? count - 1 : count;
+        for (int i = 0; i < count; ++i) {
+            pushWait(pipe->fromWorker[worker->idx], items[i], stats);
+        }
+    }
+    stats->elapsed = now() - start;
+    return NULL;
+}
+
+static void* writeStage(void* args) {
+    pipeline_t* pipe = (pipeline_t*)args;
+    TRACE_THREAD(TRACE_WRITER, "writer");
+    double start = now();
+    int ended = 0;
+    // same order the reader dealt them in
+    for (long seq = 0; ended < pipe->numWorkers; ++seq) {
+        pipeItem_t* item = popWait(pipe->fromWorker[seq % pipe->numWorkers], &pipe->writer);
+        if (item->psize == 0) {
+            ++ended;
+        }
+        else {
+            printCheck(&item->result);
+            if (item->result.attempted) {
+                printf("Attempting Solve of:\n");
+                printSudokuPuzzle(item->psize, item->puzzle);
+                printSolve(pipe->run, &item->result);
+                deleteSudokuPuzzle(item->psize, item->puzzle);
+            }
+            printSudokuPuzzle(item->psize, item->grid);
+            deleteSudokuPuzzle(item->psize, item->grid);
+            ++(pipe->writer.items);
+        }
+        free(item);
+    }
+    pipe->writer.elapsed = now() - start;
+    return NULL;
+}
+
+static void printStage(const char* name, stageStats_t* stats, bool pushes) {
+    printf("  %-8s %ld puzzles, %.3fs busy, %.3fs blocked", name, stats->items,
+        stats->elapsed - stats->blocked, stats->blocked);
+    if (pushes) {
+        printf(", next queue depth avg %.1f max %zu", stats->items ? (double)stats->depthSum / stats->items : 0.0,
+            stats->depthMax);
+    }
+    printf("\n");
+}
+
+long runPipeline(run_t* run, char** files, int numFiles, pipeConfig_t* config) {
+    int numWorkers = config->workers;
+    double start = now();
+    pipeline_t pipe;
+    memset(&pipe, 0, sizeof(pipeline_t));
+    pipe.run = run;
+    pipe.files = files;
+    pipe.numFiles = numFiles;
+    pipe.numWorkers = numWorkers;
+    pipe.toWorker = (ring_t**)malloc(sizeof(ring_t*) * numWorkers);
+    pipe.fromWorker = (ring_t**)malloc(sizeof(ring_t*) * numWorkers);
+    pipe.workerRuns = (run_t*)calloc(numWorkers, sizeof(run_t));
+    pipe.workers = (stageStats_t*)calloc(numWorkers, sizeof(stageStats_t));
+    pipe.batch = config->batch;
+    pipe.pin = config->pin;
+    pipe.workerNode = (int*)malloc(sizeof(int) * numWorkers);
+    pipe.interleave = config->interleave;
+    pipe.tasks = (long*)calloc(numWorkers, sizeof(long));
+    pipe.steps = (long*)calloc(numWorkers, sizeof(long));
+    pipe.passes = (long*)calloc(numWorkers, sizeof(long));
+    pipe.batches = (batch_t**)calloc(numWorkers * (BATCH_MAX_PSIZE + 1), sizeof(batch_t*));
+    pthread_mutex_init(&pipe.cacheLock, NULL);
+    // workers share the routes and cache, count their own picks
+    dispatcher_t* dispatchers = (dispatcher_t*)calloc(numWorkers, sizeof(dispatcher_t));
+    for (int w = 0; w < numWorkers; ++w) {
+        pipe.toWorker[w] = createRing(config->ringSize);
+        pipe.fromWorker[w] = createRing(config->ringSize);
+        pipe.workerNode[w] = -1;
+        dispatchers[w].routes = run->dispatcher->routes;
+        dispatchers[w].numRoutes = run->dispatcher->numRoutes;
+        pipe.workerRuns[w] = *run;
+        pipe.workerRuns[w].arena = NULL;
+        pipe.workerRuns[w].dispatcher = &dispatchers[w];
+        pipe.workerRuns[w].cacheLock = &pipe.cacheLock;
+        pipe.workerRuns[w].checkpoint = NULL;
+        // racers need arenas of their own on every worker
+        if (run->portfolio) {
+            pipe.workerRuns[w].portfolio = createPortfolio(run->portfolio->numStrategies);
+            pipe.workerRuns[w].portfolio->deadEnds = run->deadEnds;
+        }
+    }
+
+    pthread_t reader, writer;
+    pthread_t* workers = (pthread_t*)malloc(sizeof(pthread_t) * numWorkers);
+    workerArgs_t* args = (workerArgs_t*)malloc(sizeof(workerArgs_t) * numWorkers);
+    pthread_create(&reader, NULL, readStage, &pipe);
+    for (int w = 0; w < numWorkers; ++w) {
+        args[w].pipe = &pipe;
+        args[w].idx = w;
+        pthread_create(&workers[w], NULL, solveStage, &args[w]);
+    }
+    pthread_create(&writer, NULL, writeStage, &pipe);
+    pthread_join(reader, NULL);
+    for (int w = 0; w < numWorkers; ++w) {
+        pthread_join(workers[w], NULL);
+    }
+    pthread_join(writer, NULL);
+    double elapsed = now() - start;
+    if (pipe.pin && pipe.workerNode[0] < 0) printf("Could not pin workers to cores\n");
+
+    for (int w = 0; w < numWorkers; ++w) {
+        for (int e = 0; e < NUM_ENGINES; ++e) {
+            run->dispatcher->picks[e] += dispatchers[w].picks[e];
+            run->dispatcher->solved[e] += dispatchers[w].solved[e];
+        }
+        if (run->portfolio) mergePortfolio(run->portfolio, pipe.workerRuns[w].portfolio);
+    }
+    if (run->stats) {
+        printf("Pipeline: %d workers, rings of %zu, %ld puzzles in %.3fs (%.1f/s)\n",
+            numWorkers, pipe.toWorker[0]->capacity, pipe.writer.items, elapsed,
+            elapsed > 0 ? pipe.writer.items / elapsed : 0.0);
+        printStage("read", &pipe.reader, true);
+        for (int w = 0; w < numWorkers; ++w) {
+            char name[24];
+            snprintf(name, sizeof(name), "solve %d", w);
+            printStage(name, &pipe.workers[w], true);
+        }
+        printStage("write", &pipe.writer, false);
+        // pinned workers, summed by node
+        for (int node = 0; pipe.pin && node < placeNodes(); ++node) {
+            int workers = 0;
+            long items = 0;
+            for (int w = 0; w < numWorkers; ++w) {
+                if (pipe.workerNode[w] != node) continue;
+                ++workers;
+                items += pipe.workers[w].items;
+            }
+            if (workers == 0) continue;
+            printf("  node %d   %ld puzzles on %d workers, %.1f/s\n", node, items, workers,
+                elapsed > 0 ? items / elapsed : 0.0);
+        }
+        long tasks = 0, steps = 0, passes = 0;
+        for (int w = 0; w < numWorkers; ++w) {
+            tasks += pipe.tasks[w];
+            steps += pipe.steps[w];
+            passes += pipe.passes[w];
+        }
+        if (pipe.interleave > 1 && !pipe.batch) {
+            printf("Interleave: up to %d puzzles per worker, %ld searched as tasks in %ld steps, %.1f stepped per pass\n",
+                pipe.interleave, tasks, steps, passes ? (double)steps / passes : 0.0);
+        }
+        // lane stats summed over workers
+        for (int psize = 1; psize <= BATCH_MAX_PSIZE; ++psize) {
+            batch_t total;
+            memset(&total, 0, sizeof(batch_t));
+            total.psize = psize;
+            for (int w = 0; w < numWorkers; ++w) {
+                batch_t* b = pipe.batches[w * (BATCH_MAX_PSIZE + 1) + psize];
+                if (b == NULL) continue;
+                total.loaded += b->loaded;
+                total.solved += b->solved;
+                total.open += b->open;
+                total.unsolvable += b->unsolvable;
+                total.passes += b->passes;
+            }
+            if (total.loaded) printBatchStats(&total);
+        }
+    }
+
+    for (int w = 0; w < numWorkers; ++w) {
+        deleteRing(pipe.toWorker[w]);
+        deleteRing(pipe.fromWorker[w]);
+        if (pipe.workerRuns[w].arena) deleteArena(pipe.workerRuns[w].arena);
+        if (pipe.workerRuns[w].portfolio) deletePortfolio(pipe.workerRuns[w].portfolio);
+    }
+    for (int i = 0; i < numWorkers * (BATCH_MAX_PSIZE + 1); ++i) {
+        if (pipe.batches[i]) deleteBatch(pipe.batches[i]);
+    }
+    pthread_mutex_destroy(&pipe.cacheLock);
+    free(dispatchers);
+    free(workers);
+    free(args);
+    free(pipe.toWorker);
+    free(pipe.fromWorker);
+    free(pipe.workerRuns);
+    free(pipe.workers);
+    free(pipe.batches);
+    free(pipe.workerNode);
+    free(pipe.tasks);
+    free(pipe.steps);
+    free(pipe.passes);
+    return pipe.writer.items;
+}
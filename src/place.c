@@ -0,0 +1,131 @@
+/**
+ * @file place.c
+ * @author Hayden Lauritzen (haydenlauritzen@gmail.com)
+ * @date 2023-1-16
+ *
+ * @copyright Copyright (c) 2023
+ *
+ */
+
+#define _GNU_SOURCE // pthread_setaffinity_np(), CPU_SET()
+#include <pthread.h>
+#include <sched.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <unistd.h> // sysconf()
+
+#include "../inc/place.h"
+
+#define PLACE_MAX_NODES 64
+
+// cpus of each node, read the first time anything asks
+typedef struct topology_t {
+    int numNodes;
+    int numCpus;
+    int* cpus[PLACE_MAX_NODES];
+    int count[PLACE_MAX_NODES];
+} topology_t;
+
+static topology_t topology;
+static pthread_once_t topologyOnce = PTHREAD_ONCE_INIT;
+static _Thread_local int localNode = -1;
+
+// adds the cpus of a list like "0-3,8-11" to node
+static void parseCpuList(FILE* fp, int node) {
+    int first, last;
+    char sep;
+    while (fscanf(fp, "%d", &first) == 1) {
+        last = first;
+        if (fscanf(fp, "%c", &sep) == 1 && sep == '-') {
+            if (fscanf(fp, "%d", &last) != 1) break;
+            if (fscanf(fp, "%c", &sep) != 1) sep = '\n';
+        }
+        for (int cpu = first; cpu <= last; ++cpu) {
+            topology.cpus[node] = (int*)realloc(topology.cpus[node], sizeof(int) * (topology.count[node] + 1));
+            topology.cpus[node][topology.count[node]++] = cpu;
+            ++(topology.numCpus);
+        }
+        if (sep != ',') break;
+    }
+}
+
+static void loadTopology(void) {
+    for (int node = 0; node < PLACE_MAX_NODES; ++node) {
+        char path[64];
+        snprintf(path, sizeof(path), "/sys/devices/system/node/node%d/cpulist", node);
+        FILE* fp = fopen(path, "r");
+        if (fp == NULL) continue;
+        int slot = topology.numNodes;
+        parseCpuList(fp, slot);
+        fclose(fp);
+        // memory-only nodes have no cpus to run workers on
+        if (topology.count[slot] > 0) ++(topology.numNodes);
+    }
+    if (topology.numNodes == 0) {
+        long cpus = sysconf(_SC_NPROCESSORS_ONLN);
+        topology.numNodes = 1;
+        topology.count[0] = 0;
+        topology.numCpus = 0;
+        for (int cpu = 0; cpu < (cpus > 0 ? cpus : 1); ++cpu) {
+            topology.cpus[0] = (int*)realloc(topology.cpus[0], sizeof(int) * (cpu + 1));
+            topology.cpus[0][cpu] = cpu;
+            ++(topology.count[0]);
+            ++(topology.numCpus);
+        }
+    }
+}
+
+static topology_t* getTopology(void) {
+    pthread_once(&topologyOnce, loadTopology);
+    return &topology;
+}
+
+int placeNodes(void) {
+    return getTopology()->numNodes;
+}
+
+int placeCpus(void) {
+    return getTopology()->numCpus;
+}
+
+int workerCpu(int worker, int* node) {
+    topology_t* t = getTopology();
+    int n = worker % t->numNodes;
+    *node = n;
+    return t->cpus[n][(worker / t->numNodes) % t->count[n]];
+}
+
+#ifdef __linux__
+static bool setAffinity(int* cpus, int count) {
+    cpu_set_t set;
+    CPU_ZERO(&set);
+    for (int i = 0; i < count; ++i) {
+        if (cpus[i] < CPU_SETSIZE) CPU_SET(cpus[i], &set);
+    }
+    return pthread_setaffinity_np(pthread_self(), sizeof(cpu_set_t), &set) == 0;
+}
+#else
+static bool setAffinity(int* cpus, int count) {
+    (void)cpus;
+    (void)count;
+    return false;
+}
+#endif
+
+bool pinToCpu(int cpu, int node) {
+    if (!setAffinity(&cpu, 1)) return false;
+    localNode = node;
+    return true;
+}
+
+bool pinToNode(int node) {
+    topology_t* t = getTopology();
+    if (node < 0 || node >= t->numNodes) return false;
+    if (!setAffinity(t->cpus[node], t->count[node])) return false;
+    localNode = node;
+    return true;
+}
+
+int currentNode(void) {
+    return localNode;
+}
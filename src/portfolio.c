@@ -0,0 +1,177 @@
+/**
+ * @file portfolio.c
+ * @author Hayden Lauritzen (haydenlauritzen@gmail.com)
+ * @date 2023-1-16
+ *
+ * @copyright Copyright (c) 2023
+ *
+ */
+
+#include <time.h> // clock_gettime()
+
+#include "../inc/portfolio.h"
+#include "../inc/place.h"
+#include "../inc/propagate.h"
+#include "../inc/sat.h"
+
+// arena each racer starts with, it grows if a search needs more
+#define PORTFOLIO_ARENA ((size_t)1 << 20)
+
+// cheapest first, so a single cpu tries the likely winners early
+static const strategy_t defaultStrategies[PORTFOLIO_MAX] = {
+    { ENGINE_PROP, 0, "prop" },
+    { ENGINE_SAT, 0, "sat" },
+    { ENGINE_PROP, 0x9e3779b9u, "prop seed 1" },
+    { ENGINE_SWEEP, 0, "sweep" },
+    { ENGINE_SAT, 0x85ebca6bu, "sat seed 1" },
+    { ENGINE_PROP, 0xc2b2ae35u, "prop seed 2" },
+    { ENGINE_SWEEP, 0x27d4eb2fu, "sweep seed 1" },
+    { ENGINE_SAT, 0x165667b1u, "sat seed 2" },
+};
+
+// one strategy's copy of the puzzle
+typedef struct racer_t {
+    portfolio_t* portfolio;
+    int idx;
+    int psize;
+    num_t** grid;
+    atomic_bool* stop;
+    atomic_int* winner;
+    bool solved;
+    double finish;
+    int parentTid;
+    int node;
+} racer_t;
+
+static double now(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+portfolio_t* createPortfolio(int numStrategies) {
+    portfolio_t* portfolio = (portfolio_t*)calloc(1, sizeof(portfolio_t));
+    if (numStrategies > PORTFOLIO_MAX) numStrategies = PORTFOLIO_MAX;
+    if (numStrategies < 1) numStrategies = 1;
+    portfolio->numStrategies = numStrategies;
+    for (int i = 0; i < numStrategies; ++i) {
+        portfolio->strategies[i] = defaultStrategies[i];
+        portfolio->arenas[i] = createArena(PORTFOLIO_ARENA);
+    }
+    return portfolio;
+}
+
+void deletePortfolio(portfolio_t* portfolio) {
+    for (int i = 0; i < portfolio->numStrategies; ++i) {
+        deleteArena(portfolio->arenas[i]);
+    }
+    free(portfolio);
+}
+
+// the sweep can't be stopped mid search, so it goes a few guesses at a time
+static bool raceSweep(racer_t* racer, arena_t* arena) {
+    bool complete, valid;
+    missing_t* missing = checkPuzzle(racer->psize, racer->grid, &complete, &valid, arena);
+    search_t* search = createSearch(missing, racer->psize, racer->grid, arena);
+    search->seed = racer->portfolio->strategies[racer->idx].seed;
+    search->deadEnds = racer->portfolio->deadEnds;
+    searchStatus_e status;
+    while ((status = stepSearch(search, PORTFOLIO_MOVES)) == SEARCH_RUNNING) {
+        if (atomic_load_explicit(racer->stop, memory_order_relaxed)) break;
+    }
+    return status == SEARCH_SOLVED;
+}
+
+static void* race(void* args) {
+    racer_t* racer = (racer_t*)args;
+    // stays on the node of the thread that started the race
+    if (racer->node >= 0) pinToNode(racer->node);
+    TRACE_THREAD(racer->parentTid * TRACE_FANOUT + racer->idx + 1, "racer");
+    strategy_t* strategy = &racer->portfolio->strategies[racer->idx];
+    arena_t* arena = racer->portfolio->arenas[racer->idx];
+    searchOpts_t opts = { strategy->seed, racer->stop };
+    bool solved;
+    TRACE_BEGIN(span);
+    switch (strategy->engine) {
+    case ENGINE_PROP:
+        solved = propagateSearch(racer->psize, racer->grid, &opts, arena);
+        break;
+    case ENGINE_SAT:
+        solved = satSearchPuzzle(racer->psize, racer->grid, &opts, arena);
+        break;
+    default:
+        solved = raceSweep(racer, arena);
+        break;
+    }
+    TRACE_END(span, strategy->name);
+    arenaReset(arena);
+    // a racer that was stopped proved nothing by failing
+    if (!solved && atomic_load(racer->stop)) return NULL;
+    int none = -1;
+    if (atomic_compare_exchange_strong(racer->winner, &none, racer->idx)) {
+        racer->solved = solved;
+        racer->finish = now();
+        atomic_store(racer->stop, true);
+    }
+    return NULL;
+}
+
+int portfolioSolve(portfolio_t* portfolio, int psize, num_t** grid, bool* solved) {
+    int count = portfolio->numStrategies;
+    racer_t racers[PORTFOLIO_MAX];
+    pthread_t ids[PORTFOLIO_MAX];
+    bool started[PORTFOLIO_MAX];
+    atomic_bool stop = false;
+    atomic_int winner = -1;
+    int parentTid = TRACE_TID();
+    int node = currentNode();
+    double start = now();
+    for (int i = 0; i < count; ++i) {
+        racers[i] = (racer_t){ portfolio, i, psize, copySudokuPuzzle(psize, grid), &stop, &winner,
+            false, 0, parentTid, node };
+        started[i] = pthread_create(&ids[i], NULL, race, &racers[i]) == 0;
+    }
+    for (int i = 0; i < count; ++i) {
+        if (started[i]) pthread_join(ids[i], NULL);
+    }
+    int won = atomic_load(&winner);
+    *solved = false;
+    if (won >= 0) {
+        racer_t* racer = &racers[won];
+        *solved = racer->solved;
+        if (racer->solved) {
+            for (int row = 1; row <= psize; ++row) {
+                memcpy(grid[row], racer->grid[row], sizeof(num_t) * (psize + 1));
+            }
+        }
+        else {
+            ++(portfolio->unsolvable);
+        }
+        ++(portfolio->races);
+        ++(portfolio->wins[won]);
+        portfolio->winTime[won] += racer->finish - start;
+    }
+    for (int i = 0; i < count; ++i) {
+        deleteSudokuPuzzle(psize, racers[i].grid);
+    }
+    return won;
+}
+
+void mergePortfolio(portfolio_t* into, portfolio_t* from) {
+    into->races += from->races;
+    into->unsolvable += from->unsolvable;
+    for (int i = 0; i < into->numStrategies && i < from->numStrategies; ++i) {
+        into->wins[i] += from->wins[i];
+        into->winTime[i] += from->winTime[i];
+    }
+}
+
+void printPortfolioStats(portfolio_t* portfolio) {
+    printf("Portfolio: %ld races, %ld with no solution\n", portfolio->races, portfolio->unsolvable);
+    for (int i = 0; i < portfolio->numStrategies; ++i) {
+        long wins = portfolio->wins[i];
+        printf("  %-12s %ld wins (%.1f%%), %.6fs mean to win\n", portfolio->strategies[i].name, wins,
+            portfolio->races ? 100.0 * wins / portfolio->races : 0.0,
+            wins ? portfolio->winTime[i] / wins : 0.0);
+    }
+}
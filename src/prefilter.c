@@ -0,0 +1,105 @@
+/**
+ * @file prefilter.c
+ * @author Hayden Lauritzen (haydenlauritzen@gmail.com)
+ * @date 2023-1-16
+ *
+ * @copyright Copyright (c) 2023
+ *
+ */
+
+#include "../inc/prefilter.h"
+#include "../inc/shape.h"
+
+static const char* rejectNames[] = { "none", "out of range", "duplicate", "no candidates", "no place" };
+static const char* unitNames[] = { "row", "col", "box" };
+
+static void reject(rejection_t* rejection, reject_e reason, int row, int col, int num) {
+    rejection->reason = reason;
+    rejection->row = row;
+    rejection->col = col;
+    rejection->num = num;
+}
+
+// masks are psize / 64 + 1 words rather than a mask_t, so boards below
+// 64x64 take one word per unit
+reject_e prefilter(int psize, num_t** grid, rejection_t* rejection, arena_t* arena) {
+    memset(rejection, 0, sizeof(rejection_t));
+    const int* boxOf = getShape(psize, grid)->boxOf;
+    int words = psize / 64 + 1;
+    arenaMark_t mark = arenaMark(arena);
+    // [(unit type * psize + unit) * words], rows then columns then boxes
+    uint64_t* used = (uint64_t*)arenaAlloc(arena, sizeof(uint64_t) * 3 * psize * words);
+    uint64_t* open = (uint64_t*)arenaAlloc(arena, sizeof(uint64_t) * 3 * psize * words);
+    for (int row = 1; row <= psize && !rejection->reason; ++row) {
+        for (int col = 1; col <= psize; ++col) {
+            int num = grid[row][col];
+            if (num == 0) continue;
+            if (num > psize) {
+                reject(rejection, REJECT_RANGE, row, col, 0);
+                break;
+            }
+            int units[3] = { row - 1, col - 1, boxOf[(row - 1) * psize + col - 1] };
+            uint64_t bit = 1UL << (num % 64);
+            for (int type = rows; type <= grids; ++type) {
+                uint64_t* word = &used[(type * psize + units[type]) * words + num / 64];
+                if (*word & bit) {
+                    reject(rejection, REJECT_DUPLICATE, row, col, num);
+                    rejection->unit = (enum subset)type;
+                    rejection->unitIdx = units[type] + 1;
+                    break;
+                }
+                *word |= bit;
+            }
+            if (rejection->reason) break;
+        }
+    }
+    for (int row = 1; row <= psize && !rejection->reason; ++row) {
+        for (int col = 1; col <= psize && !rejection->reason; ++col) {
+            if (grid[row][col]) continue;
+            uint64_t* inRow = &used[(row - 1) * words];
+            uint64_t* inCol = &used[(psize + col - 1) * words];
+            int boxIdx = boxOf[(row - 1) * psize + col - 1];
+            uint64_t* inBox = &used[(2 * psize + boxIdx) * words];
+            uint64_t any = 0;
+            for (int w = 0; w < words; ++w) {
+                // numbers 1 to psize, bit 0 is never a candidate
+                uint64_t all = w < psize / 64 ? ~0UL : (2UL << (psize % 64)) - 1;
+                if (w == 0) all &= ~1UL;
+                uint64_t cand = all & ~(inRow[w] | inCol[w] | inBox[w]);
+                any |= cand;
+                open[(row - 1) * words + w] |= cand;
+                open[(psize + col - 1) * words + w] |= cand;
+                open[(2 * psize + boxIdx) * words + w] |= cand;
+            }
+            if (any == 0) reject(rejection, REJECT_NO_CANDIDATES, row, col, 0);
+        }
+    }
+    for (int i = 0; i < 3 * psize && !rejection->reason; ++i) {
+        for (int w = 0; w < words; ++w) {
+            uint64_t all = w < psize / 64 ? ~0UL : (2UL << (psize % 64)) - 1;
+            if (w == 0) all &= ~1UL;
+            uint64_t noPlace = all & ~used[i * words + w] & ~open[i * words + w];
+            if (noPlace == 0) continue;
+            reject(rejection, REJECT_NO_PLACE, 0, 0, w * 64 + __builtin_ctzl(noPlace));
+            rejection->unit = (enum subset)(i / psize);
+            rejection->unitIdx = i % psize + 1;
+            break;
+        }
+    }
+    arenaRelease(arena, mark);
+    return rejection->reason;
+}
+
+const char* rejectName(reject_e reason) {
+    return rejectNames[reason];
+}
+
+void printRejection(rejection_t* rejection) {
+    printf("Rejected: %s", rejectName(rejection->reason));
+    if (rejection->num) printf(" %d", rejection->num);
+    if (rejection->row) printf(" at %d %d", rejection->row, rejection->col);
+    if (rejection->reason == REJECT_DUPLICATE || rejection->reason == REJECT_NO_PLACE) {
+        printf(" in %s %d", unitNames[rejection->unit], rejection->unitIdx);
+    }
+    printf("\n");
+}
@@ -0,0 +1,262 @@
+/**
+ * @file propagate.c
+ * @author Hayden Lauritzen (haydenlauritzen@gmail.com)
+ * @date 2023-1-16
+ *
+ * @copyright Copyright (c) 2023
+ *
+ */
+
+#include "../inc/propagate.h"
+
+static void place(propState_t* state, int row, int col, int num) {
+    state->cells[row * state->psize + col] = (num_t)num;
+    maskSet(&state->rowUsed[row], num);
+    maskSet(&state->colUsed[col], num);
+    maskSet(&state->boxUsed[boxOf(state, row, col)], num);
+    --(state->empty);
+}
+
+static size_t stateBytes(int psize) {
+    return 3 * sizeof(mask_t) * psize + sizeof(num_t) * psize * psize;
+}
+
+static propState_t* allocState(const shape_t* shape, arena_t* arena) {
+    int psize = shape->psize;
+    propState_t* state = (propState_t*)arenaAlloc(arena, sizeof(propState_t));
+    state->psize = psize;
+    state->shape = shape;
+    // one block so a copy is a single memcpy
+    char* block = (char*)arenaAlloc(arena, stateBytes(psize));
+    state->rowUsed = (mask_t*)block;
+    state->colUsed = state->rowUsed + psize;
+    state->boxUsed = state->colUsed + psize;
+    state->cells = (num_t*)(state->boxUsed + psize);
+    return state;
+}
+
+static propState_t* copyState(propState_t* state, arena_t* arena) {
+    propState_t* copy = allocState(state->shape, arena);
+    memcpy(copy->rowUsed, state->rowUsed, stateBytes(state->psize));
+    copy->empty = state->empty;
+    return copy;
+}
+
+propState_t* createPropState(int psize, num_t** grid, arena_t* arena) {
+    propState_t* state = allocState(getShape(psize, grid), arena);
+    state->empty = psize * psize;
+    for (int row = 0; row < psize; ++row) {
+        for (int col = 0; col < psize; ++col) {
+            int num = grid[row + 1][col + 1];
+            if (num == 0) continue;
+            if (num > psize || !maskTest(getCandidates(state, row, col), num)) {
+                return NULL;
+            }
+            place(state, row, col, num);
+        }
+    }
+    return state;
+}
+
+mask_t getCandidates(propState_t* state, int row, int col) {
+    mask_t used = maskOr(maskOr(state->rowUsed[row], state->colUsed[col]), state->boxUsed[boxOf(state, row, col)]);
+    return maskAndNot(maskAll(state->psize), used);
+}
+
+bool propagate(propState_t* state) {
+    int psize = state->psize;
+    mask_t all = maskAll(psize);
+    bool changed = true;
+    while (changed && state->empty > 0) {
+        TRACE_BEGIN(span);
+        changed = false;
+        // naked singles
+        for (int row = 0; row < psize; ++row) {
+            for (int col = 0; col < psize; ++col) {
+                if (state->cells[row * psize + col] != 0) continue;
+                mask_t cand = getCandidates(state, row, col);
+                if (maskEmpty(cand)) return false;
+                if (maskSingle(cand)) {
+                    place(state, row, col, maskFirst(cand));
+                    changed = true;
+                }
+            }
+        }
+        // hidden singles
+        for (enum subset type = rows; type <= grids; ++type) {
+            for (int unit = 0; unit < psize; ++unit) {
+                mask_t once = maskNone();
+                mask_t twice = maskNone();
+                for (int i = 0; i < psize; ++i) {
+                    int row, col;
+                    unitCell(state, type, unit, i, &row, &col);
+                    if (state->cells[row * psize + col] != 0) continue;
+                    mask_t cand = getCandidates(state, row, col);
+                    twice = maskOr(twice, maskAnd(once, cand));
+                    once = maskOr(once, cand);
+                }
+                mask_t used = *unitUsed(state, type, unit);
+                // a number with nowhere to go
+                if (!maskEquals(maskOr(once, used), all)) return false;
+                mask_t hidden = maskAndNot(once, twice);
+                for (int i = 0; i < psize && !maskEmpty(hidden); ++i) {
+                    int row, col;
+                    unitCell(state, type, unit, i, &row, &col);
+                    if (state->cells[row * psize + col] != 0) continue;
+                    mask_t only = maskAnd(getCandidates(state, row, col), hidden);
+                    if (maskEmpty(only)) continue;
+                    // two numbers that only fit this cell
+                    if (!maskSingle(only)) return false;
+                    place(state, row, col, maskFirst(only));
+                    hidden = maskAndNot(hidden, only);
+                    changed = true;
+                }
+                // an earlier placement took the only spot
+                if (!maskEmpty(hidden)) return false;
+            }
+        }
+        TRACE_END(span, "propagation round");
+    }
+    return true;
+}
+
+// the num-th lowest candidate, counting from 0
+static int nthCandidate(mask_t cand, int nth) {
+    int num = maskFirst(cand);
+    while (nth-- > 0) {
+        maskClear(&cand, num);
+        num = maskFirst(cand);
+    }
+    return num;
+}
+
+// the cell with the fewest candidates
+static void pickCell(propState_t* state, searchOpts_t* opts, int* guessRow, int* guessCol) {
+    int psize = state->psize;
+    int bestRow = 0, bestCol = 0, bestCount = psize + 1, ties = 0;
+    for (int row = 0; row < psize; ++row) {
+        for (int col = 0; col < psize; ++col) {
+            if (state->cells[row * psize + col] != 0) continue;
+            int count = maskCount(getCandidates(state, row, col));
+            if (count < bestCount) {
+                bestRow = row;
+                bestCol = col;
+                bestCount = count;
+                ties = 1;
+            }
+            // a seeded search takes any of the tied cells, each as likely
+            else if (count == bestCount && opts->seed && nextRandom(&opts->seed) % ++ties == 0) {
+                bestRow = row;
+                bestCol = col;
+            }
+        }
+    }
+    *guessRow = bestRow;
+    *guessCol = bestCol;
+}
+
+static bool search(propState_t* state, searchOpts_t* opts, arena_t* arena) {
+    if (opts->stop && atomic_load_explicit(opts->stop, memory_order_relaxed)) return false;
+    if (!propagate(state)) return false;
+    if (state->empty == 0) return true;
+    int psize = state->psize;
+    int bestRow, bestCol;
+    pickCell(state, opts, &bestRow, &bestCol);
+    mask_t cand = getCandidates(state, bestRow, bestCol);
+    while (!maskEmpty(cand)) {
+        int num = opts->seed ? nthCandidate(cand, nextRandom(&opts->seed) % maskCount(cand)) : maskFirst(cand);
+        maskClear(&cand, num);
+        arenaMark_t mark = arenaMark(arena);
+        TRACE_BEGIN(span);
+        propState_t* guess = copyState(state, arena);
+        place(guess, bestRow, bestCol, num);
+        bool solved = search(guess, opts, arena);
+        TRACE_END(span, "guess");
+        if (solved) {
+            memcpy(state->rowUsed, guess->rowUsed, stateBytes(psize));
+            state->empty = guess->empty;
+            arenaRelease(arena, mark);
+            return true;
+        }
+        arenaRelease(arena, mark);
+    }
+    return false;
+}
+
+// the cells of a solved state into grid
+static void storeState(propState_t* state, num_t** grid) {
+    for (int row = 0; row < state->psize; ++row) {
+        memcpy(grid[row + 1] + 1, state->cells + row * state->psize, sizeof(num_t) * state->psize);
+    }
+}
+
+bool propagateSolve(int psize, num_t** grid, arena_t* arena) {
+    return propagateSearch(psize, grid, NULL, arena);
+}
+
+bool propagateSearch(int psize, num_t** grid, searchOpts_t* opts, arena_t* arena) {
+    // the seed is used up as the search goes, so it gets a copy
+    searchOpts_t local = { 0, NULL };
+    if (opts) local = *opts;
+    arenaMark_t mark = arenaMark(arena);
+    propState_t* state = createPropState(psize, grid, arena);
+    bool solved = state != NULL && search(state, &local, arena);
+    if (solved) storeState(state, grid);
+    arenaRelease(arena, mark);
+    return solved;
+}
+
+// asks for the lines of a state ahead of the step that reads them
+static void prefetchState(propState_t* state) {
+    size_t bytes = stateBytes(state->psize);
+    if (bytes > PROP_PREFETCH_MAX) bytes = PROP_PREFETCH_MAX;
+    for (size_t line = 0; line < bytes; line += 64) {
+        __builtin_prefetch((char*)state->rowUsed + line);
+    }
+}
+
+bool startPropTask(propTask_t* task, int psize, num_t** grid, arena_t* arena) {
+    memset(task, 0, sizeof(propTask_t));
+    task->psize = psize;
+    task->grid = grid;
+    task->arena = arena;
+    // a guess fills at least one cell, so there are never more frames than cells
+    task->frames = (propFrame_t*)arenaAlloc(arena, sizeof(propFrame_t) * psize * psize);
+    task->next = createPropState(psize, grid, arena);
+    if (task->next == NULL) return false;
+    prefetchState(task->next);
+    return true;
+}
+
+taskStatus_e stepPropTask(propTask_t* task) {
+    ++(task->steps);
+    propState_t* state = task->next;
+    task->next = NULL;
+    if (state && propagate(state)) {
+        if (state->empty == 0) {
+            storeState(state, task->grid);
+            return TASK_SOLVED;
+        }
+        propFrame_t* frame = &task->frames[task->depth++];
+        searchOpts_t inOrder = { 0, NULL };
+        frame->state = state;
+        pickCell(state, &inOrder, &frame->row, &frame->col);
+        frame->cand = getCandidates(state, frame->row, frame->col);
+        frame->mark = arenaMark(task->arena);
+    }
+    // after a contradiction, the next guess of the deepest frame with one left
+    while (task->depth > 0 && maskEmpty(task->frames[task->depth - 1].cand)) {
+        --(task->depth);
+    }
+    if (task->depth == 0) return TASK_FAILED;
+    propFrame_t* frame = &task->frames[task->depth - 1];
+    int num = maskFirst(frame->cand);
+    maskClear(&frame->cand, num);
+    // drops the last guess's board and everything under it
+    arenaRelease(task->arena, frame->mark);
+    propState_t* guess = copyState(frame->state, task->arena);
+    place(guess, frame->row, frame->col, num);
+    task->next = guess;
+    prefetchState(guess);
+    return TASK_RUNNING;
+}
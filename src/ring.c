@@ -0,0 +1,55 @@
+/**
+ * @file ring.c
+ * @author Hayden Lauritzen (haydenlauritzen@gmail.com)
+ * @date 2023-1-16
+ *
+ * @copyright Copyright (c) 2023
+ *
+ */
+
+#include <stdlib.h>
+
+#include "../inc/ring.h"
+
+ring_t* createRing(size_t capacity) {
+    ring_t* ring = (ring_t*)calloc(1, sizeof(ring_t));
+    size_t size = 1;
+    while (size < capacity) {
+        size <<= 1;
+    }
+    ring->capacity = size;
+    ring->slots = (void**)calloc(size, sizeof(void*));
+    atomic_init(&ring->head, 0);
+    atomic_init(&ring->tail, 0);
+    return ring;
+}
+
+void deleteRing(ring_t* ring) {
+    free(ring->slots);
+    free(ring);
+}
+
+bool ringPush(ring_t* ring, void* item) {
+    size_t tail = atomic_load_explicit(&ring->tail, memory_order_relaxed);
+    size_t head = atomic_load_explicit(&ring->head, memory_order_acquire);
+    if (tail - head == ring->capacity) return false;
+    ring->slots[tail & (ring->capacity - 1)] = item;
+    atomic_store_explicit(&ring->tail, tail + 1, memory_order_release);
+    return true;
+}
+
+void* ringPop(ring_t* ring) {
+    size_t head = atomic_load_explicit(&ring->head, memory_order_relaxed);
+    size_t tail = atomic_load_explicit(&ring->tail, memory_order_acquire);
+    if (head == tail) return NULL;
+    void* item = ring->slots[head & (ring->capacity - 1)];
+    atomic_store_explicit(&ring->head, head + 1, memory_order_release);
+    return item;
+}
+
+size_t ringDepth(ring_t* ring) {
+    // head first; tail never falls behind a head read earlier
+    size_t head = atomic_load_explicit(&ring->head, memory_order_acquire);
+    size_t tail = atomic_load_explicit(&ring->tail, memory_order_acquire);
+    return tail - head;
+}
@@ -0,0 +1,129 @@
+/**
+ * @file run.c
+ * @author Hayden Lauritzen (haydenlauritzen@gmail.com)
+ * @date 2023-1-16
+ *
+ * @copyright Copyright (c) 2023
+ *
+ */
+
+#include "../inc/run.h"
+
+void prepareArena(run_t* run, int psize) {
+    // the arena is sized for the worst case search of this board, up to
+    // a cap; past that, blocks are chained on as a search goes deeper
+    size_t bound = solveArenaSize(psize);
+    size_t size = bound < ARENA_START_MAX ? bound : ARENA_START_MAX;
+    if (run->arena == NULL || run->arena->capacity < size) {
+        if (run->arena) deleteArena(run->arena);
+        run->arena = createArena(size);
+    }
+}
+
+missing_t* checkRun(run_t* run, int psize, num_t** grid, result_t* result) {
+    memset(result, 0, sizeof(result_t));
+    long start = run->latency ? latencyNow() : 0;
+    missing_t* missing = NULL;
+    // a board that can't be solved never reaches the check or a search
+    // (a rejected board has a unit missing a number, so it is neither
+    // complete nor valid, as checkPuzzle would have said)
+    if (prefilter(psize, grid, &result->rejection, run->arena) == REJECT_NONE) {
+        missing = checkPuzzle(psize, grid, &result->complete, &result->valid, run->arena);
+    }
+    result->attempted = !result->complete && result->valid;
+    result->winner = -1;
+    if (run->latency) recordLatency(run->latency, psize, LATENCY_VERIFY, latencyNow() - start);
+    return missing;
+}
+
+void solveRun(run_t* run, int psize, num_t** grid, missing_t* missing, result_t* result) {
+    if (!result->attempted) return;
+    solveJob_t job;
+    if (startSolve(run, psize, grid, result, &job)) searchRun(run, psize, grid, missing, result);
+    endSolve(run, psize, grid, result, &job);
+}
+
+bool startSolve(run_t* run, int psize, num_t** grid, result_t* result, solveJob_t* job) {
+    cache_t* cache = run->cache;
+    job->start = run->latency ? latencyNow() : 0;
+    TRACE_BEGIN(span);
+    job->canon = cache ? canonicalize(psize, grid) : NULL;
+    if (job->canon) {
+        if (run->cacheLock) pthread_mutex_lock(run->cacheLock);
+        result->fromCache = cacheLookup(cache, job->canon, grid);
+        if (run->cacheLock) pthread_mutex_unlock(run->cacheLock);
+    }
+    if (cache) TRACE_END(span, "cache lookup");
+    if (result->fromCache) return false;
+    // solved by an earlier run
+    if (run->store) {
+        TRACE_BEGIN(storeSpan);
+        job->key = puzzleHash(psize, grid);
+        result->fromStore = storeLookup(run->store, job->key, psize, grid);
+        TRACE_END(storeSpan, "store lookup");
+        if (result->fromStore) return false;
+    }
+    engine_e engine = run->engine;
+    if (engine == ENGINE_AUTO) {
+        getFeatures(psize, grid, &result->features, run->arena);
+        engine = dispatch(run->dispatcher, &result->features);
+        result->routed = true;
+    }
+    else if (engine != ENGINE_PORTFOLIO) {
+        ++(run->dispatcher->picks[engine]);
+    }
+    result->engine = engine;
+    return true;
+}
+
+void searchRun(run_t* run, int psize, num_t** grid, missing_t* missing, result_t* result) {
+    if (result->engine == ENGINE_PORTFOLIO) {
+        result->winner = portfolioSolve(run->portfolio, psize, grid, &result->solved);
+    }
+    else {
+        result->solved = runEngine(result->engine, psize, grid, missing, run->checkpoint, run->deadEnds, run->arena);
+    }
+}
+
+void endSolve(run_t* run, int psize, num_t** grid, result_t* result, solveJob_t* job) {
+    if (!result->fromCache && (result->solved || result->fromStore)) {
+        if (result->solved && result->engine != ENGINE_PORTFOLIO) ++(run->dispatcher->solved[result->engine]);
+        if (result->solved && run->store) storeInsert(run->store, job->key, psize, grid);
+        if (job->canon) {
+            if (run->cacheLock) pthread_mutex_lock(run->cacheLock);
+            cacheInsert(run->cache, job->canon, grid);
+            if (run->cacheLock) pthread_mutex_unlock(run->cacheLock);
+        }
+    }
+    if (job->canon) deleteCanon(job->canon);
+    if (run->latency) {
+        latencyKind_e kind = result->fromCache || result->fromStore ? LATENCY_CACHE : (latencyKind_e)(LATENCY_SOLVE + result->engine);
+        recordLatency(run->latency, psize, kind, latencyNow() - job->start);
+    }
+}
+
+void printCheck(result_t* result) {
+    printf("Complete puzzle? ");
+    printf(result->complete ? "true\n" : "false\n");
+    if (result->complete) {
+        printf("Valid puzzle? ");
+        printf(result->valid ? "true\n" : "false\n");
+    }
+    if (result->rejection.reason != REJECT_NONE) printRejection(&result->rejection);
+}
+
+void printSolve(run_t* run, result_t* result) {
+    if (result->fromCache) {
+        printf("Solved from cache\n");
+        return;
+    }
+    if (result->fromStore) {
+        printf("Solved from store\n");
+        return;
+    }
+    if (result->routed && run->stats) printFeatures(&result->features, result->engine);
+    if (result->winner >= 0 && run->stats) {
+        printf("Portfolio: won by %s\n", run->portfolio->strategies[result->winner].name);
+    }
+    if (!result->solved) printNoSolution(result->engine);
+}
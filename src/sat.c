@@ -0,0 +1,702 @@
+/**
+ * @file sat.c
+ * @author Hayden Lauritzen (haydenlauritzen@gmail.com)
+ * @date 2023-1-16
+ *
+ * @copyright Copyright (c) 2023
+ *
+ */
+
+#include "../inc/sat.h"
+#include "../inc/propagate.h"
+
+// conflicts before the first restart, scaled by the luby sequence
+#define SAT_RESTART_BASE 100
+// returned by satPropagate for a binary conflict, see binaryConflict
+#define SAT_BINARY_CONFLICT -2
+
+static void vecPush(satVec_t* vec, const void* item, size_t itemSize) {
+    if (vec->size == vec->capacity) {
+        vec->capacity = vec->capacity ? vec->capacity * 2 : 4;
+        vec->data = realloc(vec->data, vec->capacity * itemSize);
+    }
+    memcpy((char*)vec->data + vec->size * itemSize, item, itemSize);
+    ++(vec->size);
+}
+
+static int litValue(satSolver_t* sat, int lit) {
+    signed char value = sat->value[lit >> 1];
+    return value == SAT_UNDEF ? SAT_UNDEF : value ^ (lit & 1);
+}
+
+// max heap of vars by activity
+static void heapUp(satSolver_t* sat, int i) {
+    int var = sat->heap[i];
+    while (i > 0) {
+        int parent = (i - 1) / 2;
+        if (sat->activity[sat->heap[parent]] >= sat->activity[var]) break;
+        sat->heap[i] = sat->heap[parent];
+        sat->heapIdx[sat->heap[i]] = i;
+        i = parent;
+    }
+    sat->heap[i] = var;
+    sat->heapIdx[var] = i;
+}
+
+static void heapDown(satSolver_t* sat, int i) {
+    int var = sat->heap[i];
+    for (;;) {
+        int child = 2 * i + 1;
+        if (child >= sat->heapSize) break;
+        if (child + 1 < sat->heapSize &&
+            sat->activity[sat->heap[child + 1]] > sat->activity[sat->heap[child]]) {
+            ++child;
+        }
+        if (sat->activity[sat->heap[child]] <= sat->activity[var]) break;
+        sat->heap[i] = sat->heap[child];
+        sat->heapIdx[sat->heap[i]] = i;
+        i = child;
+    }
+    sat->heap[i] = var;
+    sat->heapIdx[var] = i;
+}
+
+static void heapInsert(satSolver_t* sat, int var) {
+    if (sat->heapIdx[var] >= 0) return;
+    sat->heap[sat->heapSize] = var;
+    sat->heapIdx[var] = sat->heapSize;
+    heapUp(sat, sat->heapSize++);
+}
+
+static int heapRemoveMax(satSolver_t* sat) {
+    int var = sat->heap[0];
+    int last = sat->heap[--(sat->heapSize)];
+    sat->heapIdx[var] = -1;
+    if (sat->heapSize > 0) {
+        sat->heap[0] = last;
+        sat->heapIdx[last] = 0;
+        heapDown(sat, 0);
+    }
+    return var;
+}
+
+static void bumpVar(satSolver_t* sat, int var) {
+    if ((sat->activity[var] += sat->varInc) > 1e100) {
+        for (int i = 0; i < sat->numVars; ++i) {
+            sat->activity[i] *= 1e-100;
+        }
+        sat->varInc *= 1e-100;
+    }
+    if (sat->heapIdx[var] >= 0) heapUp(sat, sat->heapIdx[var]);
+}
+
+static void bumpClause(satSolver_t* sat, satClause_t* clause) {
+    if ((clause->activity += sat->clauseInc) > 1e20) {
+        for (int i = 0; i < sat->numClauses; ++i) {
+            sat->clauses[i].activity *= 1e-20;
+        }
+        sat->clauseInc *= 1e-20;
+    }
+}
+
+static void enqueue(satSolver_t* sat, int lit, int reason) {
+    int var = lit >> 1;
+    sat->value[var] = !(lit & 1);
+    sat->level[var] = sat->numLevels;
+    sat->reason[var] = reason;
+    sat->trail[sat->trailSize++] = lit;
+}
+
+static int newClause(satSolver_t* sat, int* lits, int size, bool learnt) {
+    if (sat->numClauses == sat->clauseCapacity) {
+        sat->clauseCapacity = sat->clauseCapacity ? sat->clauseCapacity * 2 : 64;
+        sat->clauses = (satClause_t*)realloc(sat->clauses, sizeof(satClause_t) * sat->clauseCapacity);
+    }
+    int idx = sat->numClauses++;
+    satClause_t* clause = &sat->clauses[idx];
+    clause->size = size;
+    clause->learnt = learnt;
+    clause->deleted = false;
+    clause->activity = 0;
+    clause->lits = (int*)malloc(sizeof(int) * size);
+    memcpy(clause->lits, lits, sizeof(int) * size);
+    // watchers sit on the negation, they wake up when it becomes true
+    satWatch_t watch0 = { idx, lits[1] };
+    satWatch_t watch1 = { idx, lits[0] };
+    vecPush(&sat->watches[lits[0] ^ 1], &watch0, sizeof(satWatch_t));
+    vecPush(&sat->watches[lits[1] ^ 1], &watch1, sizeof(satWatch_t));
+    if (learnt) ++(sat->numLearnts);
+    return idx;
+}
+
+static void addBinary(satSolver_t* sat, int a, int b) {
+    vecPush(&sat->binary[a ^ 1], &b, sizeof(int));
+    vecPush(&sat->binary[b ^ 1], &a, sizeof(int));
+}
+
+satSolver_t* createSat(int numVars) {
+    satSolver_t* sat = (satSolver_t*)calloc(1, sizeof(satSolver_t));
+    sat->numVars = numVars;
+    sat->watches = (satVec_t*)calloc(2 * numVars, sizeof(satVec_t));
+    sat->binary = (satVec_t*)calloc(2 * numVars, sizeof(satVec_t));
+    sat->value = (signed char*)malloc(numVars);
+    memset(sat->value, SAT_UNDEF, numVars);
+    sat->polarity = (bool*)calloc(numVars, sizeof(bool));
+    sat->level = (int*)calloc(numVars, sizeof(int));
+    sat->reason = (int*)malloc(sizeof(int) * numVars);
+    sat->trail = (int*)malloc(sizeof(int) * numVars);
+    sat->trailLim = (int*)malloc(sizeof(int) * numVars);
+    sat->activity = (double*)calloc(numVars, sizeof(double));
+    sat->varInc = 1;
+    sat->clauseInc = 1;
+    sat->heap = (int*)malloc(sizeof(int) * numVars);
+    sat->heapIdx = (int*)malloc(sizeof(int) * numVars);
+    sat->seen = (bool*)calloc(numVars, sizeof(bool));
+    sat->analyzeStack = (int*)malloc(sizeof(int) * numVars);
+    sat->analyzeClear = (int*)malloc(sizeof(int) * numVars);
+    for (int var = 0; var < numVars; ++var) {
+        sat->reason[var] = SAT_UNDEF;
+        sat->heapIdx[var] = -1;
+        heapInsert(sat, var);
+    }
+    return sat;
+}
+
+void deleteSat(satSolver_t* sat) {
+    for (int i = 0; i < sat->numClauses; ++i) {
+        free(sat->clauses[i].lits);
+    }
+    free(sat->clauses);
+    for (int lit = 0; lit < 2 * sat->numVars; ++lit) {
+        free(sat->watches[lit].data);
+        free(sat->binary[lit].data);
+    }
+    free(sat->watches);
+    free(sat->binary);
+    free(sat->value);
+    free(sat->polarity);
+    free(sat->level);
+    free(sat->reason);
+    free(sat->trail);
+    free(sat->trailLim);
+    free(sat->activity);
+    free(sat->heap);
+    free(sat->heapIdx);
+    free(sat->seen);
+    free(sat->analyzeStack);
+    free(sat->analyzeClear);
+    free(sat);
+}
+
+void satShuffle(satSolver_t* sat, unsigned seed) {
+    for (int var = 0; var < sat->numVars; ++var) {
+        sat->polarity[var] = nextRandom(&seed) & 1;
+        // far below one bump, so learning still takes over at once
+        sat->activity[var] = (nextRandom(&seed) % 1024) * 1e-6;
+    }
+    for (int i = sat->heapSize / 2 - 1; i >= 0; --i) {
+        heapDown(sat, i);
+    }
+}
+
+bool satAddClause(satSolver_t* sat, int* lits, int size) {
+    if (sat->unsat) return false;
+    // drop false and repeated literals, skip satisfied clauses
+    int kept[size + 1];
+    int numKept = 0;
+    for (int i = 0; i < size; ++i) {
+        int value = litValue(sat, lits[i]);
+        if (value == 1) return true;
+        if (value == 0) continue;
+        bool repeat = false;
+        for (int j = 0; j < numKept; ++j) {
+            if (kept[j] == (lits[i] ^ 1)) return true;
+            if (kept[j] == lits[i]) repeat = true;
+        }
+        if (!repeat) kept[numKept++] = lits[i];
+    }
+    if (numKept == 0) sat->unsat = true;
+    else if (numKept == 1) enqueue(sat, kept[0], SAT_UNDEF);
+    else if (numKept == 2) addBinary(sat, kept[0], kept[1]);
+    else newClause(sat, kept, numKept, false);
+    return !sat->unsat;
+}
+
+// returns the conflicting clause, SAT_BINARY_CONFLICT or SAT_UNDEF
+static int satPropagate(satSolver_t* sat) {
+    while (sat->qhead < sat->trailSize) {
+        int lit = sat->trail[sat->qhead++]; // just became true
+        int falseLit = lit ^ 1;
+        ++(sat->propagations);
+        satVec_t* implied = &sat->binary[lit];
+        for (int i = 0; i < implied->size; ++i) {
+            int other = ((int*)implied->data)[i];
+            int value = litValue(sat, other);
+            if (value == 0) {
+                sat->binaryConflict[0] = other;
+                sat->binaryConflict[1] = falseLit;
+                sat->qhead = sat->trailSize;
+                return SAT_BINARY_CONFLICT;
+            }
+            if (value == SAT_UNDEF) enqueue(sat, other, -2 - falseLit);
+        }
+        satVec_t* watches = &sat->watches[lit];
+        satWatch_t* watch = (satWatch_t*)watches->data;
+        int i = 0;
+        int j = 0;
+        int size = watches->size;
+        while (i < size) {
+            satWatch_t cur = watch[i++];
+            if (litValue(sat, cur.blocker) == 1) {
+                watch[j++] = cur;
+                continue;
+            }
+            satClause_t* clause = &sat->clauses[cur.clause];
+            if (clause->deleted) continue; // dropped by reduceLearnts
+            int* lits = clause->lits;
+            // keep the false literal in lits[1]
+            if (lits[0] == falseLit) {
+                lits[0] = lits[1];
+                lits[1] = falseLit;
+            }
+            int first = lits[0];
+            satWatch_t keep = { cur.clause, first };
+            if (first != cur.blocker && litValue(sat, first) == 1) {
+                watch[j++] = keep;
+                continue;
+            }
+            // look for another literal to watch
+            bool moved = false;
+            for (int k = 2; k < clause->size; ++k) {
+                if (litValue(sat, lits[k]) != 0) {
+                    lits[1] = lits[k];
+                    lits[k] = falseLit;
+                    vecPush(&sat->watches[lits[1] ^ 1], &keep, sizeof(satWatch_t));
+                    moved = true;
+                    break;
+                }
+            }
+            if (moved) continue;
+            // clause is unit or conflicting
+            watch[j++] = keep;
+            if (litValue(sat, first) == 0) {
+                while (i < size) {
+                    watch[j++] = watch[i++];
+                }
+                watches->size = j;
+                sat->qhead = sat->trailSize;
+                return cur.clause;
+            }
+            enqueue(sat, first, cur.clause);
+        }
+        watches->size = j;
+    }
+    return SAT_UNDEF;
+}
+
+// literals of the clause behind a conflict or reason, the implied one first
+static int* reasonLits(satSolver_t* sat, int reason, int lit, int* buffer, int* size) {
+    if (reason >= 0) {
+        *size = sat->clauses[reason].size;
+        return sat->clauses[reason].lits;
+    }
+    if (reason == SAT_BINARY_CONFLICT && lit == SAT_UNDEF) {
+        buffer[0] = sat->binaryConflict[0];
+        buffer[1] = sat->binaryConflict[1];
+    }
+    else {
+        buffer[0] = lit;
+        buffer[1] = -2 - reason;
+    }
+    *size = 2;
+    return buffer;
+}
+
+// a learnt literal is redundant if its reason only leads back to
+// literals already in the learnt clause or fixed at level 0
+static bool isRedundant(satSolver_t* sat, int lit, unsigned levels, int* numClear) {
+    int top = *numClear;
+    int stackSize = 0;
+    sat->analyzeStack[stackSize++] = lit;
+    while (stackSize > 0) {
+        int cur = sat->analyzeStack[--stackSize];
+        int buffer[2];
+        int numLits;
+        int* lits = reasonLits(sat, sat->reason[cur >> 1], cur ^ 1, buffer, &numLits);
+        for (int k = 1; k < numLits; ++k) {
+            int var = lits[k] >> 1;
+            if (sat->seen[var] || sat->level[var] == 0) continue;
+            if (sat->reason[var] != SAT_UNDEF && ((1u << (sat->level[var] & 31)) & levels)) {
+                sat->seen[var] = true;
+                sat->analyzeStack[stackSize++] = lits[k];
+                sat->analyzeClear[(*numClear)++] = lits[k];
+            }
+            else {
+                // reached a decision, undo what this call marked
+                for (int i = top; i < *numClear; ++i) {
+                    sat->seen[sat->analyzeClear[i] >> 1] = false;
+                }
+                *numClear = top;
+                return false;
+            }
+        }
+    }
+    return true;
+}
+
+// first-UIP learning, returns the learnt size and the level to go back to
+static int analyze(satSolver_t* sat, int conflict, int* learnt, int* backLevel) {
+    int size = 1; // learnt[0] is the asserting literal
+    int pathCount = 0;
+    int lit = SAT_UNDEF;
+    int idx = sat->trailSize - 1;
+    int reason = conflict;
+    int buffer[2];
+    do {
+        int numLits;
+        int* lits = reasonLits(sat, reason, lit, buffer, &numLits);
+        if (reason >= 0 && sat->clauses[reason].learnt) bumpClause(sat, &sat->clauses[reason]);
+        for (int k = lit == SAT_UNDEF ? 0 : 1; k < numLits; ++k) {
+            int var = lits[k] >> 1;
+            if (sat->seen[var] || sat->level[var] == 0) continue;
+            bumpVar(sat, var);
+            sat->seen[var] = true;
+            if (sat->level[var] >= sat->numLevels) ++pathCount;
+            else learnt[size++] = lits[k];
+        }
+        // next literal of this level on the trail
+        while (!sat->seen[sat->trail[idx] >> 1]) {
+            --idx;
+        }
+        lit = sat->trail[idx--];
+        sat->seen[lit >> 1] = false;
+        reason = sat->reason[lit >> 1];
+        --pathCount;
+    } while (pathCount > 0);
+    learnt[0] = lit ^ 1;
+
+    // drop the literals implied by the rest of the clause
+    int numClear = 0;
+    unsigned levels = 0;
+    for (int i = 1; i < size; ++i) {
+        sat->analyzeClear[numClear++] = learnt[i];
+        levels |= 1u << (sat->level[learnt[i] >> 1] & 31);
+    }
+    int kept = 1;
+    for (int i = 1; i < size; ++i) {
+        if (sat->reason[learnt[i] >> 1] == SAT_UNDEF || !isRedundant(sat, learnt[i], levels, &numClear)) {
+            learnt[kept++] = learnt[i];
+        }
+    }
+    size = kept;
+    for (int i = 0; i < numClear; ++i) {
+        sat->seen[sat->analyzeClear[i] >> 1] = false;
+    }
+
+    *backLevel = 0;
+    for (int i = 1; i < size; ++i) {
+        if (sat->level[learnt[i] >> 1] > *backLevel) {
+            *backLevel = sat->level[learnt[i] >> 1];
+            // the highest level literal is watched next to the asserting one
+            int swap = learnt[1];
+            learnt[1] = learnt[i];
+            learnt[i] = swap;
+        }
+    }
+    return size;
+}
+
+static void cancelUntil(satSolver_t* sat, int level) {
+    if (sat->numLevels <= level) return;
+    for (int i = sat->trailSize - 1; i >= sat->trailLim[level]; --i) {
+        int var = sat->trail[i] >> 1;
+        sat->polarity[var] = sat->value[var];
+        sat->value[var] = SAT_UNDEF;
+        sat->reason[var] = SAT_UNDEF;
+        heapInsert(sat, var);
+    }
+    sat->trailSize = sat->qhead = sat->trailLim[level];
+    sat->numLevels = level;
+}
+
+static bool isLocked(satSolver_t* sat, int idx) {
+    int lit = sat->clauses[idx].lits[0];
+    return sat->reason[lit >> 1] == idx && litValue(sat, lit) == 1;
+}
+
+typedef struct satRank_t {
+  double activity;
+  int clause;
+} satRank_t;
+
+static int compareRank(const void* a, const void* b) {
+    double x = ((const satRank_t*)a)->activity;
+    double y = ((const satRank_t*)b)->activity;
+    return (x > y) - (x < y);
+}
+
+// drops the less active half of the learnt clauses
+static void reduceLearnts(satSolver_t* sat) {
+    satRank_t* ranks = (satRank_t*)malloc(sizeof(satRank_t) * sat->numLearnts);
+    int count = 0;
+    for (int i = 0; i < sat->numClauses; ++i) {
+        satClause_t* clause = &sat->clauses[i];
+        if (clause->learnt && !clause->deleted && !isLocked(sat, i)) {
+            ranks[count].activity = clause->activity;
+            ranks[count++].clause = i;
+        }
+    }
+    qsort(ranks, count, sizeof(satRank_t), compareRank);
+    for (int i = 0; i < count / 2; ++i) {
+        satClause_t* clause = &sat->clauses[ranks[i].clause];
+        // watchers are dropped the next time satPropagate walks past them
+        clause->deleted = true;
+        free(clause->lits);
+        clause->lits = NULL;
+        --(sat->numLearnts);
+    }
+    free(ranks);
+}
+
+// 1, 1, 2, 1, 1, 2, 4, 1, 1, 2, ...
+static long luby(long x) {
+    long size = 1;
+    int seq = 0;
+    while (size < x + 1) {
+        ++seq;
+        size = 2 * size + 1;
+    }
+    while (size - 1 != x) {
+        size = (size - 1) >> 1;
+        --seq;
+        x = x % size;
+    }
+    return 1L << seq;
+}
+
+int satSolve(satSolver_t* sat, long maxConflicts) {
+    if (sat->unsat) return 0;
+    if (satPropagate(sat) != SAT_UNDEF) {
+        sat->unsat = true;
+        return 0;
+    }
+    int* learnt = (int*)malloc(sizeof(int) * (sat->numVars + 1));
+    long start = sat->conflicts;
+    long maxLearnts = sat->numClauses / 3 + 1000;
+    int result = SAT_UNDEF;
+    for (long restarts = 0; result == SAT_UNDEF; ++restarts) {
+        TRACE_BEGIN(span);
+        long restartLimit = luby(restarts) * SAT_RESTART_BASE;
+        long restartConflicts = 0;
+        for (;;) {
+            int conflict = satPropagate(sat);
+            if (conflict != SAT_UNDEF) {
+                ++(sat->conflicts);
+                ++restartConflicts;
+                if (sat->numLevels == 0) {
+                    sat->unsat = true;
+                    result = 0;
+                    break;
+                }
+                int backLevel;
+                int size = analyze(sat, conflict, learnt, &backLevel);
+                cancelUntil(sat, backLevel);
+                if (size == 1) {
+                    enqueue(sat, learnt[0], SAT_UNDEF);
+                }
+                else if (size == 2) {
+                    addBinary(sat, learnt[0], learnt[1]);
+                    enqueue(sat, learnt[0], -2 - learnt[1]);
+                }
+                else {
+                    int idx = newClause(sat, learnt, size, true);
+                    bumpClause(sat, &sat->clauses[idx]);
+                    enqueue(sat, learnt[0], idx);
+                }
+                sat->varInc /= 0.95;
+                sat->clauseInc /= 0.999;
+                continue;
+            }
+            if (maxConflicts > 0 && sat->conflicts - start >= maxConflicts) {
+                cancelUntil(sat, 0);
+                break;
+            }
+            if (restartConflicts >= restartLimit) {
+                cancelUntil(sat, 0);
+                break;
+            }
+            if (sat->stop && atomic_load_explicit(sat->stop, memory_order_relaxed)) {
+                cancelUntil(sat, 0);
+                break;
+            }
+            if (sat->numLearnts >= maxLearnts + sat->trailSize) {
+                reduceLearnts(sat);
+                maxLearnts += maxLearnts / 10;
+            }
+            // branch on the most active unassigned var
+            int var = -1;
+            while (sat->heapSize > 0) {
+                int next = heapRemoveMax(sat);
+                if (sat->value[next] == SAT_UNDEF) {
+                    var = next;
+                    break;
+                }
+            }
+            if (var < 0) {
+                result = 1; // every var has a value
+                break;
+            }
+            ++(sat->decisions);
+            sat->trailLim[sat->numLevels++] = sat->trailSize;
+            enqueue(sat, 2 * var + !sat->polarity[var], SAT_UNDEF);
+        }
+        TRACE_END(span, "sat restart");
+        if (result == SAT_UNDEF && maxConflicts > 0 && sat->conflicts - start >= maxConflicts) break;
+        if (result == SAT_UNDEF && sat->stop && atomic_load_explicit(sat->stop, memory_order_relaxed)) break;
+    }
+    free(learnt);
+    return result;
+}
+
+bool satModel(satSolver_t* sat, int var) {
+    return sat->value[var] == 1;
+}
+
+// groups up to this size use pairwise at-most-one clauses, bigger ones
+// a sequential counter: size - 1 extra vars and 3 * size clauses
+#define SAT_PAIRWISE_MAX 16
+
+// at least one and at most one of lits is true; with sat NULL it only
+// counts the extra vars the group needs
+static void exactlyOne(satSolver_t* sat, int* lits, int size, int* nextVar) {
+    if (size <= SAT_PAIRWISE_MAX) {
+        if (sat == NULL) return;
+        satAddClause(sat, lits, size);
+        for (int i = 0; i < size; ++i) {
+            for (int j = i + 1; j < size; ++j) {
+                int pair[2] = { lits[i] ^ 1, lits[j] ^ 1 };
+                satAddClause(sat, pair, 2);
+            }
+        }
+        return;
+    }
+    // s_i is true once one of lits[0..i] is
+    int first = *nextVar;
+    *nextVar += size - 1;
+    if (sat == NULL) return;
+    satAddClause(sat, lits, size);
+    for (int i = 0; i < size - 1; ++i) {
+        int s = 2 * (first + i);
+        int implies[2] = { lits[i] ^ 1, s };
+        satAddClause(sat, implies, 2);
+        if (i == 0) continue;
+        int prev = 2 * (first + i - 1);
+        int carry[2] = { prev ^ 1, s };
+        int notBoth[2] = { lits[i] ^ 1, prev ^ 1 };
+        satAddClause(sat, carry, 2);
+        satAddClause(sat, notBoth, 2);
+    }
+    int last[2] = { lits[size - 1] ^ 1, (2 * (first + size - 2)) ^ 1 };
+    satAddClause(sat, last, 2);
+}
+
+// vars of a cell's candidates are numbered in order from firstVar
+typedef struct satVars_t {
+    int* firstVar; // per cell
+    mask_t* cand;  // per cell, none for a filled cell
+} satVars_t;
+
+// var of num in cell, -1 if it is not a candidate
+static int varOf(satVars_t* vars, int cell, int num) {
+    if (!maskTest(vars->cand[cell], num)) return -1;
+    return vars->firstVar[cell] + maskRank(vars->cand[cell], num);
+}
+
+// every cell and every missing (unit, number) gets exactly one
+static void addGroups(satSolver_t* sat, propState_t* state, satVars_t* vars, int* lits, int* nextVar) {
+    int psize = state->psize;
+    // exactly one number per empty cell
+    for (int cell = 0; cell < psize * psize; ++cell) {
+        if (state->cells[cell] != 0) continue;
+        int size = 0;
+        for (int num = 1; num <= psize; ++num) {
+            int var = varOf(vars, cell, num);
+            if (var >= 0) lits[size++] = 2 * var;
+        }
+        exactlyOne(sat, lits, size, nextVar);
+    }
+    // every number missing from a unit goes in exactly one of its cells
+    for (enum subset type = rows; type <= grids; ++type) {
+        for (int unit = 0; unit < psize; ++unit) {
+            for (int num = 1; num <= psize; ++num) {
+                int size = 0;
+                bool placed = false;
+                for (int i = 0; i < psize; ++i) {
+                    cell_t* inBox = &state->shape->cells[unit * psize + i];
+                    int row = type == rows ? unit : type == cols ? i : inBox->row;
+                    int col = type == rows ? i : type == cols ? unit : inBox->col;
+                    if (state->cells[row * psize + col] == num) placed = true;
+                    int var = varOf(vars, row * psize + col, num);
+                    if (var >= 0) lits[size++] = 2 * var;
+                }
+                if (placed) continue;
+                exactlyOne(sat, lits, size, nextVar);
+            }
+        }
+    }
+}
+
+bool satSolvePuzzle(int psize, num_t** grid, arena_t* arena) {
+    return satSearchPuzzle(psize, grid, NULL, arena);
+}
+
+bool satSearchPuzzle(int psize, num_t** grid, searchOpts_t* opts, arena_t* arena) {
+    arenaMark_t mark = arenaMark(arena);
+    // fill the singles first, they only make the formula bigger
+    propState_t* state = createPropState(psize, grid, arena);
+    if (state == NULL || !propagate(state)) {
+        arenaRelease(arena, mark);
+        return false;
+    }
+    // one var per candidate of an empty cell
+    satVars_t vars;
+    vars.firstVar = (int*)arenaAlloc(arena, sizeof(int) * psize * psize);
+    vars.cand = (mask_t*)arenaAlloc(arena, sizeof(mask_t) * psize * psize);
+    int numVars = 0;
+    for (int row = 0; row < psize; ++row) {
+        for (int col = 0; col < psize; ++col) {
+            int cell = row * psize + col;
+            vars.cand[cell] = state->cells[cell] ? maskNone() : getCandidates(state, row, col);
+            vars.firstVar[cell] = numVars;
+            numVars += maskCount(vars.cand[cell]);
+        }
+    }
+    int* lits = (int*)arenaAlloc(arena, sizeof(int) * psize);
+    // counters of big groups come after the candidates
+    int totalVars = numVars;
+    addGroups(NULL, state, &vars, lits, &totalVars);
+    satSolver_t* sat = createSat(totalVars > 0 ? totalVars : 1);
+    int nextVar = numVars;
+    addGroups(sat, state, &vars, lits, &nextVar);
+    if (opts) {
+        sat->stop = opts->stop;
+        if (opts->seed) satShuffle(sat, opts->seed);
+    }
+    bool solved = satSolve(sat, 0) == 1;
+    if (solved) {
+        for (int row = 0; row < psize; ++row) {
+            for (int col = 0; col < psize; ++col) {
+                int cell = row * psize + col;
+                int num = state->cells[cell];
+                for (int n = 1; num == 0 && n <= psize; ++n) {
+                    int var = varOf(&vars, cell, n);
+                    if (var >= 0 && satModel(sat, var)) num = n;
+                }
+                grid[row + 1][col + 1] = (num_t)num;
+            }
+        }
+    }
+    deleteSat(sat);
+    arenaRelease(arena, mark);
+    return solved;
+}
@@ -0,0 +1,232 @@
+/**
+ * @file session.c
+ * @author Hayden Lauritzen (haydenlauritzen@gmail.com)
+ * @date 2023-1-16
+ *
+ * @copyright Copyright (c) 2023
+ *
+ */
+
+#include "../inc/session.h"
+
+// the session's own arrays take a few KB; searches grow it as they need
+#define SESSION_ARENA ((size_t)64 << 10)
+
+static const char* hintNames[] = {
+    "solved", "conflict", "no candidates", "no place", "naked single", "hidden single", "guess"
+};
+
+static unsigned char* countOf(session_t* session, enum subset type, int unit, int num) {
+    int psize = session->state.psize;
+    return &session->count[((int)type * psize + unit) * (psize + 1) + num];
+}
+
+// adds (delta 1) or removes (delta -1) num from one unit
+static void countNum(session_t* session, enum subset type, int unit, int num, int delta) {
+    unsigned char* count = countOf(session, type, unit, num);
+    mask_t* used = unitUsed(&session->state, type, unit);
+    if (delta > 0) {
+        if (++(*count) == 1) maskSet(used, num);
+        else if (*count == 2) ++(session->conflicts);
+    }
+    else {
+        if (--(*count) == 0) maskClear(used, num);
+        else if (*count == 1) --(session->conflicts);
+    }
+}
+
+static void countCell(session_t* session, int row, int col, int num, int delta) {
+    countNum(session, rows, row, num, delta);
+    countNum(session, cols, col, num, delta);
+    countNum(session, grids, boxOf(&session->state, row, col), num, delta);
+}
+
+static void updateDead(session_t* session, int row, int col) {
+    propState_t* state = &session->state;
+    int idx = row * state->psize + col;
+    bool dead = state->cells[idx] == 0 && maskEmpty(getCandidates(state, row, col));
+    if (dead != session->dead[idx]) {
+        session->dead[idx] = dead;
+        session->deadCells += dead ? 1 : -1;
+    }
+}
+
+session_t* createSession(int psize, num_t** grid) {
+    session_t* session = (session_t*)calloc(1, sizeof(session_t));
+    arena_t* arena = createArena(SESSION_ARENA);
+    session->arena = arena;
+    propState_t* state = &session->state;
+    state->psize = psize;
+    state->shape = getShape(psize, grid);
+    state->rowUsed = (mask_t*)arenaAlloc(arena, sizeof(mask_t) * psize);
+    state->colUsed = (mask_t*)arenaAlloc(arena, sizeof(mask_t) * psize);
+    state->boxUsed = (mask_t*)arenaAlloc(arena, sizeof(mask_t) * psize);
+    state->cells = (num_t*)arenaAlloc(arena, sizeof(num_t) * psize * psize);
+    state->empty = psize * psize;
+    session->count = (unsigned char*)arenaAlloc(arena, 3 * psize * (psize + 1));
+    session->dead = (bool*)arenaAlloc(arena, sizeof(bool) * psize * psize);
+    session->cand = (mask_t*)arenaAlloc(arena, sizeof(mask_t) * psize * psize);
+    for (int row = 1; row <= psize; ++row) {
+        for (int col = 1; col <= psize; ++col) {
+            if (grid[row][col]) setCell(session, row, col, grid[row][col]);
+        }
+    }
+    return session;
+}
+
+void deleteSession(session_t* session) {
+    deleteArena(session->arena);
+    free(session);
+}
+
+bool setCell(session_t* session, int row, int col, int num) {
+    propState_t* state = &session->state;
+    int psize = state->psize;
+    if (row < 1 || row > psize || col < 1 || col > psize || num < 0 || num > psize) return false;
+    --row;
+    --col;
+    num_t* cell = &state->cells[row * psize + col];
+    if (*cell == num) return true;
+    if (*cell) {
+        countCell(session, row, col, *cell, -1);
+        ++(state->empty);
+    }
+    *cell = (num_t)num;
+    if (num) {
+        countCell(session, row, col, num, 1);
+        --(state->empty);
+    }
+    // only cells sharing a unit with this one can gain or lose candidates
+    int box = boxOf(state, row, col);
+    for (int i = 0; i < psize; ++i) {
+        int boxRow, boxCol;
+        unitCell(state, grids, box, i, &boxRow, &boxCol);
+        updateDead(session, row, i);
+        updateDead(session, i, col);
+        updateDead(session, boxRow, boxCol);
+    }
+    return true;
+}
+
+int getCell(session_t* session, int row, int col) {
+    return session->state.cells[(row - 1) * session->state.psize + col - 1];
+}
+
+mask_t cellCandidates(session_t* session, int row, int col) {
+    if (getCell(session, row, col)) return maskNone();
+    return getCandidates(&session->state, row - 1, col - 1);
+}
+
+// the unit of the cell where its number repeats, -1 if none
+static int conflictUnit(session_t* session, int row, int col, enum subset* type) {
+    propState_t* state = &session->state;
+    int num = state->cells[row * state->psize + col];
+    if (num == 0) return -1;
+    int units[3] = { row, col, boxOf(state, row, col) };
+    for (enum subset t = rows; t <= grids; ++t) {
+        if (*countOf(session, t, units[t], num) > 1) {
+            *type = t;
+            return units[t];
+        }
+    }
+    return -1;
+}
+
+bool cellConflicts(session_t* session, int row, int col) {
+    enum subset type;
+    return conflictUnit(session, row - 1, col - 1, &type) >= 0;
+}
+
+static hint_t makeHint(hintKind_e kind, int row, int col, int num, enum subset unit, int unitIdx) {
+    hint_t hint = { kind, row + 1, col + 1, num, unit, unitIdx + 1 };
+    return hint;
+}
+
+hint_t nextHint(session_t* session) {
+    propState_t* state = &session->state;
+    int psize = state->psize;
+    // a broken board first, nothing else is worth doing until it is fixed
+    for (int row = 0; row < psize && (session->conflicts || session->deadCells); ++row) {
+        for (int col = 0; col < psize; ++col) {
+            enum subset type;
+            int unit = conflictUnit(session, row, col, &type);
+            if (unit >= 0) return makeHint(HINT_CONFLICT, row, col, state->cells[row * psize + col], type, unit);
+            if (session->dead[row * psize + col]) return makeHint(HINT_NO_CANDIDATES, row, col, 0, rows, row);
+        }
+    }
+    if (state->empty == 0) return makeHint(HINT_SOLVED, -1, -1, 0, rows, -1);
+    // naked singles, and the cell to guess on if it comes to that;
+    // candidates are kept for the unit passes below
+    int bestRow = 0, bestCol = 0, bestCount = psize + 1;
+    for (int row = 0; row < psize; ++row) {
+        for (int col = 0; col < psize; ++col) {
+            mask_t* cand = &session->cand[row * psize + col];
+            *cand = maskNone();
+            if (state->cells[row * psize + col]) continue;
+            *cand = getCandidates(state, row, col);
+            if (maskSingle(*cand)) return makeHint(HINT_NAKED_SINGLE, row, col, maskFirst(*cand), rows, row);
+            int count = maskCount(*cand);
+            if (count < bestCount) {
+                bestRow = row;
+                bestCol = col;
+                bestCount = count;
+            }
+        }
+    }
+    // hidden singles, unless some unit can't be finished at all
+    hint_t hidden = makeHint(HINT_GUESS, bestRow, bestCol,
+        maskFirst(session->cand[bestRow * psize + bestCol]), rows, bestRow);
+    for (enum subset type = rows; type <= grids; ++type) {
+        for (int unit = 0; unit < psize; ++unit) {
+            mask_t once = maskNone();
+            mask_t twice = maskNone();
+            for (int i = 0; i < psize; ++i) {
+                int row, col;
+                unitCell(state, type, unit, i, &row, &col);
+                mask_t cand = session->cand[row * psize + col];
+                twice = maskOr(twice, maskAnd(once, cand));
+                once = maskOr(once, cand);
+            }
+            mask_t missing = maskAndNot(maskAll(psize), *unitUsed(state, type, unit));
+            mask_t noPlace = maskAndNot(missing, once);
+            if (!maskEmpty(noPlace)) return makeHint(HINT_NO_PLACE, -1, -1, maskFirst(noPlace), type, unit);
+            mask_t only = maskAndNot(once, twice);
+            if (hidden.kind != HINT_GUESS || maskEmpty(only)) continue;
+            int num = maskFirst(only);
+            for (int i = 0; i < psize; ++i) {
+                int row, col;
+                unitCell(state, type, unit, i, &row, &col);
+                if (maskTest(session->cand[row * psize + col], num)) {
+                    hidden = makeHint(HINT_HIDDEN_SINGLE, row, col, num, type, unit);
+                    break;
+                }
+            }
+        }
+    }
+    return hidden;
+}
+
+const char* hintName(hintKind_e kind) {
+    return hintNames[kind];
+}
+
+bool sessionSolvable(session_t* session) {
+    propState_t* state = &session->state;
+    if (session->conflicts || session->deadCells) return false;
+    if (state->empty == 0) return true;
+    num_t** grid = createSudokuPuzzle(state->psize);
+    setBoxShape(state->psize, grid, state->shape->boxRows, state->shape->boxCols);
+    sessionBoard(session, grid);
+    arenaMark_t mark = arenaMark(session->arena);
+    bool solvable = propagateSolve(state->psize, grid, session->arena);
+    arenaRelease(session->arena, mark);
+    deleteSudokuPuzzle(state->psize, grid);
+    return solvable;
+}
+
+void sessionBoard(session_t* session, num_t** grid) {
+    int psize = session->state.psize;
+    for (int row = 0; row < psize; ++row) {
+        memcpy(grid[row + 1] + 1, session->state.cells + row * psize, sizeof(num_t) * psize);
+    }
+}
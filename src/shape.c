@@ -0,0 +1,70 @@
+/**
+ * @file shape.c
+ * @author Hayden Lauritzen (haydenlauritzen@gmail.com)
+ * @date 2023-1-16
+ *
+ * @copyright Copyright (c) 2023
+ *
+ */
+
+#include "../inc/shape.h"
+
+// every shape made so far, a list per size; only ever pushed on
+static _Atomic(shape_t*) shapes[MAX_PSIZE + 1];
+
+int defaultBoxRows(int psize) {
+    int boxRows = 1;
+    for (int rows = 1; rows * rows <= psize; ++rows) {
+        if (psize % rows == 0) boxRows = rows;
+    }
+    return boxRows;
+}
+
+bool setBoxShape(int psize, num_t** grid, int boxRows, int boxCols) {
+    if (boxRows < 1 || boxCols < 1 || boxRows * boxCols != psize) return false;
+    grid[0][0] = boxRows == defaultBoxRows(psize) ? 0 : (num_t)boxRows;
+    return true;
+}
+
+static shape_t* makeShape(int psize, int boxRows) {
+    shape_t* shape = (shape_t*)malloc(sizeof(shape_t));
+    shape->psize = psize;
+    shape->boxRows = boxRows;
+    shape->boxCols = psize / boxRows;
+    shape->boxOf = (int*)malloc(sizeof(int) * psize * psize);
+    shape->cells = (cell_t*)malloc(sizeof(cell_t) * psize * psize);
+    shape->next = NULL;
+    // a band of boxes is boxRows rows, with psize / boxCols == boxRows boxes across
+    for (int box = 0; box < psize; ++box) {
+        int top = (box / boxRows) * boxRows;
+        int left = (box % boxRows) * shape->boxCols;
+        for (int i = 0; i < psize; ++i) {
+            int row = top + i / shape->boxCols;
+            int col = left + i % shape->boxCols;
+            shape->cells[box * psize + i] = (cell_t){ row, col };
+            shape->boxOf[row * psize + col] = box;
+        }
+    }
+    return shape;
+}
+
+const shape_t* findShape(int psize, int boxRows) {
+    if (boxRows == 0) boxRows = defaultBoxRows(psize);
+    shape_t* head = atomic_load(&shapes[psize]);
+    while (true) {
+        for (shape_t* shape = head; shape != NULL; shape = shape->next) {
+            if (shape->boxRows == boxRows) return shape;
+        }
+        // first board of this shape; if another thread pushes first, look again
+        shape_t* made = makeShape(psize, boxRows);
+        made->next = head;
+        if (atomic_compare_exchange_strong(&shapes[psize], &head, made)) return made;
+        free(made->boxOf);
+        free(made->cells);
+        free(made);
+    }
+}
+
+const shape_t* getShape(int psize, num_t** grid) {
+    return findShape(psize, grid[0][0]);
+}
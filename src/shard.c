@@ -0,0 +1,366 @@
+/**
+ * @file shard.c
+ * @author Hayden Lauritzen (haydenlauritzen@gmail.com)
+ * @date 2023-1-16
+ *
+ * @copyright Copyright (c) 2023
+ *
+ */
+
+#include <fcntl.h>    // open()
+#include <limits.h>   // PATH_MAX
+#include <sys/wait.h> // waitpid()
+#include <unistd.h>   // fork(), execv(), dup2(), unlink()
+
+#include "../inc/shard.h"
+
+// what a shard's process reported
+typedef struct shardCounts_t {
+  long puzzles;
+  long picks[NUM_ENGINES];
+  long solved[NUM_ENGINES];
+  long cache[3];    // hits, misses, evictions
+  long store[3];    // hits, misses, added
+  long deadEnds[3]; // stored, hits, misses
+  bool hasCache;
+  bool hasStore;
+  bool hasDeadEnds;
+} shardCounts_t;
+
+typedef struct shard_t {
+  long first;     // index of its first puzzle
+  long puzzles;
+  int attempts;
+  pid_t pid;      // 0 while not running
+  long started;   // ns, of the running attempt
+  long elapsed;   // ns, of the attempt that finished it
+  bool done;
+  bool failed;    // every attempt did
+  char why[64];   // how the last failed attempt ended
+  shardCounts_t counts;
+} shard_t;
+
+typedef struct coordinator_t {
+  shardConfig_t* config;
+  char dir[PATH_MAX / 2];
+  char** argv;      // for every process; the shard file goes in argv[inputArg]
+  int inputArg;
+  shard_t* shards;  // sealed ones, the shard being filled is not in yet
+  int numShards;
+  int capacity;
+  int running;
+  int merged;       // shards copied to stdout
+  int retries;
+} coordinator_t;
+
+static void shardPath(coordinator_t* co, int k, const char* ext, char* path) {
+    snprintf(path, PATH_MAX, "%s/shard-%d.%s", co->dir, k, ext);
+}
+
+void writeShardStats(const char* filename, run_t* run, long puzzles) {
+    FILE* fp = fopen(filename, "w");
+    if (fp == NULL) return;
+    fprintf(fp, "puzzles %ld\n", puzzles);
+    fprintf(fp, "picks");
+    for (int e = 0; e < NUM_ENGINES; ++e) fprintf(fp, " %ld", run->dispatcher->picks[e]);
+    fprintf(fp, "\nsolved");
+    for (int e = 0; e < NUM_ENGINES; ++e) fprintf(fp, " %ld", run->dispatcher->solved[e]);
+    fprintf(fp, "\n");
+    if (run->cache) {
+        fprintf(fp, "cache %ld %ld %ld\n", run->cache->hits, run->cache->misses, run->cache->evictions);
+    }
+    if (run->store) {
+        fprintf(fp, "store %ld %ld %ld\n", atomic_load(&run->store->hits), atomic_load(&run->store->misses),
+            atomic_load(&run->store->added));
+    }
+    if (run->deadEnds) {
+        fprintf(fp, "deadends %ld %ld %ld\n", atomic_load(&run->deadEnds->inserts),
+            atomic_load(&run->deadEnds->hits), atomic_load(&run->deadEnds->misses));
+    }
+    fclose(fp);
+}
+
+// up to n numbers after the name, returns how many there were
+static int readValues(char* text, long* values, int n) {
+    int read = 0;
+    char* end;
+    for (; read < n; ++read) {
+        values[read] = strtol(text, &end, 10);
+        if (end == text) break;
+        text = end;
+    }
+    return read;
+}
+
+// false if the process left no stats
+static bool readShardStats(const char* filename, shardCounts_t* counts) {
+    memset(counts, 0, sizeof(shardCounts_t));
+    counts->puzzles = -1;
+    FILE* fp = fopen(filename, "r");
+    if (fp == NULL) return false;
+    char line[256];
+    char name[16];
+    int used;
+    while (fgets(line, sizeof(line), fp) != NULL) {
+        if (sscanf(line, "%15s%n", name, &used) != 1) continue;
+        char* rest = line + used;
+        if (strcmp(name, "puzzles") == 0) readValues(rest, &counts->puzzles, 1);
+        else if (strcmp(name, "picks") == 0) readValues(rest, counts->picks, NUM_ENGINES);
+        else if (strcmp(name, "solved") == 0) readValues(rest, counts->solved, NUM_ENGINES);
+        else if (strcmp(name, "cache") == 0) counts->hasCache = readValues(rest, counts->cache, 3) == 3;
+        else if (strcmp(name, "store") == 0) counts->hasStore = readValues(rest, counts->store, 3) == 3;
+        else if (strcmp(name, "deadends") == 0) counts->hasDeadEnds = readValues(rest, counts->deadEnds, 3) == 3;
+    }
+    fclose(fp);
+    return counts->puzzles >= 0;
+}
+
+static void startShard(coordinator_t* co, int k) {
+    shard_t* shard = &co->shards[k];
+    char input[PATH_MAX], output[PATH_MAX], stats[PATH_MAX];
+    shardPath(co, k, "txt", input);
+    shardPath(co, k, "out", output);
+    shardPath(co, k, "stats", stats);
+    // a retry must not find the stats of the attempt before it
+    unlink(stats);
+    co->argv[co->inputArg] = input;
+    ++shard->attempts;
+    shard->started = latencyNow();
+    // the process gets a copy of anything still buffered
+    fflush(stdout);
+    pid_t pid = fork();
+    if (pid == 0) {
+        int out = open(output, O_WRONLY | O_CREAT | O_TRUNC, 0644);
+        if (out < 0 || dup2(out, STDOUT_FILENO) < 0) _exit(EXIT_FAILURE);
+        close(out);
+        char num[16];
+        snprintf(num, sizeof(num), "%d", k);
+        setenv(SHARD_ENV, num, 1);
+        setenv(SHARD_STATS_ENV, stats, 1);
+        execv("/proc/self/exe", co->argv);
+        _exit(EXIT_FAILURE);
+    }
+    co->argv[co->inputArg] = NULL;
+    if (pid < 0) {
+        snprintf(shard->why, sizeof(shard->why), "could not fork");
+        if (shard->attempts >= SHARD_ATTEMPTS) shard->failed = true;
+        else ++co->retries;
+        return;
+    }
+    shard->pid = pid;
+    ++co->running;
+}
+
+static void finishShard(coordinator_t* co, shard_t* shard, int status) {
+    shard->pid = 0;
+    --co->running;
+    int k = (int)(shard - co->shards);
+    char stats[PATH_MAX];
+    shardPath(co, k, "stats", stats);
+    bool ok = WIFEXITED(status) && WEXITSTATUS(status) == EXIT_SUCCESS;
+    if (WIFSIGNALED(status)) snprintf(shard->why, sizeof(shard->why), "signal %d", WTERMSIG(status));
+    else if (!ok) snprintf(shard->why, sizeof(shard->why), "exit %d", WEXITSTATUS(status));
+    else if (!readShardStats(stats, &shard->counts)) snprintf(shard->why, sizeof(shard->why), "no stats");
+    else if (shard->counts.puzzles != shard->puzzles) {
+        snprintf(shard->why, sizeof(shard->why), "%ld of %ld puzzles", shard->counts.puzzles, shard->puzzles);
+    }
+    else {
+        shard->done = true;
+        shard->elapsed = latencyNow() - shard->started;
+        return;
+    }
+    if (shard->attempts >= SHARD_ATTEMPTS) shard->failed = true;
+    else ++co->retries;
+}
+
+// copies finished shards to stdout while the next one in order is finished
+static void mergeShards(coordinator_t* co) {
+    while (co->merged < co->numShards) {
+        shard_t* shard = &co->shards[co->merged];
+        if (!shard->done && !shard->failed) return;
+        char input[PATH_MAX], output[PATH_MAX], stats[PATH_MAX];
+        shardPath(co, co->merged, "txt", input);
+        shardPath(co, co->merged, "out", output);
+        shardPath(co, co->merged, "stats", stats);
+        FILE* fp = shard->done ? fopen(output, "r") : NULL;
+        if (fp) {
+            char buf[1 << 16];
+            size_t n;
+            while ((n = fread(buf, 1, sizeof(buf), fp)) > 0) fwrite(buf, 1, n, stdout);
+            fclose(fp);
+        }
+        else {
+            printf("Shard %d failed %d times (%s), puzzles %ld to %ld not solved\n", co->merged, shard->attempts,
+                shard->why, shard->first, shard->first + shard->puzzles - 1);
+        }
+        unlink(input);
+        unlink(output);
+        unlink(stats);
+        ++co->merged;
+    }
+}
+
+// starts shards while there are processes to spare, lowest first; with
+// wait, blocks until one finishes. finished shards are merged
+static void pumpShards(coordinator_t* co, bool wait) {
+    for (int k = co->merged; k < co->numShards && co->running < co->config->procs; ++k) {
+        shard_t* shard = &co->shards[k];
+        if (shard->pid == 0 && !shard->done && !shard->failed) startShard(co, k);
+    }
+    int status;
+    pid_t pid;
+    while (co->running > 0 && (pid = waitpid(-1, &status, wait ? 0 : WNOHANG)) > 0) {
+        for (int k = co->merged; k < co->numShards; ++k) {
+            if (co->shards[k].pid != pid) continue;
+            finishShard(co, &co->shards[k], status);
+            break;
+        }
+        wait = false;
+    }
+    mergeShards(co);
+}
+
+// the shard being filled is complete, it can be run
+static void sealShard(coordinator_t* co, long first, long puzzles) {
+    if (co->numShards == co->capacity) {
+        co->capacity *= 2;
+        co->shards = (shard_t*)realloc(co->shards, sizeof(shard_t) * co->capacity);
+    }
+    shard_t* shard = &co->shards[co->numShards++];
+    memset(shard, 0, sizeof(shard_t));
+    shard->first = first;
+    shard->puzzles = puzzles;
+    pumpShards(co, false);
+}
+
+static void printShardStats(coordinator_t* co, long elapsed) {
+    shardCounts_t total;
+    memset(&total, 0, sizeof(shardCounts_t));
+    for (int k = 0; k < co->numShards; ++k) {
+        shardCounts_t* counts = &co->shards[k].counts;
+        if (!co->shards[k].done) continue;
+        total.puzzles += counts->puzzles;
+        for (int i = 0; i < 3; ++i) {
+            total.cache[i] += counts->cache[i];
+            total.store[i] += counts->store[i];
+            total.deadEnds[i] += counts->deadEnds[i];
+        }
+        total.hasCache |= counts->hasCache;
+        total.hasStore |= counts->hasStore;
+        total.hasDeadEnds |= counts->hasDeadEnds;
+    }
+    double seconds = elapsed / 1e9;
+    if (co->config->stats) {
+        printf("Shards: %d of up to %d puzzles on %d processes, %ld puzzles in %.3fs (%.1f/s), %d retried\n",
+            co->numShards, co->config->records, co->config->procs, total.puzzles, seconds,
+            seconds > 0 ? total.puzzles / seconds : 0.0, co->retries);
+        for (int k = 0; k < co->numShards; ++k) {
+            shard_t* shard = &co->shards[k];
+            double took = shard->elapsed / 1e9;
+            printf("  shard %-3d puzzles %ld to %ld, %d %s, ", k, shard->first, shard->first + shard->puzzles - 1,
+                shard->attempts, shard->attempts == 1 ? "attempt" : "attempts");
+            if (shard->done) printf("%.3fs (%.1f/s)\n", took, took > 0 ? shard->puzzles / took : 0.0);
+            else printf("failed (%s)\n", shard->why);
+        }
+    }
+    long lookups = total.cache[0] + total.cache[1];
+    if (total.hasCache) {
+        printf("Cache: %ld hits, %ld misses, %ld evictions over %d shards, hit rate %.1f%%\n", total.cache[0],
+            total.cache[1], total.cache[2], co->numShards, lookups ? 100.0 * total.cache[0] / lookups : 0.0);
+    }
+    lookups = total.store[0] + total.store[1];
+    if (total.hasStore) {
+        printf("Store: %ld hits, %ld misses, %ld added over %d shards, hit rate %.1f%%\n", total.store[0],
+            total.store[1], total.store[2], co->numShards, lookups ? 100.0 * total.store[0] / lookups : 0.0);
+    }
+    lookups = total.deadEnds[1] + total.deadEnds[2];
+    if (total.hasDeadEnds) {
+        printf("Dead ends: %ld stored, %ld hits of %ld lookups (%.1f%%) over %d shards\n", total.deadEnds[0],
+            total.deadEnds[1], lookups, lookups ? 100.0 * total.deadEnds[1] / lookups : 0.0, co->numShards);
+    }
+}
+
+bool runShards(char** files, int numFiles, shardConfig_t* config, dispatcher_t* dispatcher) {
+    long start = latencyNow();
+    coordinator_t co;
+    memset(&co, 0, sizeof(coordinator_t));
+    co.config = config;
+    const char* tmp = getenv("TMPDIR");
+    snprintf(co.dir, sizeof(co.dir), "%s/sudoku-shards-XXXXXX", tmp && tmp[0] ? tmp : "/tmp");
+    if (mkdtemp(co.dir) == NULL) {
+        printf("Could not make a directory for shards in %s\n", tmp && tmp[0] ? tmp : "/tmp");
+        return false;
+    }
+    // the coordinator's options, then -p [-w workers] shard.txt
+    co.argv = (char**)malloc(sizeof(char*) * (config->numArgs + 5));
+    memcpy(co.argv, config->args, sizeof(char*) * config->numArgs);
+    int argc = config->numArgs;
+    char workers[16];
+    co.argv[argc++] = "-p";
+    if (config->workers > 0) {
+        snprintf(workers, sizeof(workers), "%d", config->workers);
+        co.argv[argc++] = "-w";
+        co.argv[argc++] = workers;
+    }
+    co.inputArg = argc++;
+    co.argv[argc] = NULL;
+    co.capacity = 16;
+    co.shards = (shard_t*)malloc(sizeof(shard_t) * co.capacity);
+
+    long seq = 0;
+    long first = 0;
+    FILE* fill = NULL;
+    for (int i = 0; i < numFiles; ++i) {
+        bool isStdin = strcmp(files[i], "-") == 0;
+        FILE* fp = isStdin ? stdin : fopen(files[i], "r");
+        if (fp == NULL) {
+            printf("Could not open file %s\n", files[i]);
+            exit(EXIT_FAILURE);
+        }
+        num_t** grid = NULL;
+        int psize;
+        while ((psize = readSudokuStream(fp, files[i], &grid)) > 0) {
+            if (fill == NULL) {
+                char input[PATH_MAX];
+                shardPath(&co, co.numShards, "txt", input);
+                fill = fopen(input, "w");
+                if (fill == NULL) {
+                    printf("Could not open file %s\n", input);
+                    exit(EXIT_FAILURE);
+                }
+                first = seq;
+            }
+            writeSudokuPuzzle(fill, psize, grid);
+            deleteSudokuPuzzle(psize, grid);
+            ++seq;
+            if (seq - first == config->records) {
+                fclose(fill);
+                fill = NULL;
+                sealShard(&co, first, seq - first);
+            }
+        }
+        if (!isStdin) fclose(fp);
+    }
+    if (fill) {
+        fclose(fill);
+        sealShard(&co, first, seq - first);
+    }
+    while (co.merged < co.numShards) {
+        pumpShards(&co, true);
+    }
+    long elapsed = latencyNow() - start;
+    rmdir(co.dir);
+
+    bool ok = true;
+    for (int k = 0; k < co.numShards; ++k) {
+        ok &= co.shards[k].done;
+        for (int e = 0; co.shards[k].done && e < NUM_ENGINES; ++e) {
+            dispatcher->picks[e] += co.shards[k].counts.picks[e];
+            dispatcher->solved[e] += co.shards[k].counts.solved[e];
+        }
+    }
+    printShardStats(&co, elapsed);
+    free(co.shards);
+    free(co.argv);
+    return ok;
+}
@@ -0,0 +1,313 @@
+/**
+ * @file store.c
+ * @author Hayden Lauritzen (haydenlauritzen@gmail.com)
+ * @date 2023-1-16
+ *
+ * @copyright Copyright (c) 2023
+ *
+ */
+
+#include <fcntl.h>    // open()
+#include <sys/file.h> // flock()
+#include <sys/mman.h> // mmap()
+#include <sys/stat.h> // fstat()
+#include <unistd.h>   // ftruncate()
+
+#include "../inc/store.h"
+
+static storeHeader_t* header(store_t* store) {
+    return (storeHeader_t*)store->map;
+}
+
+static storeSlot_t* slotsOf(store_t* store) {
+    return (storeSlot_t*)(store->map + sizeof(storeHeader_t));
+}
+
+static char* dataOf(store_t* store) {
+    return (char*)(slotsOf(store) + header(store)->slots);
+}
+
+static size_t tableBytes(uint64_t slots) {
+    return sizeof(storeHeader_t) + sizeof(storeSlot_t) * slots;
+}
+
+// bits a cell takes, num - 1 is stored
+static int cellBits(int psize) {
+    int bits = 1;
+    while ((1 << bits) < psize) {
+        ++bits;
+    }
+    return bits;
+}
+
+static size_t packedBytes(int psize) {
+    size_t bytes = ((size_t)psize * psize * cellBits(psize) + 7) / 8;
+    return (bytes + 7) & ~(size_t)7;
+}
+
+static void pack(int psize, num_t** grid, unsigned char* out) {
+    int bits = cellBits(psize);
+    memset(out, 0, packedBytes(psize));
+    size_t bit = 0;
+    for (int row = 1; row <= psize; ++row) {
+        for (int col = 1; col <= psize; ++col) {
+            unsigned value = grid[row][col] - 1;
+            for (int b = 0; b < bits; ++b, ++bit) {
+                if (value >> b & 1) out[bit / 8] |= (unsigned char)(1 << bit % 8);
+            }
+        }
+    }
+}
+
+static int unpackCell(const unsigned char* in, int bits, size_t cell) {
+    int value = 0;
+    size_t bit = cell * bits;
+    for (int b = 0; b < bits; ++b, ++bit) {
+        value |= (in[bit / 8] >> bit % 8 & 1) << b;
+    }
+    return value + 1;
+}
+
+// maps the file again at its current size; call with the lock held alone
+static bool remapStore(store_t* store) {
+    struct stat st;
+    if (fstat(store->fd, &st) != 0) return false;
+    if ((size_t)st.st_size == store->mapped) return true;
+    char* map = (char*)mmap(NULL, st.st_size, PROT_READ | PROT_WRITE, MAP_SHARED, store->fd, 0);
+    if (map == MAP_FAILED) return false;
+    if (store->map) munmap(store->map, store->mapped);
+    store->map = map;
+    store->mapped = st.st_size;
+    return true;
+}
+
+// writes the header of an empty store into a new file
+static bool initStore(int fd, uint64_t slots, uint64_t dataSize) {
+    if (ftruncate(fd, tableBytes(slots) + dataSize) != 0) return false;
+    storeHeader_t head;
+    memset(&head, 0, sizeof(head));
+    memcpy(head.magic, STORE_MAGIC, 8);
+    head.slots = slots;
+    head.dataSize = dataSize;
+    return pwrite(fd, &head, sizeof(head), 0) == (ssize_t)sizeof(head);
+}
+
+store_t* openStore(const char* filename) {
+    int fd = open(filename, O_RDWR | O_CREAT, 0644);
+    if (fd < 0) {
+        printf("Could not open store %s\n", filename);
+        return NULL;
+    }
+    // two runs starting on a new file make it once
+    flock(fd, LOCK_EX);
+    struct stat st;
+    bool ok = fstat(fd, &st) == 0;
+    if (ok && st.st_size == 0) ok = initStore(fd, STORE_SLOTS, STORE_DATA);
+    flock(fd, LOCK_UN);
+    store_t* store = (store_t*)calloc(1, sizeof(store_t));
+    store->fd = fd;
+    ok = ok && remapStore(store) && store->mapped >= sizeof(storeHeader_t)
+        && memcmp(header(store)->magic, STORE_MAGIC, 8) == 0
+        && store->mapped >= tableBytes(header(store)->slots);
+    if (!ok) {
+        printf("%s is not a solution store\n", filename);
+        if (store->map) munmap(store->map, store->mapped);
+        close(fd);
+        free(store);
+        return NULL;
+    }
+    store->filename = strdup(filename);
+    pthread_rwlock_init(&store->lock, NULL);
+    return store;
+}
+
+void closeStore(store_t* store) {
+    munmap(store->map, store->mapped);
+    close(store->fd);
+    pthread_rwlock_destroy(&store->lock);
+    free(store->filename);
+    free(store);
+}
+
+// the slot holding key for this board, or the empty slot it would go in
+static storeSlot_t* findSlot(store_t* store, uint64_t key, int psize, int boxRows) {
+    storeSlot_t* slots = slotsOf(store);
+    uint64_t mask = header(store)->slots - 1;
+    for (uint64_t i = 0; i <= mask; ++i) {
+        storeSlot_t* slot = &slots[(key + i) & mask];
+        uint64_t hash = atomic_load_explicit(&slot->hash, memory_order_acquire);
+        if (hash == 0) return slot;
+        if (hash == key && slot->psize == (uint32_t)psize && slot->boxRows == (uint32_t)boxRows) return slot;
+    }
+    return NULL;
+}
+
+bool storeLookup(store_t* store, unsigned long key, int psize, num_t** grid) {
+    uint64_t hash = key ? key : 1; // 0 marks an empty slot
+    size_t bytes = packedBytes(psize);
+    pthread_rwlock_rdlock(&store->lock);
+    storeSlot_t* slot = findSlot(store, hash, psize, grid[0][0]);
+    bool found = slot && atomic_load_explicit(&slot->hash, memory_order_acquire) != 0;
+    uint64_t offset = found ? slot->offset : 0;
+    if (found && tableBytes(header(store)->slots) + offset + bytes > store->mapped) {
+        // another run grew the file since it was mapped
+        pthread_rwlock_unlock(&store->lock);
+        pthread_rwlock_wrlock(&store->lock);
+        remapStore(store);
+        pthread_rwlock_unlock(&store->lock);
+        pthread_rwlock_rdlock(&store->lock);
+        found = tableBytes(header(store)->slots) + offset + bytes <= store->mapped;
+    }
+    bool hit = false;
+    if (found) {
+        const unsigned char* packed = (const unsigned char*)dataOf(store) + offset;
+        int bits = cellBits(psize);
+        hit = true;
+        for (int cell = 0; cell < psize * psize && hit; ++cell) {
+            int num = unpackCell(packed, bits, cell);
+            int given = grid[cell / psize + 1][cell % psize + 1];
+            hit = num <= psize && (given == 0 || given == num);
+        }
+        for (int cell = 0; cell < psize * psize && hit; ++cell) {
+            grid[cell / psize + 1][cell % psize + 1] = (num_t)unpackCell(packed, bits, cell);
+        }
+        if (!hit) atomic_fetch_add_explicit(&store->mismatches, 1, memory_order_relaxed);
+    }
+    pthread_rwlock_unlock(&store->lock);
+    atomic_fetch_add_explicit(hit ? &store->hits : &store->misses, 1, memory_order_relaxed);
+    return hit;
+}
+
+void storeInsert(store_t* store, unsigned long key, int psize, num_t** solution) {
+    uint64_t hash = key ? key : 1;
+    size_t bytes = packedBytes(psize);
+    pthread_rwlock_wrlock(&store->lock);
+    flock(store->fd, LOCK_EX);
+    // another run may have grown the file or added this puzzle
+    bool ok = remapStore(store);
+    storeHeader_t* head = header(store);
+    storeSlot_t* slot = ok ? findSlot(store, hash, psize, solution[0][0]) : NULL;
+    if (slot && atomic_load_explicit(&slot->hash, memory_order_acquire) == 0) {
+        if ((atomic_load(&head->entries) + 1) * 100 > head->slots * STORE_LOAD_PCT) {
+            atomic_fetch_add_explicit(&store->dropped, 1, memory_order_relaxed);
+            ok = false;
+        }
+        uint64_t used = atomic_load(&head->dataUsed);
+        uint64_t size = atomic_load(&head->dataSize);
+        if (ok && used + bytes > size) {
+            while (used + bytes > size) {
+                size *= 2;
+            }
+            ok = ftruncate(store->fd, tableBytes(head->slots) + size) == 0 && remapStore(store);
+            head = header(store);
+            if (ok) atomic_store(&head->dataSize, size);
+            slot = findSlot(store, hash, psize, solution[0][0]);
+        }
+        if (ok) {
+            pack(psize, solution, (unsigned char*)dataOf(store) + used);
+            atomic_store(&head->dataUsed, used + bytes);
+            slot->offset = used;
+            slot->psize = psize;
+            slot->boxRows = solution[0][0];
+            // the slot is whole before any reader can match it
+            atomic_store_explicit(&slot->hash, hash, memory_order_release);
+            atomic_fetch_add(&head->entries, 1);
+            atomic_fetch_add_explicit(&store->added, 1, memory_order_relaxed);
+        }
+    }
+    flock(store->fd, LOCK_UN);
+    pthread_rwlock_unlock(&store->lock);
+}
+
+bool compactStore(const char* filename) {
+    store_t* store = openStore(filename);
+    if (store == NULL) return false;
+    // writers wait until the new file is in place
+    flock(store->fd, LOCK_EX);
+    remapStore(store);
+    storeHeader_t* head = header(store);
+    storeSlot_t* oldSlots = slotsOf(store);
+    uint64_t live = 0;
+    size_t liveBytes = 0;
+    for (uint64_t i = 0; i < head->slots; ++i) {
+        if (atomic_load(&oldSlots[i].hash) == 0) continue;
+        ++live;
+        liveBytes += packedBytes(oldSlots[i].psize);
+    }
+    uint64_t slots = STORE_SLOTS;
+    while (slots < 2 * live) {
+        slots *= 2;
+    }
+    // a little room, so the next run doesn't grow the file at once
+    uint64_t dataSize = liveBytes + liveBytes / 4 + 8;
+    size_t length = strlen(filename);
+    char* temp = (char*)malloc(length + 5);
+    memcpy(temp, filename, length);
+    memcpy(temp + length, ".tmp", 5);
+    int fd = open(temp, O_RDWR | O_CREAT | O_TRUNC, 0644);
+    bool ok = fd >= 0 && initStore(fd, slots, dataSize);
+    store_t* out = NULL;
+    if (ok) {
+        out = (store_t*)calloc(1, sizeof(store_t));
+        out->fd = fd;
+        ok = remapStore(out);
+    }
+    if (ok) {
+        storeHeader_t* outHead = header(out);
+        storeSlot_t* outSlots = slotsOf(out);
+        uint64_t used = 0;
+        for (uint64_t i = 0; i < head->slots; ++i) {
+            storeSlot_t* from = &oldSlots[i];
+            uint64_t hash = atomic_load(&from->hash);
+            if (hash == 0) continue;
+            size_t bytes = packedBytes(from->psize);
+            storeSlot_t* to = &outSlots[hash & (slots - 1)];
+            while (atomic_load(&to->hash) != 0) {
+                to = &outSlots[(to - outSlots + 1) & (slots - 1)];
+            }
+            memcpy(dataOf(out) + used, dataOf(store) + from->offset, bytes);
+            to->offset = used;
+            to->psize = from->psize;
+            to->boxRows = from->boxRows;
+            atomic_store(&to->hash, hash);
+            used += bytes;
+        }
+        atomic_store(&outHead->entries, live);
+        atomic_store(&outHead->dataUsed, used);
+        ok = msync(out->map, out->mapped, MS_SYNC) == 0 && rename(temp, filename) == 0;
+    }
+    if (ok) {
+        printf("Compacted %s: %lu entries, %lu to %lu slots, %lu to %lu data bytes\n", filename,
+            (unsigned long)live, (unsigned long)head->slots, (unsigned long)slots,
+            (unsigned long)atomic_load(&head->dataUsed), (unsigned long)liveBytes);
+    }
+    else {
+        printf("Could not compact %s\n", filename);
+        remove(temp);
+    }
+    if (out) {
+        if (out->map) munmap(out->map, out->mapped);
+        free(out);
+    }
+    if (fd >= 0) close(fd);
+    free(temp);
+    flock(store->fd, LOCK_UN);
+    closeStore(store);
+    return ok;
+}
+
+void printStoreStats(store_t* store) {
+    long hits = atomic_load(&store->hits);
+    long lookups = hits + atomic_load(&store->misses);
+    pthread_rwlock_rdlock(&store->lock);
+    uint64_t entries = atomic_load(&header(store)->entries);
+    uint64_t slots = header(store)->slots;
+    pthread_rwlock_unlock(&store->lock);
+    printf("Store: %ld hits, %ld misses, %ld added, %lu/%lu slots, hit rate %.1f%%\n", hits, lookups - hits,
+        atomic_load(&store->added), (unsigned long)entries, (unsigned long)slots,
+        lookups ? 100.0 * hits / lookups : 0.0);
+    long dropped = atomic_load(&store->dropped);
+    long mismatches = atomic_load(&store->mismatches);
+    if (dropped) printf("Store: %ld solutions dropped, the table is full; compact it with -x\n", dropped);
+    if (mismatches) printf("Store: %ld hashes matched another puzzle\n", mismatches);
+}
@@ -7,15 +7,103 @@
  *
  */
 
+#include <unistd.h> // sysconf()
+
 #include "../inc/sudoku.h"
+#include "../inc/bitboard.h"
+#include "../inc/deadend.h"
+#include "../inc/place.h"
+#include "../inc/shape.h"
+
+// every stride'th arg starting at first
+typedef struct taskRange_t {
+    void* (*task)(void*);
+    char* args;
+    size_t argSize;
+    int count;
+    int first;
+    int stride;
+    int parentTid; // trace row of the thread that called runTasks
+    int node;      // node the caller is pinned to, -1 if it isn't
+} taskRange_t;
+
+size_t solveArenaSize(int psize) {
+    // one search node: saved position, legal moves and their scratch
+    size_t node = sizeof(savedPos_t) + sizeof(num_t) * (psize + 1) * (psize + 1)
+        + sizeof(missing_t) * psize + sizeof(int) * (psize + 1) + sizeof(bool) * (psize + 1)
+        + sizeof(smallestSolve_t) + sizeof(cell_t) + 6 * 16;
+    // and the bitboard before the guess, plus the search's own
+    size_t board = psize == BITBOARD_PSIZE ? sizeof(bitboard_t) + 16 : 0;
+    node += board;
+    // checkPuzzle after each guess, or one round of easy solves and its
+    // marks of the numbers placed
+    size_t unit = sizeof(checkpuzzle_t) > sizeof(solvepuzzle_t) ? sizeof(checkpuzzle_t) : sizeof(solvepuzzle_t);
+    size_t scratch = 3 * psize * (unit + sizeof(bool) * (psize + 1) + 16)
+        + 3 * psize * (sizeof(pthread_t) + sizeof(taskRange_t)) + sizeof(missing_t) * psize
+        + sizeof(bool) * 3 * (psize + 1) * (psize + 1) + 5 * 16;
+    // every guess fills at least one empty cell
+    size_t frame = sizeof(searchFrame_t) + sizeof(search_t) + 16;
+    return (node + frame) * psize * psize + scratch + board;
+}
+
+// 0 until first asked for
+static int workerCount = 0;
+
+int getWorkerCount(void) {
+    if (workerCount <= 0) {
+        long cpus = sysconf(_SC_NPROCESSORS_ONLN);
+        workerCount = cpus > 0 ? (int)cpus : 1;
+    }
+    return workerCount;
+}
+
+void setWorkerCount(int count) {
+    workerCount = count;
+}
 
-int getGridIdx(int row, int col, int psize) {
-    int gridSize = (int)floor(sqrt(psize));
-    return (((row - 1) / gridSize) * gridSize) + ((col - 1) / gridSize) + 1;
+static void* runRange(void* args) {
+    taskRange_t* range = (taskRange_t*)args;
+    // the first range runs on the calling thread and keeps its row
+    if (range->first > 0) TRACE_THREAD(range->parentTid * TRACE_FANOUT + range->first, "task");
+    // helpers stay on the caller's node, where its boards are
+    if (range->first > 0 && range->node >= 0) pinToNode(range->node);
+    TRACE_BEGIN(span);
+    for (int i = range->first; i < range->count; i += range->stride) {
+        range->task(range->args + i * range->argSize);
+    }
+    TRACE_END(span, "tasks");
+    return NULL;
 }
 
-smallestSolve_t* getSmallestSolve(missing_t* missingNums, int psize) {
-    smallestSolve_t* ret = (smallestSolve_t*)malloc(sizeof(smallestSolve_t));
+void runTasks(void* (*task)(void*), void* args, size_t argSize, int count, arena_t* arena) {
+    int threads = getWorkerCount();
+    if (threads > count) threads = count;
+    if (threads <= 1) {
+        taskRange_t range = { task, (char*)args, argSize, count, 0, 1, 0, -1 };
+        runRange(&range);
+        return;
+    }
+    arenaMark_t mark = arenaMark(arena);
+    pthread_t* ids = (pthread_t*)arenaAlloc(arena, sizeof(pthread_t) * threads);
+    taskRange_t* ranges = (taskRange_t*)arenaAlloc(arena, sizeof(taskRange_t) * threads);
+    for (int t = 0; t < threads; ++t) {
+        ranges[t] = (taskRange_t){ task, (char*)args, argSize, count, t, threads, TRACE_TID(), currentNode() };
+        if (t > 0) pthread_create(&ids[t], NULL, runRange, &ranges[t]);
+    }
+    // this thread takes the first range
+    runRange(&ranges[0]);
+    for (int t = 1; t < threads; ++t) {
+        pthread_join(ids[t], NULL);
+    }
+    arenaRelease(arena, mark);
+}
+
+int getGridIdx(int row, int col, const shape_t* shape) {
+    return shape->boxOf[(row - 1) * shape->psize + col - 1] + 1;
+}
+
+smallestSolve_t* getSmallestSolve(missing_t* missingNums, int psize, arena_t* arena) {
+    smallestSolve_t* ret = (smallestSolve_t*)arenaAlloc(arena, sizeof(smallestSolve_t));
     int smallest = __INT32_MAX__;
     for (int i = 0; i < psize; ++i) {
         if (missingNums[i].rows > 1 && missingNums[i].rows < smallest) {
@@ -54,125 +142,166 @@ bool isComplete(missing_t* missingNums, int psize) {
     return true;
 }
 
-void makeMove(missing_t* missingNums, int row, int col, int grids, int** grid, int num) {
+uint64_t makeMove(missing_t* missingNums, int row, int col, int grids, num_t** grid, int num) {
     grid[row][col] = num;
     --(missingNums[row - 1].rows);
     --(missingNums[col - 1].cols);
     --(missingNums[grids - 1].grids);
+    return zobristKey(row, col, num);
+}
+
+uint64_t placeMove(missing_t* missingNums, bitboard_t* board, int row, int col, int grids, num_t** grid, int num) {
+    if (board) bitboardPlace(board, row, col, num);
+    return makeMove(missingNums, row, col, grids, grid, num);
 }
 
-void undoMove(savedPos_t* saved, int** grid, missing_t* missingNums, int psize) {
+void undoMove(savedPos_t* saved, num_t** grid, missing_t* missingNums, int psize) {
     memcpy(missingNums, saved->missing, sizeof(missing_t) * (psize));
     for (int i = 1; i <= psize; ++i) {
-        memcpy(grid[i], saved->grid[i], sizeof(int) * (psize + 1));
-    }
-    // free savedPos
-    for (int i = 1; i <= psize; ++i) {
-        free(saved->grid[i]);
+        memcpy(grid[i], saved->grid + i * (psize + 1), sizeof(num_t) * (psize + 1));
     }
-    free(saved->missing);
-    free(saved);
 }
 
-savedPos_t* savePos(int** grid, missing_t* missingNums, int psize) {
-    // alloc
-    savedPos_t* saved = (savedPos_t*)malloc(sizeof(savedPos_t));
-    saved->grid = (int**)calloc(psize + 1, sizeof(int*));
-    for (int i = 1; i <= psize; ++i) {
-        saved->grid[i] = (int*)calloc((psize + 1), sizeof(int));
-    }
+savedPos_t* savePos(num_t** grid, missing_t* missingNums, int psize, arena_t* arena) {
+    // alloc; rows are stored back to back
+    savedPos_t* saved = (savedPos_t*)arenaAlloc(arena, sizeof(savedPos_t));
+    saved->grid = (num_t*)arenaAlloc(arena, sizeof(num_t) * (psize + 1) * (psize + 1));
+    saved->missing = (missing_t*)arenaAlloc(arena, sizeof(missing_t) * psize);
     // copy
-    saved->missing = (missing_t*)calloc(psize, sizeof(missing_t));
     memcpy(saved->missing, missingNums, sizeof(missing_t) * (psize));
     for (int i = 1; i <= psize; ++i) {
-        memcpy(saved->grid[i], grid[i], sizeof(int) * (psize + 1));
+        memcpy(saved->grid + i * (psize + 1), grid[i], sizeof(num_t) * (psize + 1));
     }
     return saved;
 }
 
+unsigned nextRandom(unsigned* state) {
+    unsigned x = *state;
+    x ^= x << 13;
+    x ^= x >> 17;
+    x ^= x << 5;
+    return *state = x;
+}
+
+uint64_t zobristKey(int row, int col, int num) {
+    // splitmix64 finalizer, every input bit reaches every output bit
+    uint64_t x = ((uint64_t)row << 16 | (uint64_t)col << 8 | (uint64_t)num) + 0x9e3779b97f4a7c15u;
+    x = (x ^ (x >> 30)) * 0xbf58476d1ce4e5b9u;
+    x = (x ^ (x >> 27)) * 0x94d049bb133111ebu;
+    return x ^ (x >> 31);
+}
+
+uint64_t zobristBoard(int psize, num_t** grid) {
+    // row 0 is never a cell, so it can stand for the size and box shape
+    uint64_t hash = zobristKey(0, grid[0][0], psize);
+    for (int row = 1; row <= psize; ++row) {
+        for (int col = 1; col <= psize; ++col) {
+            if (grid[row][col]) hash ^= zobristKey(row, col, grid[row][col]);
+        }
+    }
+    return hash;
+}
+
+// true if num is in none of the cell's row, column and box
+static bool fitsCell(num_t** grid, const shape_t* shape, int row, int col, int num) {
+    int psize = shape->psize;
+    for (int i = 1; i <= psize; ++i) {
+        if (grid[row][i] == num || grid[i][col] == num) return false;
+    }
+    cell_t* box = shape->cells + shape->boxOf[(row - 1) * psize + col - 1] * psize;
+    for (int i = 0; i < psize; ++i) {
+        if (grid[box[i].row + 1][box[i].col + 1] == num) return false;
+    }
+    return true;
+}
+
+// the number numCount is missing, checked against the empty cell's units
+static void forceNum(solvepuzzle_t* params) {
+    bool* numCount = params->numCount;
+    params->num = 0;
+    for (int i = 1; i <= params->psize; ++i) {
+        if (numCount[i]) continue;
+        // a unit with one empty cell and two numbers missing has a repeat
+        if (params->num) {
+            params->num = 0;
+            return;
+        }
+        params->num = i;
+    }
+    if (params->num && !fitsCell(params->grid, params->shape, params->cell.row, params->cell.col, params->num)) {
+        params->num = 0;
+    }
+}
 
 void* solveRow(void* args) {
     solvepuzzle_t* params = (solvepuzzle_t*)args;
-    bool* numCount = (bool*)calloc(params->psize + 1, sizeof(bool)); // keep track of used nums
-    int numIdx, missingNum;
+    bool* numCount = params->numCount; // keep track of used nums
     int row = params->idx;
     for (int col = 1; col <= params->psize; ++col) {
         int num = params->grid[row][col];
         if (num == 0) {
             // location of missing number
-            numIdx = col;
+            params->cell = (cell_t){ row, col };
         }
         else {
             // first occurance of number
             numCount[num] = true;
         }
     }
-    for (int i = 1; i <= params->psize; ++i) {
-        if (!numCount[i]) missingNum = i;
-    }
-    // make move
-    makeMove(params->missingNums, row, numIdx, getGridIdx(row, numIdx, params->psize), params->grid, missingNum);
-    free(numCount);
+    forceNum(params);
     return NULL;
 }
 
 void* solveCol(void* args) {
     solvepuzzle_t* params = (solvepuzzle_t*)args;
-    bool* numCount = (bool*)calloc(params->psize + 1, sizeof(bool)); // keep track of used nums
-    int numIdx, missingNum;
+    bool* numCount = params->numCount; // keep track of used nums
     int col = params->idx;
     for (int row = 1; row <= params->psize; ++row) {
         int num = params->grid[row][col];
         if (num == 0) {
             // location of missing number
-            numIdx = row;
+            params->cell = (cell_t){ row, col };
         }
         else {
             // first occurance of number
             numCount[num] = true;
         }
     }
-    for (int i = 1; i <= params->psize; ++i) {
-        if (!numCount[i]) missingNum = i;
-    }
-    makeMove(params->missingNums, numIdx, col, getGridIdx(numIdx, col, params->psize), params->grid, missingNum);
-    free(numCount);
+    forceNum(params);
     return NULL;
 }
 void* solveGrid(void* args) {
     solvepuzzle_t* params = (solvepuzzle_t*)args;
-    bool* numCount = (bool*)calloc(params->psize + 1, sizeof(bool)); // keep track of used nums
-    int rowIdx, colIdx, missingNum;
-    int grid = params->idx;
-    int gridSize = (int)floor(sqrt(params->psize));
-    for (int i = 0; i < gridSize; ++i) {
-        // converts grid idx to grid inital row idx
-        int row = (((params->idx - 1) / gridSize) * gridSize + 1) + i;
-        for (int j = 0; j < gridSize; ++j) {
-            // converts grid idx to grid inital col idx
-            int col = (((params->idx - 1) % gridSize) * gridSize + 1) + j;
-            int num = params->grid[row][col];
-            if (num == 0) {
-                // puzzle is not complete, but might be valid
-                rowIdx = row;
-                colIdx = col;
-            }
-            else {
-                // first occurance of number
-                numCount[num] = true;
-            }
+    bool* numCount = params->numCount; // keep track of used nums
+    // the box's cells, from its shape's table
+    cell_t* box = params->shape->cells + (params->idx - 1) * params->psize;
+    for (int i = 0; i < params->psize; ++i) {
+        int row = box[i].row + 1;
+        int col = box[i].col + 1;
+        int num = params->grid[row][col];
+        if (num == 0) {
+            // puzzle is not complete, but might be valid
+            params->cell = (cell_t){ row, col };
+        }
+        else {
+            // first occurance of number
+            numCount[num] = true;
         }
     }
-    for (int i = 1; i <= params->psize; ++i) {
-        if (!numCount[i]) missingNum = i;
-    }
-    makeMove(params->missingNums, rowIdx, colIdx, grid, params->grid, missingNum);
-    free(numCount);
+    forceNum(params);
     return NULL;
 }
 
-cell_t* selectCell(smallestSolve_t* subset, int psize, int** grid) {
-    cell_t* cell = (cell_t*)malloc(sizeof(cell_t));
+void* solveUnit(void* args) {
+    switch (((solvepuzzle_t*)args)->type) {
+    case rows: return solveRow(args);
+    case cols: return solveCol(args);
+    default: return solveGrid(args);
+    }
+}
+
+cell_t* selectCell(smallestSolve_t* subset, int psize, num_t** grid, arena_t* arena) {
+    cell_t* cell = (cell_t*)arenaAlloc(arena, sizeof(cell_t));
     switch (subset->type) {
     case rows: {
         int row = subset->idx;
@@ -195,19 +324,11 @@ cell_t* selectCell(smallestSolve_t* subset, int psize, int** grid) {
         break;
     }
     case grids: {
-        int grids = subset->idx;
-        int gridSize = (int)floor(sqrt(psize));
-        for (int i = 0; i < gridSize; ++i) {
-            // converts grid idx to grid inital row idx
-            int row = (((grids - 1) / gridSize) * gridSize + 1) + i;
-            for (int j = 0; j < gridSize; ++j) {
-                // converts grid idx to grid inital col idx
-                int col = (((grids - 1) % gridSize) * gridSize + 1) + j;
-                int num = grid[row][col];
-                if (num == 0) {
-                    cell->row = row;
-                    cell->row = col;
-                }
+        cell_t* box = getShape(psize, grid)->cells + (subset->idx - 1) * psize;
+        for (int i = 0; i < psize; ++i) {
+            if (grid[box[i].row + 1][box[i].col + 1] == 0) {
+                cell->row = box[i].row + 1;
+                cell->col = box[i].col + 1;
             }
         }
         break;
@@ -216,9 +337,9 @@ cell_t* selectCell(smallestSolve_t* subset, int psize, int** grid) {
     return cell;
 }
 
-int* solveCell(int row_n, int col_n, int grid_n, int psize, int** grid) {
-    bool* numCount = (bool*)calloc(psize + 1, sizeof(bool)); // keep track of used nums
-    int* validNums = (int*)calloc(psize, sizeof(bool)); // keep track of used nums
+int* solveCell(int row_n, int col_n, int grid_n, int psize, num_t** grid, arena_t* arena) {
+    bool* numCount = (bool*)arenaAlloc(arena, sizeof(bool) * (psize + 1)); // keep track of used nums
+    int* validNums = (int*)arenaAlloc(arena, sizeof(int) * (psize + 1)); // zero terminated list of legal nums
     // check row and col
     for (int i = 1; i <= psize; ++i) {
         int rowNum = grid[row_n][i];
@@ -227,16 +348,10 @@ int* solveCell(int row_n, int col_n, int grid_n, int psize, int** grid) {
         if (!numCount[colNum]) numCount[colNum] = true;
     }
     // check grid
-    int gridSize = (int)floor(sqrt(psize));
-    for (int i = 0; i < gridSize; ++i) {
-        // converts grid idx to grid inital row idx
-        int row = (((grid_n - 1) / gridSize) * gridSize + 1) + i;
-        for (int j = 0; j < gridSize; ++j) {
-            // converts grid idx to grid inital col idx
-            int col = (((grid_n - 1) % gridSize) * gridSize + 1) + j;
-            int gridNum = grid[row][col];
-            if (!numCount[gridNum]) numCount[gridNum] = true;
-        }
+    cell_t* box = getShape(psize, grid)->cells + (grid_n - 1) * psize;
+    for (int i = 0; i < psize; ++i) {
+        int gridNum = grid[box[i].row + 1][box[i].col + 1];
+        if (!numCount[gridNum]) numCount[gridNum] = true;
     }
     int j = 0;
     for (int i = 1; i <= psize; ++i) {
@@ -246,123 +361,254 @@ int* solveCell(int row_n, int col_n, int grid_n, int psize, int** grid) {
         }
     }
     validNums[j] = 0;
-    free(numCount);
     return validNums;
 }
 
-void solvePuzzle(missing_t* missingNums, int psize, int** grid) {
-    // make all possible easy solves
-    while (isSolvable(missingNums, psize)) {
-        bool* working = (bool*)calloc(psize, sizeof(bool));
-        pthread_t solveThreads[psize];
-        solvepuzzle_t args[psize];
-        // spawn row threads
-        for (int i = 0; i < psize; ++i) {
-            if (missingNums[i].rows == 1) { // there is a easy solve here
-                args[i].idx = i + 1;
-                args[i].psize = psize;
-                args[i].grid = grid;
-                args[i].missingNums = missingNums;
-                working[i] = true;
-                pthread_create(&solveThreads[i], NULL, solveRow, &args[i]);
+// makes the moves found on one board; false if two of them clash or one
+// was forced to a number that can't go in its cell
+// placed marks [unit type][unit][num] taken this round, and is left clear
+static bool commitMoves(solvepuzzle_t* moves, int count, missing_t* missingNums, const shape_t* shape,
+    num_t** grid, bool* placed, uint64_t* hash) {
+    int stride = shape->psize + 1;
+    bool* inRow = placed;
+    bool* inCol = placed + stride * stride;
+    bool* inBox = placed + 2 * stride * stride;
+    bool ok = true;
+    for (int i = 0; i < count && ok; ++i) {
+        int row = moves[i].cell.row, col = moves[i].cell.col, num = moves[i].num;
+        // a row and a column or box can both be down to the same cell
+        if (num && grid[row][col] == num) continue;
+        int box = getGridIdx(row, col, shape);
+        ok = num && !grid[row][col] && !inRow[row * stride + num] && !inCol[col * stride + num]
+            && !inBox[box * stride + num];
+        if (!ok) break;
+        inRow[row * stride + num] = inCol[col * stride + num] = inBox[box * stride + num] = true;
+        *hash ^= placeMove(missingNums, NULL, row, col, box, grid, num);
+    }
+    for (int i = 0; i < count; ++i) {
+        int row = moves[i].cell.row, col = moves[i].cell.col, num = moves[i].num;
+        int box = getGridIdx(row, col, shape);
+        inRow[row * stride + num] = inCol[col * stride + num] = inBox[box * stride + num] = false;
+    }
+    return ok;
+}
+
+// fills every unit with one number missing until none are left, xoring
+// each move into hash; false if the board turned out to have no solution
+// each round finds the moves of every such unit in parallel from the
+// same board, then makes them all on this thread, so tasks never write
+// the board or the missing counts another task reads
+static bool solveEasy(missing_t* missingNums, int psize, num_t** grid, uint64_t* hash, arena_t* arena) {
+    arenaMark_t mark = arenaMark(arena);
+    bool* placed = (bool*)arenaAlloc(arena, sizeof(bool) * 3 * (psize + 1) * (psize + 1));
+    const shape_t* shape = getShape(psize, grid);
+    bool ok = true;
+    while (ok && isSolvable(missingNums, psize)) {
+        TRACE_BEGIN(span);
+        arenaMark_t roundMark = arenaMark(arena);
+        solvepuzzle_t* args = (solvepuzzle_t*)arenaAlloc(arena, sizeof(solvepuzzle_t) * 3 * psize);
+        int count = 0;
+        for (enum subset type = rows; type <= grids; ++type) {
+            for (int i = 0; i < psize; ++i) {
+                int left = type == rows ? missingNums[i].rows
+                    : type == cols ? missingNums[i].cols : missingNums[i].grids;
+                if (left == 1) { // there is a easy solve here
+                    args[count].type = type;
+                    args[count].idx = i + 1;
+                    args[count].psize = psize;
+                    args[count].shape = shape;
+                    args[count].grid = grid;
+                    args[count].numCount = (bool*)arenaAlloc(arena, sizeof(bool) * (psize + 1));
+                    ++count;
+                }
             }
         }
+        runTasks(solveUnit, args, sizeof(solvepuzzle_t), count, arena);
+        ok = commitMoves(args, count, missingNums, shape, grid, placed, hash);
+        arenaRelease(arena, roundMark);
+        TRACE_END(span, "sweep round");
+    }
+    arenaRelease(arena, mark);
+    return ok;
+}
 
-        // join row threads
-        for (int i = 0; i < psize; ++i) {
-            if (working[i]) {
-                pthread_join(solveThreads[i], NULL);
-                working[i] = false;
-            }
+// solveEasy for a board with a bitboard: hidden and naked singles and
+// locked candidates rather than only units down to one empty cell, each
+// a few 128-bit ANDs instead of a scan of the unit
+static bool solveBitboard(missing_t* missingNums, num_t** grid, bitboard_t* board, uint64_t* hash) {
+    bitMove_t moves[BITBOARD_CELLS];
+    const shape_t* shape = findShape(BITBOARD_PSIZE, 0);
+    int count;
+    bool ok = true;
+    while (ok && (count = bitboardDeduce(board, moves)) != 0) {
+        TRACE_BEGIN(span);
+        ok = count > 0;
+        for (int i = 0; i < count && ok; ++i) {
+            bitMove_t* move = &moves[i];
+            // a move made this round can take the place of a later one
+            ok = bitboardFits(board, move->row, move->col, move->num);
+            if (!ok) break;
+            int box = getGridIdx(move->row, move->col, shape);
+            *hash ^= placeMove(missingNums, board, move->row, move->col, box, grid, move->num);
+        }
+        TRACE_END(span, "bitboard round");
+    }
+    return ok;
+}
 
+// pushes a guess on the smallest unit left
+static void pushFrame(search_t* search) {
+    arena_t* arena = search->arena;
+    int psize = search->psize;
+    searchFrame_t* frame = &search->frames[search->depth++];
+    frame->mark = arenaMark(arena);
+    smallestSolve_t* subset = getSmallestSolve(search->missingNums, psize, arena);
+    // select a cell in the smallset subset to guess
+    frame->cell = *selectCell(subset, psize, search->grid, arena);
+    frame->gridIdx = getGridIdx(frame->cell.row, frame->cell.col, search->shape);
+    frame->moves = solveCell(frame->cell.row, frame->cell.col, frame->gridIdx, psize, search->grid, arena);
+    if (search->seed) {
+        int count = 0;
+        while (frame->moves[count]) {
+            ++count;
         }
-        // spawn col threads
-        for (int i = 0; i < psize; ++i) {
-            if (missingNums[i].cols == 1) { // there is a easy solve here
-                args[i].idx = i + 1;
-                args[i].psize = psize;
-                args[i].grid = grid;
-                args[i].missingNums = missingNums;
-                working[i] = true;
-                pthread_create(&solveThreads[i], NULL, solveCol, &args[i]);
-            }
+        for (int i = count - 1; i > 0; --i) {
+            int j = nextRandom(&search->seed) % (i + 1);
+            int move = frame->moves[i];
+            frame->moves[i] = frame->moves[j];
+            frame->moves[j] = move;
         }
-        // join col threads
-        for (int i = 0; i < psize; ++i) {
-            if (working[i]) {
-                pthread_join(solveThreads[i], NULL);
-                working[i] = false;
-            }
+    }
+    frame->next = 0;
+    frame->saved = savePos(search->grid, search->missingNums, psize, arena);
+    frame->board = NULL;
+    if (search->board) {
+        frame->board = (bitboard_t*)arenaAlloc(arena, sizeof(bitboard_t));
+        *frame->board = *search->board;
+    }
+    frame->hash = search->hash;
+    frame->guesses = search->guesses;
+    if (search->depth > search->maxDepth) search->maxDepth = search->depth;
+}
+
+// true if the board is filled in and valid
+static bool isSolved(search_t* search) {
+    bool complete;
+    bool valid;
+    arenaMark_t mark = arenaMark(search->arena);
+    checkPuzzle(search->psize, search->grid, &complete, &valid, search->arena);
+    arenaRelease(search->arena, mark);
+    return complete && valid;
+}
+
+search_t* createSearch(missing_t* missingNums, int psize, num_t** grid, arena_t* arena) {
+    search_t* search = (search_t*)arenaAlloc(arena, sizeof(search_t));
+    search->psize = psize;
+    search->shape = getShape(psize, grid);
+    search->grid = grid;
+    search->missingNums = missingNums;
+    search->arena = arena;
+    // every guess fills at least one empty cell
+    search->frames = (searchFrame_t*)arenaAlloc(arena, sizeof(searchFrame_t) * (psize * psize + 1));
+    search->hash = zobristBoard(psize, grid);
+    // the bitboard's units are 3x3 boxes
+    if (psize == BITBOARD_PSIZE && search->shape->boxRows == search->shape->boxCols) {
+        search->board = (bitboard_t*)arenaAlloc(arena, sizeof(bitboard_t));
+        // givens that clash are left to the scan to find
+        if (!loadBitboard(search->board, grid)) search->board = NULL;
+    }
+    search->status = SEARCH_START;
+    return search;
+}
+
+searchStatus_e stepSearch(search_t* search, long maxMoves) {
+    if (search->status == SEARCH_START) {
+        // make all possible easy solves
+        bool live = search->board ? solveBitboard(search->missingNums, search->grid, search->board, &search->hash)
+            : solveEasy(search->missingNums, search->psize, search->grid, &search->hash, search->arena);
+        if (!live) {
+            search->status = SEARCH_FAILED;
+            return search->status;
         }
-        // spawn grid threads
-        for (int i = 0; i < psize; ++i) {
-            if (missingNums[i].grids == 1) { // there is a easy solve here
-                args[i].idx = i + 1;
-                args[i].psize = psize;
-                args[i].grid = grid;
-                args[i].missingNums = missingNums;
-                working[i] = true;
-                pthread_create(&solveThreads[i], NULL, solveGrid, &args[i]);
-            }
+        if (isComplete(search->missingNums, search->psize)) {
+            search->status = isSolved(search) ? SEARCH_SOLVED : SEARCH_FAILED;
+            return search->status;
         }
-        // join grid threads
-        for (int i = 0; i < psize; ++i) {
-            if (working[i]) {
-                pthread_join(solveThreads[i], NULL);
-                working[i] = false;
-            }
+        if (search->deadEnds && isDeadEnd(search->deadEnds, search->hash)) {
+            search->status = SEARCH_FAILED;
+            return search->status;
         }
-        free(working);
-    }
-
-    // no more easy solves left, check if complete
-    if (!isComplete(missingNums, psize)) {
-        // puzzle is not complete, find smallest start location
-        smallestSolve_t* subset = getSmallestSolve(missingNums, psize);
-        // select a cell in the smallset subset to guess
-        cell_t* cell = selectCell(subset, psize, grid);
-        // get legal moves
-        int gridIdx = getGridIdx(cell->row, cell->col, psize);
-        int* moves = solveCell(cell->row, cell->col, gridIdx, psize, grid);
-        int i = 0;
-        bool solved = false;
-        while (moves[i] != 0) {
-            // make move; this will decrease the smallest subset's missing numbers
-            savedPos_t* savedPos = savePos(grid, missingNums, psize);
-            makeMove(missingNums, cell->row, cell->col, gridIdx, grid, moves[i]);
-
-            // increase depth, returns when no moves left; i.e. puzzle complete
-            solvePuzzle(missingNums, psize, grid);
-
-            // check if puzzle is complete and/or valid
-            bool complete;
-            bool valid;
-            checkPuzzle(psize, grid, &complete, &valid);
-            if (complete && valid) {
-                for (int j = 0; j <= psize; ++j) {
-                    free(savedPos->grid[j]);
-                }
-                free(savedPos->missing);
-                free(savedPos);
-                solved = true;
-                break; // puzzle is complete
+        pushFrame(search);
+        search->status = SEARCH_RUNNING;
+    }
+    long moves = 0;
+    while (search->status == SEARCH_RUNNING) {
+        if (search->depth == 0) {
+            search->status = SEARCH_FAILED;
+            break;
+        }
+        if (maxMoves > 0 && moves >= maxMoves) break;
+        searchFrame_t* frame = &search->frames[search->depth - 1];
+        // undo the last guess here if it was illegal
+        if (frame->next > 0) {
+            TRACE_BEGIN(undo);
+            undoMove(frame->saved, search->grid, search->missingNums, search->psize);
+            search->hash = frame->hash;
+            // frames read back from a checkpoint have no bitboard saved
+            if (search->board && frame->board) *search->board = *frame->board;
+            else if (search->board) loadBitboard(search->board, search->grid);
+            TRACE_END(undo, "undo");
+        }
+        int move = frame->moves[frame->next];
+        if (move == 0) {
+            // no moves left, the guess below this one was wrong
+            if (search->deadEnds && search->guesses - frame->guesses >= DEADEND_MIN_GUESSES) {
+                addDeadEnd(search->deadEnds, frame->hash);
             }
-
-            // undo move if puzzle was illegal
-            undoMove(savedPos, grid, missingNums, psize);
-            ++i;
+            arenaRelease(search->arena, frame->mark);
+            --(search->depth);
+            continue;
+        }
+        ++(frame->next);
+        // locked candidates can rule out a number the units still allow
+        if (search->board && !bitboardFits(search->board, frame->cell.row, frame->cell.col, move)) continue;
+        ++moves;
+        ++(search->guesses);
+        // make move; this will decrease the smallest subset's missing numbers
+        TRACE_BEGIN(guess);
+        search->hash ^= placeMove(search->missingNums, search->board, frame->cell.row, frame->cell.col,
+            frame->gridIdx, search->grid, move);
+        bool live = search->board ? solveBitboard(search->missingNums, search->grid, search->board, &search->hash)
+            : solveEasy(search->missingNums, search->psize, search->grid, &search->hash, search->arena);
+        TRACE_END(guess, "guess");
+        // the easy solves ran into a clash, undone like a wrong guess
+        if (!live) continue;
+        if (!isComplete(search->missingNums, search->psize)) {
+            // a board already searched out is undone like a wrong guess
+            if (search->deadEnds && isDeadEnd(search->deadEnds, search->hash)) continue;
+            pushFrame(search);
+        }
+        else if (isSolved(search)) {
+            search->status = SEARCH_SOLVED;
         }
-        if(!solved) printf("Could not find a solution :(\nThis is as far as I got:\n");
-        free(subset);
-        free(cell);
-        free(moves);
     }
+    return search->status;
+}
+
+bool solvePuzzle(missing_t* missingNums, int psize, num_t** grid, deadEnds_t* deadEnds, arena_t* arena) {
+    // everything the search allocates is released on return
+    arenaMark_t mark = arenaMark(arena);
+    search_t* search = createSearch(missingNums, psize, grid, arena);
+    search->deadEnds = deadEnds;
+    bool solved = stepSearch(search, 0) == SEARCH_SOLVED;
+    arenaRelease(arena, mark);
+    return solved;
 }
 
 void* checkRow(void* args) {
     checkpuzzle_t* params = (checkpuzzle_t*)args;
     // keep track of used nums
-    bool* numCount = (bool*)calloc(params->psize + 1, sizeof(bool));
+    bool* numCount = params->numCount;
     for (int col = 1; col <= params->psize; ++col) {
         int num = params->grid[params->idx][col];
         if (num == 0) {
@@ -381,12 +627,11 @@ void* checkRow(void* args) {
             numCount[num] = true;
         }
     }
-    free(numCount);
     return NULL;
 };
 void* checkCol(void* args) {
     checkpuzzle_t* params = (checkpuzzle_t*)args;
-    bool* numCount = (bool*)calloc(params->psize + 1, sizeof(bool)); // keep track of used nums
+    bool* numCount = params->numCount; // keep track of used nums
     for (int row = 1; row <= params->psize; ++row) {
         int num = params->grid[row][params->idx];
         if (num == 0) {
@@ -409,159 +654,171 @@ void* checkCol(void* args) {
 };
 void* checkGrid(void* args) {
     checkpuzzle_t* params = (checkpuzzle_t*)args;
-    bool* numCount = (bool*)calloc(params->psize + 1, sizeof(bool)); // keep track of used nums
-    int gridSize = (int)floor(sqrt(params->psize));
-    for (int i = 0; i < gridSize; ++i) {
-        // converts grid idx to grid inital row idx
-        int row = (((params->idx - 1) / gridSize) * gridSize + 1) + i;
-        for (int j = 0; j < gridSize; ++j) {
-            // converts grid idx to grid inital col idx
-            int col = (((params->idx - 1) % gridSize) * gridSize + 1) + j;
-            int num = params->grid[row][col];
-            if (num == 0) {
-                // puzzle is not complete, but might be valid
-                ++(params->numMissing);
-                params->complete = false;
-            }
-            else if (numCount[num]) {
-                // doubled number puzzle is not valid nor complete
-                params->valid = false;
-                params->complete = false;
-                return NULL;
-            }
-            else {
-                // first occurance of number
-                numCount[num] = true;
-            }
+    bool* numCount = params->numCount; // keep track of used nums
+    // the box's cells, from its shape's table
+    cell_t* box = params->shape->cells + (params->idx - 1) * params->psize;
+    for (int i = 0; i < params->psize; ++i) {
+        int num = params->grid[box[i].row + 1][box[i].col + 1];
+        if (num == 0) {
+            // puzzle is not complete, but might be valid
+            ++(params->numMissing);
+            params->complete = false;
+        }
+        else if (numCount[num]) {
+            // doubled number puzzle is not valid nor complete
+            params->valid = false;
+            params->complete = false;
+            return NULL;
+        }
+        else {
+            // first occurance of number
+            numCount[num] = true;
         }
     }
     return NULL;
 };
 
-missing_t* checkPuzzle(int psize, int** grid, bool* complete, bool* valid) {
-
-    missing_t* missing = (missing_t*)malloc(sizeof(missing_t) * psize);
-    // arguments for thread function
-    checkpuzzle_t rows[psize];
-    checkpuzzle_t cols[psize];
-    checkpuzzle_t grids[psize];
-
-    // open threads for every subset of the puzzle
-    pthread_t rowThreads[psize];
-    pthread_t colThreads[psize];
-    pthread_t gridThreads[psize];
-    for (int i = 0; i < psize; ++i) {
-        // open row thread
-        rows[i].idx = i + 1;
-        rows[i].psize = psize;
-        rows[i].grid = grid;
-        rows[i].valid = true;
-        rows[i].complete = true;
-        rows[i].numMissing = 0;
-        pthread_create(&rowThreads[i], NULL, checkRow, &rows[i]);
-        // open column thread
-        cols[i].idx = i + 1;
-        cols[i].psize = psize;
-        cols[i].grid = grid;
-        cols[i].valid = true;
-        cols[i].complete = true;
-        cols[i].numMissing = 0;
-        pthread_create(&colThreads[i], NULL, checkCol, &cols[i]);
-        // open grid thread
-        grids[i].idx = i + 1;
-        grids[i].psize = psize;
-        grids[i].grid = grid;
-        grids[i].valid = true;
-        grids[i].complete = true;
-        grids[i].numMissing = 0;
-        pthread_create(&gridThreads[i], NULL, checkGrid, &grids[i]);
-    }
-
-    // join all threads
-    for (int i = 0; i < psize; ++i) {
-        pthread_join(rowThreads[i], NULL);
-        pthread_join(colThreads[i], NULL);
-        pthread_join(gridThreads[i], NULL);
+void* checkUnit(void* args) {
+    switch (((checkpuzzle_t*)args)->type) {
+    case rows: return checkRow(args);
+    case cols: return checkCol(args);
+    default: return checkGrid(args);
     }
+}
+
+missing_t* checkPuzzle(int psize, num_t** grid, bool* complete, bool* valid, arena_t* arena) {
+    TRACE_BEGIN(span);
+    missing_t* missing = (missing_t*)arenaAlloc(arena, sizeof(missing_t) * psize);
+    // thread scratch is released before returning
+    arenaMark_t mark = arenaMark(arena);
+    // one check per row, column and box, row i at units[i],
+    // column i at units[psize + i] and box i at units[2 * psize + i]
+    checkpuzzle_t* units = (checkpuzzle_t*)arenaAlloc(arena, sizeof(checkpuzzle_t) * 3 * psize);
+    const shape_t* shape = getShape(psize, grid);
+    for (int i = 0; i < 3 * psize; ++i) {
+        units[i].type = (enum subset)(i / psize);
+        units[i].idx = i % psize + 1;
+        units[i].psize = psize;
+        units[i].shape = shape;
+        units[i].grid = grid;
+        units[i].valid = true;
+        units[i].complete = true;
+        units[i].numMissing = 0;
+        units[i].numCount = (bool*)arenaAlloc(arena, sizeof(bool) * (psize + 1));
+    }
+    runTasks(checkUnit, units, sizeof(checkpuzzle_t), 3 * psize, arena);
 
     // check valid and complete status
     *valid = true;    // if all rows/columns/boxes have numbers from 1 to psize
     *complete = true; // if it can be completed with no 0s in it
+    for (int i = 0; i < 3 * psize; ++i) {
+        if (!units[i].valid) *valid = false;
+        if (!units[i].complete) *complete = false;
+    }
     for (int i = 0; i < psize; ++i) {
-        if (!rows[i].valid || !cols[i].valid || !grids[i].valid) *valid = false;
-        if (!rows[i].complete || !cols[i].complete || !grids[i].complete) *complete = false;
-        missing[i].rows = rows[i].numMissing;
-        missing[i].cols = cols[i].numMissing;
-        missing[i].grids = grids[i].numMissing;
+        missing[i].rows = units[i].numMissing;
+        missing[i].cols = units[psize + i].numMissing;
+        missing[i].grids = units[2 * psize + i].numMissing;
     }
 
+    arenaRelease(arena, mark);
+    TRACE_END(span, "validate");
     return missing;
 }
 
-int readSudokuPuzzle(char* filename, int*** grid) {
+int readSudokuPuzzle(char* filename, num_t*** grid) {
     FILE* fp = fopen(filename, "r");
     if (fp == NULL) {
         printf("Could not open file %s\n", filename);
         exit(EXIT_FAILURE);
     }
-    int psize;
-    fscanf(fp, "%d", &psize);
-    int** agrid = (int**)malloc((psize + 1) * sizeof(int*));
+    int psize = readSudokuStream(fp, filename, grid);
+    if (psize == 0) {
+        printf("Puzzle size in %s must be from 1 to %d\n", filename, MAX_PSIZE);
+        exit(EXIT_FAILURE);
+    }
+    fclose(fp);
+    return psize;
+}
+
+num_t** createSudokuPuzzle(int psize) {
+    // rows share one block; row 0 and column 0 stay unused
+    num_t** grid = (num_t**)malloc((psize + 1) * sizeof(num_t*));
+    num_t* cells = (num_t*)calloc((psize + 1) * (psize + 1), sizeof(num_t));
+    for (int row = 0; row <= psize; row++) {
+        grid[row] = cells + row * (psize + 1);
+    }
+    return grid;
+}
+
+num_t** copySudokuPuzzle(int psize, num_t** grid) {
+    num_t** copy = createSudokuPuzzle(psize);
+    memcpy(copy[0], grid[0], sizeof(num_t) * (psize + 1) * (psize + 1));
+    return copy;
+}
+
+int readSudokuStream(FILE* fp, const char* name, num_t*** grid) {
+    TRACE_BEGIN(span);
+    int psize = 0;
+    int fields = fscanf(fp, "%d", &psize);
+    // notes after the last puzzle end the stream, as they end a single file
+    if (fields != 1) return 0;
+    if (psize < 1 || psize > MAX_PSIZE) {
+        printf("Puzzle size in %s must be from 1 to %d\n", name, MAX_PSIZE);
+        exit(EXIT_FAILURE);
+    }
+    num_t** agrid = createSudokuPuzzle(psize);
+    // box rows and columns, if they follow the size on its line
+    int c;
+    do {
+        c = fgetc(fp);
+    } while (c == ' ' || c == '\t' || c == '\r');
+    ungetc(c, fp);
+    if (c != '\n' && c != EOF) {
+        int boxRows = 0, boxCols = 0;
+        if (fscanf(fp, "%d %d", &boxRows, &boxCols) != 2 || !setBoxShape(psize, agrid, boxRows, boxCols)) {
+            printf("Boxes of %s must be rows and columns that multiply to %d\n", name, psize);
+            exit(EXIT_FAILURE);
+        }
+    }
     for (int row = 1; row <= psize; row++) {
-        agrid[row] = (int*)malloc((psize + 1) * sizeof(int));
         for (int col = 1; col <= psize; col++) {
-            fscanf(fp, "%d", &agrid[row][col]);
+            int num = 0;
+            bool read = fscanf(fp, "%d", &num) == 1;
+            bool inRange = num >= 0 && num <= psize;
+            if (!read || (!inRange && psize == MAX_PSIZE)) {
+                printf("Bad cell (%d, %d) in %s\n", row, col, name);
+                exit(EXIT_FAILURE);
+            }
+            // the board is turned away after parsing, not the whole stream
+            agrid[row][col] = inRange ? (num_t)num : BAD_CELL;
         }
     }
-    fclose(fp);
     *grid = agrid;
+    TRACE_END(span, "parse");
     return psize;
 }
 
-void printSudokuPuzzle(int psize, int** grid) {
-    printf("%d\n", psize);
+void writeSudokuPuzzle(FILE* fp, int psize, num_t** grid) {
+    if (grid[0][0]) fprintf(fp, "%d %d %d\n", psize, grid[0][0], psize / grid[0][0]);
+    else fprintf(fp, "%d\n", psize);
     for (int row = 1; row <= psize; row++) {
         for (int col = 1; col <= psize; col++) {
-            printf("%d ", grid[row][col]);
+            fprintf(fp, "%d ", grid[row][col]);
         }
-        printf("\n");
+        fprintf(fp, "\n");
     }
-    printf("\n");
+    fprintf(fp, "\n");
 }
 
-void deleteSudokuPuzzle(int psize, int** grid) {
-    for (int row = 1; row <= psize; row++) {
-        free(grid[row]);
-    }
-    free(grid);
+void printSudokuPuzzle(int psize, num_t** grid) {
+    TRACE_BEGIN(span);
+    writeSudokuPuzzle(stdout, psize, grid);
+    TRACE_END(span, "output");
 }
 
-// expects file name of the puzzle as argument in command line
-int main(int argc, char** argv) {
-    if (argc != 2) {
-        printf("usage: ./sudoku puzzle.txt\n");
-        return EXIT_FAILURE;
-    }
-    // grid is a 2D array
-    int** grid = NULL;
-    // find grid size and fill grid
-    int sudokuSize = readSudokuPuzzle(argv[1], &grid);
-    bool valid = false;
-    bool complete = false;
-    missing_t* missing = checkPuzzle(sudokuSize, grid, &complete, &valid);
-    printf("Complete puzzle? ");
-    printf(complete ? "true\n" : "false\n");
-    if (complete) {
-        printf("Valid puzzle? ");
-        printf(valid ? "true\n" : "false\n");
-    }
-    else if (valid) {
-        printf("Attempting Solve of:\n");
-        printSudokuPuzzle(sudokuSize, grid);
-        solvePuzzle(missing, sudokuSize, grid);
-    }
-    printSudokuPuzzle(sudokuSize, grid);
-    free(missing);
-    deleteSudokuPuzzle(sudokuSize, grid);
-    return EXIT_SUCCESS;
-}
\ No newline at end of file
+void deleteSudokuPuzzle(int psize, num_t** grid) {
+    (void)psize; // rows are one block
+    free(grid[0]);
+    free(grid);
+}
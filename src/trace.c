@@ -0,0 +1,180 @@
+/**
+ * @file trace.c
+ * @author Hayden Lauritzen (haydenlauritzen@gmail.com)
+ * @date 2023-1-16
+ *
+ * @copyright Copyright (c) 2023
+ *
+ */
+
+#include "../inc/trace.h"
+
+#ifdef SUDOKU_TRACE
+
+#include <pthread.h>
+#include <stdatomic.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h> // clock_gettime()
+
+#define TRACE_CHUNK 4096
+
+typedef struct traceEvent_t {
+    const char* name;
+    uint64_t start;
+    uint64_t dur; // UINT64_MAX marks a row name
+    int tid;
+} traceEvent_t;
+
+typedef struct traceChunk_t {
+    traceEvent_t events[TRACE_CHUNK];
+    int used;
+    struct traceChunk_t* next;
+} traceChunk_t;
+
+typedef struct traceBuffer_t {
+    traceChunk_t* first;
+    traceChunk_t* last;
+    long count;
+    long dropped;
+    struct traceBuffer_t* next; // every buffer, for traceFinish
+    struct traceBuffer_t* free; // buffers no thread is using
+} traceBuffer_t;
+
+bool traceOn = false;
+static const char* traceFile;
+static struct timespec traceEpoch;
+static _Atomic(traceBuffer_t*) traceBuffers;
+// only taken when a thread starts or exits
+static pthread_mutex_t traceFreeLock = PTHREAD_MUTEX_INITIALIZER;
+static traceBuffer_t* traceFree;
+static pthread_key_t traceKey;
+static _Thread_local traceBuffer_t* localBuffer;
+static _Thread_local int localTid = TRACE_MAIN;
+
+// hands the buffer of an exiting thread to the next one
+static void releaseBuffer(void* buffer) {
+    pthread_mutex_lock(&traceFreeLock);
+    ((traceBuffer_t*)buffer)->free = traceFree;
+    traceFree = (traceBuffer_t*)buffer;
+    pthread_mutex_unlock(&traceFreeLock);
+}
+
+static traceBuffer_t* getBuffer(void) {
+    if (localBuffer) return localBuffer;
+    pthread_mutex_lock(&traceFreeLock);
+    traceBuffer_t* buffer = traceFree;
+    if (buffer) traceFree = buffer->free;
+    pthread_mutex_unlock(&traceFreeLock);
+    if (buffer == NULL) {
+        buffer = (traceBuffer_t*)calloc(1, sizeof(traceBuffer_t));
+        buffer->next = atomic_load(&traceBuffers);
+        while (!atomic_compare_exchange_weak(&traceBuffers, &buffer->next, buffer));
+    }
+    localBuffer = buffer;
+    pthread_setspecific(traceKey, buffer);
+    return buffer;
+}
+
+static void record(const char* name, uint64_t start, uint64_t dur) {
+    traceBuffer_t* buffer = getBuffer();
+    if (buffer->count >= TRACE_MAX_EVENTS) {
+        ++(buffer->dropped);
+        return;
+    }
+    if (buffer->last == NULL || buffer->last->used == TRACE_CHUNK) {
+        traceChunk_t* chunk = (traceChunk_t*)malloc(sizeof(traceChunk_t));
+        chunk->used = 0;
+        chunk->next = NULL;
+        if (buffer->last) buffer->last->next = chunk;
+        else buffer->first = chunk;
+        buffer->last = chunk;
+    }
+    buffer->last->events[buffer->last->used++] = (traceEvent_t){ name, start, dur, localTid };
+    ++(buffer->count);
+}
+
+void traceStart(const char* filename) {
+    traceFile = filename;
+    pthread_key_create(&traceKey, releaseBuffer);
+    clock_gettime(CLOCK_MONOTONIC, &traceEpoch);
+    traceOn = true;
+    traceThread(TRACE_MAIN, "main");
+}
+
+uint64_t traceNow(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)(ts.tv_sec - traceEpoch.tv_sec) * 1000000000u + ts.tv_nsec - traceEpoch.tv_nsec;
+}
+
+void traceSpan(const char* name, uint64_t start) {
+    record(name, start, traceNow() - start);
+}
+
+void traceThread(int tid, const char* name) {
+    localTid = tid;
+    record(name, traceNow(), UINT64_MAX);
+}
+
+int traceTid(void) {
+    return localTid;
+}
+
+bool traceFinish(void) {
+    // every other thread has been joined by now
+    traceOn = false;
+    FILE* fp = fopen(traceFile, "w");
+    if (fp == NULL) {
+        printf("Could not write trace %s\n", traceFile);
+        return false;
+    }
+    traceBuffer_t* buffers = atomic_exchange(&traceBuffers, NULL);
+    traceFree = NULL;
+    localBuffer = NULL;
+    pthread_key_delete(traceKey);
+    long events = 0, dropped = 0;
+    // a row is named once however many threads ran on it
+    int* named = NULL;
+    int numNamed = 0;
+    bool first = true;
+    fprintf(fp, "{\"traceEvents\":[\n");
+    for (traceBuffer_t* buffer = buffers; buffer;) {
+        dropped += buffer->dropped;
+        for (traceChunk_t* chunk = buffer->first; chunk;) {
+            for (int i = 0; i < chunk->used; ++i) {
+                traceEvent_t* e = &chunk->events[i];
+                if (e->dur == UINT64_MAX) {
+                    int n = 0;
+                    while (n < numNamed && named[n] != e->tid) {
+                        ++n;
+                    }
+                    if (n < numNamed) continue;
+                    named = (int*)realloc(named, sizeof(int) * (numNamed + 1));
+                    named[numNamed++] = e->tid;
+                    fprintf(fp, "%s{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":%d,\"args\":{\"name\":\"%s %d\"}}",
+                        first ? "" : ",\n", e->tid, e->name, e->tid);
+                }
+                else {
+                    fprintf(fp, "%s{\"name\":\"%s\",\"ph\":\"X\",\"pid\":1,\"tid\":%d,\"ts\":%.3f,\"dur\":%.3f}",
+                        first ? "" : ",\n", e->name, e->tid, e->start / 1000.0, e->dur / 1000.0);
+                    ++events;
+                }
+                first = false;
+            }
+            traceChunk_t* next = chunk->next;
+            free(chunk);
+            chunk = next;
+        }
+        traceBuffer_t* next = buffer->next;
+        free(buffer);
+        buffer = next;
+    }
+    free(named);
+    fprintf(fp, "\n]}\n");
+    fclose(fp);
+    printf("Trace: %ld spans written to %s, %ld dropped\n", events, traceFile, dropped);
+    return true;
+}
+
+#endif // SUDOKU_TRACE
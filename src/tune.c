@@ -0,0 +1,336 @@
+/**
+ * @file tune.c
+ * @author Hayden Lauritzen (haydenlauritzen@gmail.com)
+ * @date 2023-1-16
+ *
+ * @copyright Copyright (c) 2023
+ *
+ */
+
+#include <fcntl.h>  // open()
+#include <unistd.h> // dup(), dup2()
+
+#include "../inc/tune.h"
+
+// settings tried one at a time, with the others held at their best
+typedef enum knob_e {
+    KNOB_WORKERS,
+    KNOB_SWEEP,
+    KNOB_RING,
+    KNOB_BATCH,
+    KNOB_INTERLEAVE,
+    NUM_KNOBS
+} knob_e;
+
+// what one pass over the sample measured
+typedef struct trial_t {
+    long puzzles;
+    double rate;                 // puzzles per second
+    double tail;                 // ns, p99 solve time of the slowest size
+    double mean[MAX_PSIZE + 1];  // ns per solve, 0 if none of the size were solved
+} trial_t;
+
+const char* profilePath(void) {
+    const char* path = getenv("SUDOKU_PROFILE");
+    if (path == NULL) return PROFILE_FILE;
+    return path[0] ? path : NULL;
+}
+
+static void clearProfile(profile_t* profile) {
+    memset(profile, 0, sizeof(profile_t));
+    profile->batch = -1;
+}
+
+bool loadProfile(const char* filename, profile_t* profile) {
+    clearProfile(profile);
+    FILE* fp = fopen(filename, "r");
+    if (fp == NULL) return false;
+    char line[256];
+    int lineNum = 0;
+    bool ok = true;
+    while (ok && fgets(line, sizeof(line), fp) != NULL) {
+        ++lineNum;
+        char* comment = strchr(line, '#');
+        if (comment) *comment = '\0';
+        char key[32];
+        int used = 0;
+        if (sscanf(line, "%31s %n", key, &used) < 1) continue; // blank line
+        char* rest = line + used;
+        long value = 0;
+        bool number = sscanf(rest, "%ld", &value) == 1;
+        if (strcmp(key, "workers") == 0 && number && value >= 1) {
+            profile->workers = (int)value;
+        }
+        else if (strcmp(key, "sweep_threads") == 0 && number && value >= 1) {
+            profile->sweepThreads = (int)value;
+        }
+        else if (strcmp(key, "ring") == 0 && number && value >= 1) {
+            profile->ringSize = (size_t)value;
+        }
+        else if (strcmp(key, "batch") == 0 && number && (value == 0 || value == 1)) {
+            profile->batch = (int)value;
+        }
+        else if (strcmp(key, "interleave") == 0 && number && value >= 1 && value <= PIPE_MAX_INTERLEAVE) {
+            profile->interleave = (int)value;
+        }
+        else if (strcmp(key, "route") == 0 && profile->numRoutes < PROFILE_MAX_ROUTES &&
+            parseRoute(rest, &profile->routes[profile->numRoutes]) == 1) {
+            ++(profile->numRoutes);
+        }
+        else {
+            printf("%s:%d: expected workers, sweep_threads, ring, batch, interleave or route\n", filename, lineNum);
+            ok = false;
+        }
+    }
+    fclose(fp);
+    if (!ok) clearProfile(profile);
+    return ok;
+}
+
+bool writeProfile(const char* filename, profile_t* profile, const char* note) {
+    FILE* fp = fopen(filename, "w");
+    if (fp == NULL) return false;
+    if (note) fprintf(fp, "# %s\n", note);
+    fprintf(fp, "workers %d\n", profile->workers);
+    fprintf(fp, "sweep_threads %d\n", profile->sweepThreads);
+    fprintf(fp, "ring %zu\n", profile->ringSize);
+    fprintf(fp, "batch %d\n", profile->batch);
+    fprintf(fp, "interleave %d\n", profile->interleave);
+    if (profile->numRoutes) fprintf(fp, "# max_psize min_clues max_density min_singles engine\n");
+    for (int i = 0; i < profile->numRoutes; ++i) {
+        route_t* route = &profile->routes[i];
+        fprintf(fp, "route %d %g %g %g %s\n", route->maxPsize, route->minClues, route->maxDensity,
+            route->minSingles, engineName(route->engine));
+    }
+    bool ok = !ferror(fp);
+    if (fclose(fp) != 0) ok = false;
+    return ok;
+}
+
+void applyProfile(profile_t* profile, run_t* run, pipeConfig_t* pipe) {
+    if (profile->workers) pipe->workers = profile->workers;
+    if (profile->sweepThreads) setWorkerCount(profile->sweepThreads);
+    if (profile->ringSize) pipe->ringSize = profile->ringSize;
+    if (profile->batch >= 0) pipe->batch = profile->batch == 1;
+    if (profile->interleave) pipe->interleave = profile->interleave;
+    if (profile->numRoutes) prependRoutes(run->dispatcher, profile->routes, profile->numRoutes);
+}
+
+// every non-check histogram of a size added into one
+static void mergeSolves(latency_t* latency, int psize, histogram_t* merged) {
+    memset(merged, 0, sizeof(histogram_t));
+    for (int kind = LATENCY_SOLVE; kind < NUM_LATENCY_KINDS; ++kind) {
+        histogram_t* hist = atomic_load(&latency->hists[psize][kind]);
+        if (hist == NULL) continue;
+        for (int idx = 0; idx < LATENCY_BUCKETS; ++idx) {
+            atomic_fetch_add(&merged->counts[idx], atomic_load(&hist->counts[idx]));
+        }
+        atomic_fetch_add(&merged->total, atomic_load(&hist->total));
+        atomic_fetch_add(&merged->sum, atomic_load(&hist->sum));
+        if (atomic_load(&hist->max) > atomic_load(&merged->max)) atomic_store(&merged->max, atomic_load(&hist->max));
+    }
+}
+
+// one pass over the sample with stdout thrown away, false if it can't be
+static bool runTrial(char** files, int numFiles, profile_t* profile, engine_e engine, trial_t* trial) {
+    run_t run = { NULL, NULL, NULL, createDispatcher(), NULL, engine, false, NULL, NULL, createLatency(NULL, 0), NULL };
+    prependRoutes(run.dispatcher, profile->routes, profile->numRoutes);
+    pipeConfig_t pipe = { profile->workers, profile->ringSize, profile->batch == 1, false,
+        profile->interleave ? profile->interleave : 1 };
+    setWorkerCount(profile->sweepThreads);
+    fflush(stdout);
+    int saved = dup(STDOUT_FILENO);
+    int sink = open("/dev/null", O_WRONLY);
+    bool ok = saved >= 0 && sink >= 0 && dup2(sink, STDOUT_FILENO) >= 0;
+    if (sink >= 0) close(sink);
+    long elapsed = 0;
+    if (ok) {
+        long start = latencyNow();
+        runPipeline(&run, files, numFiles, &pipe);
+        fflush(stdout);
+        elapsed = latencyNow() - start;
+        dup2(saved, STDOUT_FILENO);
+    }
+    if (saved >= 0) close(saved);
+    memset(trial, 0, sizeof(trial_t));
+    histogram_t* merged = (histogram_t*)malloc(sizeof(histogram_t));
+    for (int psize = 0; ok && psize <= MAX_PSIZE; ++psize) {
+        histogram_t* checks = atomic_load(&run.latency->hists[psize][LATENCY_VERIFY]);
+        if (checks) trial->puzzles += atomic_load(&checks->total);
+        mergeSolves(run.latency, psize, merged);
+        long solves = atomic_load(&merged->total);
+        if (solves == 0) continue;
+        trial->mean[psize] = (double)atomic_load(&merged->sum) / solves;
+        double tail = (double)latencyQuantile(merged, 0.99);
+        if (tail > trial->tail) trial->tail = tail;
+    }
+    free(merged);
+    trial->rate = elapsed > 0 ? trial->puzzles / (elapsed / 1e9) : 0.0;
+    deleteLatency(run.latency);
+    deleteDispatcher(run.dispatcher);
+    return ok && trial->puzzles > 0;
+}
+
+// the run of TUNE_REPEATS with the median throughput
+static bool medianTrial(char** files, int numFiles, profile_t* profile, engine_e engine, trial_t* trial) {
+    trial_t* trials = (trial_t*)malloc(sizeof(trial_t) * TUNE_REPEATS);
+    bool ok = true;
+    for (int i = 0; i < TUNE_REPEATS && ok; ++i) {
+        ok = runTrial(files, numFiles, profile, engine, &trials[i]);
+        // insertion sort by rate
+        for (int j = i; ok && j > 0 && trials[j].rate < trials[j - 1].rate; --j) {
+            trial_t swap = trials[j];
+            trials[j] = trials[j - 1];
+            trials[j - 1] = swap;
+        }
+    }
+    if (ok) *trial = trials[TUNE_REPEATS / 2];
+    free(trials);
+    return ok;
+}
+
+// true if candidate should replace best, see tune.h
+static bool beats(trial_t* candidate, trial_t* best) {
+    if (candidate->rate > best->rate * (1 + TUNE_MIN_GAIN)) return candidate->tail <= best->tail * TUNE_TAIL_SLACK;
+    return candidate->rate >= best->rate * (1 - TUNE_MIN_GAIN) && candidate->tail < best->tail * (1 - TUNE_MIN_GAIN);
+}
+
+static int getKnob(profile_t* profile, knob_e knob) {
+    switch (knob) {
+    case KNOB_WORKERS: return profile->workers;
+    case KNOB_SWEEP: return profile->sweepThreads;
+    case KNOB_RING: return (int)profile->ringSize;
+    case KNOB_BATCH: return profile->batch;
+    default: return profile->interleave;
+    }
+}
+
+static void setKnob(profile_t* profile, knob_e knob, int value) {
+    switch (knob) {
+    case KNOB_WORKERS: profile->workers = value; break;
+    case KNOB_SWEEP: profile->sweepThreads = value; break;
+    case KNOB_RING: profile->ringSize = (size_t)value; break;
+    case KNOB_BATCH: profile->batch = value; break;
+    default: profile->interleave = value; break;
+    }
+}
+
+// values worth trying, returns how many
+static int knobValues(knob_e knob, int cpus, int* values) {
+    int count = 0;
+    switch (knob) {
+    case KNOB_WORKERS:
+        // a worker can wait on the writer, so past the cpus too
+        for (int n = 1; n <= 2 * cpus || n <= 2; n *= 2) values[count++] = n;
+        break;
+    case KNOB_SWEEP:
+        for (int n = 1; n <= cpus || n <= 2; n *= 2) values[count++] = n;
+        break;
+    case KNOB_RING:
+        for (int n = PIPE_RING / 4; n <= PIPE_RING * 4; n *= 4) values[count++] = n;
+        break;
+    case KNOB_BATCH:
+        values[count++] = 0;
+        values[count++] = 1;
+        break;
+    default:
+        // one at a time, then windows a few puzzles wide
+        for (int n = 1; n <= 16; n *= 4) values[count++] = n;
+        break;
+    }
+    return count;
+}
+
+static void printTrial(profile_t* profile, trial_t* trial) {
+    printf("Tune: workers %d, sweep_threads %d, ring %zu, batch %d, interleave %d: %.1f/s, p99 %.3fms\n",
+        profile->workers, profile->sweepThreads, profile->ringSize, profile->batch, profile->interleave, trial->rate,
+        trial->tail / 1e6);
+}
+
+bool autotune(char** files, int numFiles, const char* filename, bool verbose) {
+    for (int i = 0; i < numFiles; ++i) {
+        FILE* fp = strcmp(files[i], "-") == 0 ? NULL : fopen(files[i], "r");
+        if (fp == NULL) {
+            printf("Tuning needs puzzle files it can read again, not %s\n", files[i]);
+            return false;
+        }
+        fclose(fp);
+    }
+    int restore = getWorkerCount();
+    int cpus = placeCpus();
+    profile_t profile;
+    clearProfile(&profile);
+    profile.workers = cpus;
+    profile.sweepThreads = cpus;
+    profile.ringSize = PIPE_RING;
+    profile.batch = 0;
+    profile.interleave = 1;
+    trial_t base, best, trial;
+    bool ok = medianTrial(files, numFiles, &profile, ENGINE_AUTO, &base);
+    if (ok && verbose) printTrial(&profile, &base);
+
+    // engines first, on one worker so they don't slow each other down
+    profile_t single = profile;
+    single.workers = 1;
+    trial_t* engines = (trial_t*)malloc(sizeof(trial_t) * NUM_ENGINES);
+    for (int engine = 0; ok && engine < NUM_ENGINES; ++engine) {
+        ok = medianTrial(files, numFiles, &single, (engine_e)engine, &engines[engine]);
+    }
+    for (int psize = 1; ok && psize <= MAX_PSIZE && profile.numRoutes < PROFILE_MAX_ROUTES; ++psize) {
+        int pick = -1;
+        for (int engine = 0; engine < NUM_ENGINES; ++engine) {
+            if (engines[engine].mean[psize] == 0) continue;
+            if (pick < 0 || engines[engine].mean[psize] < engines[pick].mean[psize]) pick = engine;
+        }
+        if (pick < 0) continue;
+        if (verbose) {
+            printf("Tune: %dx%d mean solve", psize, psize);
+            for (int engine = 0; engine < NUM_ENGINES; ++engine) {
+                printf(" %s %.3fms", engineName(engine), engines[engine].mean[psize] / 1e6);
+            }
+            printf(" -> %s\n", engineName(pick));
+        }
+        route_t route = { psize, 0.0, 1.0, 0.0, (engine_e)pick };
+        profile.routes[profile.numRoutes++] = route;
+    }
+    free(engines);
+
+    // then each setting in turn, from the defaults with those routes
+    if (ok) ok = medianTrial(files, numFiles, &profile, ENGINE_AUTO, &best);
+    if (ok && verbose) printTrial(&profile, &best);
+    for (knob_e knob = 0; ok && knob < NUM_KNOBS; ++knob) {
+        int values[16];
+        int count = knobValues(knob, cpus, values);
+        int start = getKnob(&profile, knob);
+        int bestValue = start;
+        for (int i = 0; ok && i < count; ++i) {
+            if (values[i] == start) continue;
+            profile_t candidate = profile;
+            setKnob(&candidate, knob, values[i]);
+            ok = medianTrial(files, numFiles, &candidate, ENGINE_AUTO, &trial);
+            if (ok && verbose) printTrial(&candidate, &trial);
+            if (ok && beats(&trial, &best)) {
+                best = trial;
+                bestValue = values[i];
+            }
+        }
+        setKnob(&profile, knob, bestValue);
+    }
+    setWorkerCount(restore);
+    if (!ok) {
+        printf("Tuning stopped, a pass over the puzzles failed\n");
+        return false;
+    }
+
+    char note[160];
+    snprintf(note, sizeof(note), "tuned on %ld puzzles: %.1f/s, p99 %.3fms (defaults %.1f/s, p99 %.3fms)",
+        best.puzzles, best.rate, best.tail / 1e6, base.rate, base.tail / 1e6);
+    printf("Tuned: workers %d, sweep_threads %d, ring %zu, batch %d, interleave %d, %d routes\n", profile.workers,
+        profile.sweepThreads, profile.ringSize, profile.batch, profile.interleave, profile.numRoutes);
+    if (!writeProfile(filename, &profile, note)) {
+        printf("Could not write %s\n", filename);
+        return false;
+    }
+    printf("Profile: %s, written to %s\n", note, filename);
+    return true;
+}